@@ -0,0 +1,558 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * capture.cpp: logs the beacons we hear to pcap files
+ */
+
+#include "capture.h"
+
+/** developer note:
+ *
+ * writing to flash takes milliseconds, the promiscuous callback gets
+ * microseconds. so the callback only copies the frame into a ring slot(see
+ * ring.h), same as it does for the peer task, and the writer task turns
+ * those into pcap records in a page sized buffer. flash only gets written a
+ * whole page at a time, except when a page has been sitting half full for
+ * CAPTURE_FLUSH_MS or a file gets closed. if the writer falls behind, new
+ * frames are dropped and counted, the callback never waits.
+ *
+ * the buffer stands for the flash page of the file we're in, not just any
+ * 4 KB. a timed flush writes up to the last whole record and keeps the rest,
+ * and the next write only goes as far as the end of that page, so every
+ * write after it lands on a page boundary again.
+ *
+ * files go in CAPTURE_DIR and are numbered, a new one starts every boot and
+ * every CAPTURE_FILE_MAX bytes, and only the newest CAPTURE_FILES are kept.
+ * every write is synced, and LittleFS never leaves a file half updated, so a
+ * crash or a pulled plug costs at most what was still in the page. a timed
+ * flush always leaves the file on a whole record, only a full page can end
+ * partway into one, which wireshark just stops at.
+ *
+ * frames are stamped with the time since boot, we don't know the real time.
+ *
+ * send "capture" over serial to see how it's doing, "capture start" and
+ * "capture stop" to turn it on and off, and "bench capture" to compare
+ * writing whole pages with writing every frame on its own. everything that
+ * touches the file happens in the writer task, stopping just tells it to
+ * close up and the benchmark runs there too, so neither holds up the radio
+ * task while flash is being written.
+ *
+ */
+
+static_assert(CAPTURE_RECORD_HEADER + CAPTURE_SNAP <= CAPTURE_PAGE,
+              "a record has to fit in a page");
+
+Ring<capture_frame_t, CAPTURE_RING_SLOTS> Capture::ring;
+TaskHandle_t Capture::writer = nullptr;
+volatile capture_state_t Capture::state = CAPTURE_OFF;
+volatile bool Capture::opened = false;
+volatile bool Capture::benching = false;
+fs::FS *Capture::storage = nullptr;
+const char *Capture::storageName = "";
+File Capture::file;
+uint32_t Capture::sequence = 0;
+size_t Capture::fileBytes = 0;
+uint8_t Capture::page[CAPTURE_PAGE] = {};
+size_t Capture::offset = 0;
+size_t Capture::used = 0;
+size_t Capture::whole = 0;
+unsigned long Capture::lastWrite = 0;
+capture_counters_t Capture::counters = {};
+
+void Capture::begin() {
+  if (Config::capture) {
+    Capture::start();
+  }
+}
+
+bool Capture::start() {
+  if (Capture::state == CAPTURE_ON) {
+    return true;
+  }
+
+  if (!Capture::mount()) {
+    Serial.println("(X-X) Nowhere to save captures!");
+    Serial.println(" ");
+    return false;
+  }
+
+  if (Capture::busy()) {
+    return false;
+  }
+
+  Capture::spawn();
+  Serial.printf("(^-^) Capturing beacons to %s\n", Capture::storageName);
+  Serial.println(" ");
+  Capture::state = CAPTURE_ON;
+  xTaskNotifyGive(Capture::writer);
+  return true;
+}
+
+// the writer finishes the page and closes the file on its own time
+void Capture::stop() {
+  if (Capture::state != CAPTURE_ON || Capture::busy()) {
+    return;
+  }
+
+  Capture::state = CAPTURE_OFF;
+  xTaskNotifyGive(Capture::writer);
+}
+
+void Capture::spawn() {
+  if (Capture::writer != nullptr) {
+    return;
+  }
+
+#if CONFIG_FREERTOS_UNICORE
+  xTaskCreate(Capture::task, "capture", CAPTURE_TASK_STACK, nullptr,
+              CAPTURE_TASK_PRIORITY, &Capture::writer);
+#else
+  xTaskCreatePinnedToCore(Capture::task, "capture", CAPTURE_TASK_STACK,
+                          nullptr, CAPTURE_TASK_PRIORITY, &Capture::writer,
+                          CAPTURE_TASK_CORE);
+#endif
+}
+
+// the benchmark has the writer to itself until it's done
+bool Capture::busy() {
+  if (!Capture::benching) {
+    return false;
+  }
+
+  Serial.println("(X-X) The capture benchmark is still running, try again!");
+  Serial.println(" ");
+  return true;
+}
+
+// the sd card on the CYD, LittleFS on anything else(or if there's no card)
+bool Capture::mount() {
+  if (Capture::storage != nullptr) {
+    return true;
+  }
+
+  // no formatting LittleFS if it won't mount, that would take whatever's on
+  // it with it
+  if (Config::screen == "CYD" && SD.begin(CAPTURE_SD_CS)) {
+    Capture::storage = &SD;
+    Capture::storageName = "the sd card";
+  } else if (LittleFS.begin(false)) {
+    Capture::storage = &LittleFS;
+    Capture::storageName = "LittleFS";
+  } else {
+    Serial.println("(X-X) Couldn't mount LittleFS, does the partition scheme "
+                   "have one? Format it with the LittleFS upload tool.");
+    return false;
+  }
+
+  // carry on numbering from the newest file that's already there
+  Capture::storage->mkdir(CAPTURE_DIR);
+  File dir = Capture::storage->open(CAPTURE_DIR);
+  if (dir && dir.isDirectory()) {
+    File entry;
+    while ((entry = dir.openNextFile())) {
+      const char *name = strrchr(entry.name(), '/');
+      name = name != nullptr ? name + 1 : entry.name();
+      Capture::sequence =
+          max(Capture::sequence, (uint32_t)strtoul(name, nullptr, 10));
+      entry.close();
+    }
+  }
+  dir.close();
+  return true;
+}
+
+// the promiscuous callback, no waiting around in here
+void Capture::offer(const uint8_t *frame, int len, int rssi, int channel) {
+  if (Capture::state != CAPTURE_ON || len <= 0) {
+    return;
+  }
+
+  capture_frame_t *slot = Capture::ring.claim();
+  if (slot == nullptr) {
+    return;
+  }
+
+  slot->received = Stats::now();
+  slot->rssi = rssi;
+  slot->channel = channel;
+  slot->original = len;
+  slot->length = min(len, CAPTURE_SNAP);
+  memcpy(slot->data, frame, slot->length);
+  Capture::ring.publish();
+
+  // no need to wake the writer for every frame
+  if (Capture::ring.size() >= CAPTURE_RING_SLOTS / 2 &&
+      Capture::writer != nullptr) {
+    xTaskNotifyGive(Capture::writer);
+  }
+}
+
+void Capture::task(void *parameter) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+
+    if (Capture::benching) {
+      Capture::measure();
+      Capture::benching = false;
+      continue;
+    }
+
+    if (Capture::state == CAPTURE_ON) {
+      if (!Capture::opened && !Capture::rotate()) {
+        Serial.println("(X-X) Couldn't start a capture file!");
+        Serial.println(" ");
+        Capture::state = CAPTURE_OFF;
+        continue;
+      }
+
+      Capture::drain();
+      if (Capture::whole > 0 &&
+          millis() - Capture::lastWrite >= CAPTURE_FLUSH_MS) {
+        Capture::write(Capture::whole);
+      }
+    } else if (Capture::state == CAPTURE_OFF && Capture::opened) {
+      Capture::drain();
+      Capture::close();
+    }
+  }
+}
+
+void Capture::drain() {
+  capture_frame_t *frame;
+  while ((frame = Capture::ring.peek()) != nullptr) {
+    Capture::record(*frame);
+    Capture::ring.release();
+  }
+}
+
+void Capture::record(const capture_frame_t &frame) {
+  if (!Capture::opened) {
+    return;
+  }
+
+  size_t total = CAPTURE_RECORD_HEADER + frame.length;
+  if (Capture::fileBytes + total > CAPTURE_FILE_MAX &&
+      Capture::fileBytes > CAPTURE_FILE_HEADER && !Capture::rotate()) {
+    return;
+  }
+
+  uint8_t head[CAPTURE_RECORD_HEADER];
+  Capture::header(head, frame);
+  Capture::append(head, sizeof(head));
+  Capture::append(frame.data, frame.length);
+  Capture::whole = Capture::used;
+
+  Capture::fileBytes += total;
+  Capture::counters.frames++;
+  Capture::counters.bytes += total;
+}
+
+// pcap record header then radiotap, both little endian like us
+size_t Capture::header(uint8_t *out, const capture_frame_t &frame) {
+  uint32_t record[4] = {
+      (uint32_t)(frame.received / 1000000),
+      (uint32_t)(frame.received % 1000000),
+      (uint32_t)(CAPTURE_RADIOTAP_LENGTH + frame.length),
+      (uint32_t)(CAPTURE_RADIOTAP_LENGTH + frame.original),
+  };
+  memcpy(out, record, sizeof(record));
+
+  // present: channel(bit 3) and antenna signal(bit 5)
+  uint8_t *radiotap = out + sizeof(record);
+  uint16_t length = CAPTURE_RADIOTAP_LENGTH;
+  uint32_t present = (1 << 3) | (1 << 5);
+  uint16_t frequency = frame.channel == 14   ? 2484
+                       : frame.channel == 0 ? 0
+                                            : 2407 + 5 * frame.channel;
+  uint16_t flags = 0x00a0; // 2 ghz, cck
+  radiotap[0] = 0;
+  radiotap[1] = 0;
+  memcpy(radiotap + 2, &length, sizeof(length));
+  memcpy(radiotap + 4, &present, sizeof(present));
+  memcpy(radiotap + 8, &frequency, sizeof(frequency));
+  memcpy(radiotap + 10, &flags, sizeof(flags));
+  radiotap[12] = (uint8_t)frame.rssi;
+  return CAPTURE_RECORD_HEADER;
+}
+
+// into the page, which goes out to flash every time it reaches the end of
+// one of the file's pages
+void Capture::append(const uint8_t *data, size_t length) {
+  while (length > 0) {
+    size_t end = Capture::offset + Capture::used;
+    size_t n = min(length, (size_t)(CAPTURE_PAGE - end % CAPTURE_PAGE));
+    memcpy(Capture::page + Capture::used, data, n);
+    Capture::used += n;
+    data += n;
+    length -= n;
+
+    if ((Capture::offset + Capture::used) % CAPTURE_PAGE == 0) {
+      Capture::write(Capture::used);
+    }
+  }
+}
+
+// the first length bytes of the page, whatever's after them stays for next
+// time
+bool Capture::write(size_t length) {
+  if (length == 0) {
+    return true;
+  }
+
+  size_t done = Capture::file.write(Capture::page, length);
+  Capture::file.flush();
+  Capture::offset += length;
+  if (Capture::offset % CAPTURE_PAGE == 0) {
+    Capture::counters.writes++;
+  } else {
+    Capture::counters.syncs++;
+  }
+
+  bool ok = done == length;
+  Capture::used -= length;
+  memmove(Capture::page, Capture::page + length, Capture::used);
+  Capture::whole = Capture::whole > length ? Capture::whole - length : 0;
+  Capture::lastWrite = millis();
+
+  if (!ok) {
+    // most likely out of space, no use carrying on
+    Capture::counters.failed++;
+    if (Capture::state == CAPTURE_ON) {
+      Serial.println("(X-X) Couldn't write the capture, stopping!");
+      Serial.println(" ");
+      Capture::state = CAPTURE_OFF;
+    }
+  }
+  return ok;
+}
+
+bool Capture::open(const char *path) {
+  Capture::file = Capture::storage->open(path, FILE_WRITE);
+  if (!Capture::file) {
+    return false;
+  }
+
+  Capture::opened = true;
+  Capture::offset = 0;
+  Capture::used = 0;
+  Capture::whole = 0;
+  Capture::fileBytes = CAPTURE_FILE_HEADER;
+  Capture::lastWrite = millis();
+  Capture::counters.files++;
+  Capture::counters.bytes += CAPTURE_FILE_HEADER;
+
+  uint8_t head[CAPTURE_FILE_HEADER];
+  Capture::preamble(head);
+  Capture::append(head, sizeof(head));
+  Capture::whole = Capture::used;
+  return true;
+}
+
+// pcap's file header: microsecond timestamps, radiotap link type
+void Capture::preamble(uint8_t *out) {
+  uint32_t magic = 0xa1b2c3d4;
+  uint16_t version[2] = {2, 4};
+  uint32_t rest[4] = {0, 0, CAPTURE_RADIOTAP_LENGTH + CAPTURE_SNAP, 127};
+  memcpy(out, &magic, sizeof(magic));
+  memcpy(out + 4, version, sizeof(version));
+  memcpy(out + 8, rest, sizeof(rest));
+}
+
+void Capture::close() {
+  Capture::write(Capture::used);
+  Capture::file.close();
+  Capture::opened = false;
+}
+
+// on to the next file, making room by dropping the oldest
+bool Capture::rotate() {
+  if (Capture::opened) {
+    Capture::close();
+  }
+
+  char name[32];
+  Capture::path(name, sizeof(name), ++Capture::sequence);
+  if (!Capture::open(name)) {
+    return false;
+  }
+
+  if (Capture::sequence > CAPTURE_FILES) {
+    Capture::path(name, sizeof(name), Capture::sequence - CAPTURE_FILES);
+    if (Capture::storage->exists(name)) {
+      Capture::storage->remove(name);
+    }
+  }
+  return true;
+}
+
+void Capture::path(char *out, size_t capacity, uint32_t sequence) {
+  snprintf(out, capacity, CAPTURE_DIR "/%05u.pcap", (unsigned)sequence);
+}
+
+static const bool registered = Commands::add(Capture::command);
+
+bool Capture::command(const String &line) {
+  if (line == "capture start") {
+    Capture::start();
+  } else if (line == "capture stop") {
+    Capture::stop();
+  } else if (line == "bench capture") {
+    Capture::benchmark();
+    return true;
+  } else if (line != "capture") {
+    return false;
+  }
+
+  Capture::report();
+  Serial.println(" ");
+  return true;
+}
+
+void Capture::report() {
+  if (Capture::state != CAPTURE_ON) {
+    Serial.println("('-') capture off");
+    return;
+  }
+
+  char name[32];
+  Capture::path(name, sizeof(name), Capture::sequence);
+  Serial.printf("('-') capture %s frames=%u dropped=%u files=%u pages=%u "
+                "syncs=%u\n",
+                name, (unsigned)Capture::counters.frames,
+                (unsigned)Capture::ring.drops(),
+                (unsigned)Capture::counters.files,
+                (unsigned)Capture::counters.writes,
+                (unsigned)Capture::counters.syncs);
+}
+
+// hand the benchmark to the writer, it reports when it's done
+void Capture::benchmark() {
+  if (Capture::busy()) {
+    return;
+  }
+
+  if (!Capture::mount()) {
+    Serial.println("(X-X) Nowhere to save captures!");
+    Serial.println(" ");
+    return;
+  }
+
+  Serial.println("(>-<) Benchmarking capture writes, this takes a bit...");
+  Serial.println(" ");
+  Capture::spawn();
+  Capture::benching = true;
+  xTaskNotifyGive(Capture::writer);
+}
+
+// a file's worth of beacons written a page at a time, then a frame at a time.
+// runs in the writer task
+void Capture::measure() {
+  bool capturing = Capture::state == CAPTURE_ON;
+
+  // anyone already in offer() is done with the ring by now
+  Capture::state = CAPTURE_BENCH;
+  delay(10);
+  if (Capture::opened) {
+    Capture::drain();
+    Capture::close();
+  }
+
+  // a typical beacon
+  static capture_frame_t frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.length = frame.original = 256;
+  frame.data[0] = 0x80;
+  frame.rssi = -50;
+  frame.channel = 6;
+
+  const char *name = CAPTURE_DIR "/bench.pcap";
+  const size_t total = CAPTURE_RECORD_HEADER + frame.length;
+  const uint32_t frames = (CAPTURE_FILE_MAX - CAPTURE_FILE_HEADER) / total;
+  capture_counters_t saved = Capture::counters;
+  Capture::counters = {};
+
+  // through the ring and the page, like a real capture
+  int64_t started = Stats::now();
+  bool ok = Capture::open(name);
+  for (uint32_t i = 0; ok && i < frames; i++) {
+    capture_frame_t *slot = Capture::ring.claim();
+    if (slot == nullptr) {
+      Capture::drain();
+      slot = Capture::ring.claim();
+    }
+    *slot = frame;
+    slot->received = Stats::now();
+    Capture::ring.publish();
+  }
+  if (ok) {
+    Capture::drain();
+    Capture::close();
+  }
+  unsigned paged = (unsigned)(Stats::now() - started);
+  uint32_t pagedWrites = Capture::counters.writes + Capture::counters.syncs;
+  uint32_t bytes = Capture::counters.bytes;
+
+  // every frame written and synced on its own
+  started = Stats::now();
+  File direct = Capture::storage->open(name, FILE_WRITE);
+  ok = ok && direct;
+  if (ok) {
+    uint8_t preamble[CAPTURE_FILE_HEADER];
+    Capture::preamble(preamble);
+    direct.write(preamble, sizeof(preamble));
+    for (uint32_t i = 0; i < frames; i++) {
+      uint8_t head[CAPTURE_RECORD_HEADER];
+      frame.received = Stats::now();
+      Capture::header(head, frame);
+      direct.write(head, sizeof(head));
+      direct.write(frame.data, frame.length);
+      direct.flush();
+    }
+    direct.close();
+  }
+  unsigned single = (unsigned)(Stats::now() - started);
+  Capture::storage->remove(name);
+
+  // the capture picks up again in a new file
+  Capture::counters = saved;
+  Capture::state = capturing ? CAPTURE_ON : CAPTURE_OFF;
+
+  if (!ok) {
+    Serial.println("(X-X) Couldn't write the benchmark file!");
+    Serial.println(" ");
+    return;
+  }
+
+  // each sync programs at least the page it ends in, so that's the floor on
+  // what flash sees
+  Serial.printf("('-') %u beacons, %u KB of pcap on %s\n", (unsigned)frames,
+                (unsigned)(bytes / 1024), Capture::storageName);
+  Serial.printf("('-') Paged: %u ms, %u frames/s, %u writes, ~%u KB "
+                "programmed\n",
+                (unsigned)(paged / 1000),
+                (unsigned)((uint64_t)frames * 1000000 / max(paged, 1u)),
+                (unsigned)pagedWrites,
+                (unsigned)(pagedWrites * CAPTURE_PAGE / 1024));
+  Serial.printf("('-') Per frame: %u ms, %u frames/s, %u writes, ~%u KB "
+                "programmed\n",
+                (unsigned)(single / 1000),
+                (unsigned)((uint64_t)frames * 1000000 / max(single, 1u)),
+                (unsigned)frames, (unsigned)(frames * CAPTURE_PAGE / 1024));
+  Serial.println(" ");
+}
@@ -0,0 +1,142 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * capture.h: header files for capture.cpp
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "commands.h"
+#include "config.h"
+#include "ring.h"
+#include "stats.h"
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include <SD.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// what we write at a time, a flash page(LittleFS's block size)
+#define CAPTURE_PAGE 4096
+
+// frames waiting for the writer, a power of two, and how much of each one
+// we keep. with the page that's all the ram the logger ever uses
+#define CAPTURE_RING_SLOTS 16
+#define CAPTURE_SNAP 768
+
+// a new file past this size, and how many we keep before the oldest goes
+#define CAPTURE_FILE_MAX (256 * 1024)
+#define CAPTURE_FILES 4
+
+// a page that's been sitting half full this long(ms) gets written anyway,
+// the tests don't wait that long
+#ifndef CAPTURE_FLUSH_MS
+#define CAPTURE_FLUSH_MS 10000
+#endif
+
+#define CAPTURE_DIR "/capture"
+
+// the CYD's sd card slot
+#define CAPTURE_SD_CS 5
+
+// writer task, flash is slow so it stays out of everyone's way
+#define CAPTURE_TASK_CORE 1
+#define CAPTURE_TASK_PRIORITY 1
+#define CAPTURE_TASK_STACK 4096
+
+// the radiotap header in front of every frame, just channel and rssi
+#define CAPTURE_RADIOTAP_LENGTH 13
+
+// pcap's file and record headers
+#define CAPTURE_FILE_HEADER 24
+#define CAPTURE_RECORD_HEADER (16 + CAPTURE_RADIOTAP_LENGTH)
+
+typedef enum {
+  CAPTURE_OFF = 0,
+  CAPTURE_ON = 1,
+  CAPTURE_BENCH = 2, // the benchmark has the ring and the page to itself
+} capture_state_t;
+
+// a frame copied out of the promiscuous callback
+typedef struct {
+  int64_t received;
+  int8_t rssi;
+  uint8_t channel;
+  uint16_t length;
+  uint16_t original;
+  uint8_t data[CAPTURE_SNAP];
+} capture_frame_t;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t bytes;  // pcap bytes, headers and all
+  uint32_t writes; // whole pages
+  uint32_t syncs;  // partial pages, from the idle flush or closing a file
+  uint32_t files;
+  uint32_t failed;
+} capture_counters_t;
+
+class Capture {
+public:
+  static void begin();
+  static bool start();
+  static void stop();
+  static void offer(const uint8_t *frame, int len, int rssi, int channel);
+  static bool command(const String &line);
+  static void report();
+  static void benchmark();
+
+private:
+  static bool mount();
+  static void spawn();
+  static bool busy();
+  static void measure();
+  static void task(void *parameter);
+  static void drain();
+  static void record(const capture_frame_t &frame);
+  static void append(const uint8_t *data, size_t length);
+  static bool write(size_t length);
+  static bool open(const char *path);
+  static void close();
+  static bool rotate();
+  static void path(char *out, size_t capacity, uint32_t sequence);
+  static size_t header(uint8_t *out, const capture_frame_t &frame);
+  static void preamble(uint8_t *out);
+
+  static Ring<capture_frame_t, CAPTURE_RING_SLOTS> ring;
+  static TaskHandle_t writer;
+  static volatile capture_state_t state;
+  static volatile bool opened;
+  static volatile bool benching;
+  static fs::FS *storage;
+  static const char *storageName;
+  static File file;
+  static uint32_t sequence;
+  static size_t fileBytes;
+  static uint8_t page[CAPTURE_PAGE];
+  static size_t offset; // where in the file page[0] goes
+  static size_t used;
+  static size_t whole; // how much of the page is whole records
+  static unsigned long lastWrite;
+  static capture_counters_t counters;
+};
+
+#endif // CAPTURE_H
@@ -31,13 +31,22 @@
  *
  */
 
-// same channels in config
-int Channel::channelList[13] = {
-    Config::channels[0], Config::channels[1],  Config::channels[2],
-    Config::channels[3], Config::channels[4],  Config::channels[5],
-    Config::channels[6], Config::channels[7],  Config::channels[8],
-    Config::channels[9], Config::channels[10], Config::channels[11],
-    Config::channels[12]};
+// channel plan and hop order, picked at compile time(see config.h)
+constexpr int Channel::channelList[];
+constexpr int Channel::hopOrder[];
+constexpr int Channel::numChannels;
+
+bool Channel::switched = false;
+
+// per channel activity, index is the channel number
+channel_activity_t Channel::activity[15] = {};
+int Channel::hops = 0;
+int Channel::discoveries = 0;
+hop_state_t Channel::hopState = {HOP_SEED, 0, 0, {}};
+
+// when and how we last hopped
+uint32_t Channel::hopTimer = 0;
+bool Channel::hopFast = false;
 
 void Channel::init(int initChannel) {
   // start on user specified channel
@@ -52,10 +61,12 @@ void Channel::init(int initChannel) {
 
   // switch channel
   Minigotchi::monStop();
-  esp_err_t err = esp_wifi_set_channel(initChannel, WIFI_SECOND_CHAN_NONE);
+  Hal::setCountry(CHANNEL_PLAN_COUNTRY, Channel::channelList[0],
+                  Channel::numChannels);
+  bool switched = Hal::setChannel(initChannel);
   Minigotchi::monStart();
 
-  if (err == ESP_OK && initChannel == getChannel()) {
+  if (switched && initChannel == getChannel()) {
     Serial.print("('-') Successfully initialized on channel ");
     Serial.println(getChannel());
     Display::updateDisplay("('-')", "Successfully initialized on channel " +
@@ -69,34 +80,152 @@ void Channel::init(int initChannel) {
   }
 }
 
-void Channel::cycle() {
-  // get channels
-  int numChannels = sizeof(channelList) / sizeof(channelList[0]);
+long Channel::cycle() {
+  // we've already hopped, the settle time is up so we're done here
+  if (Channel::switched) {
+    Channel::switched = false;
+    Channel::measure();
+    return TASK_DONE;
+  }
 
-  // select a random one
-  int randomIndex = random(numChannels);
-  int newChannel = channelList[randomIndex];
+  // pick where to go next, in parasite mode the host decides that
+  int newChannel;
+  if (Config::parasite && Parasite::channel > 0) {
+    if (Parasite::channel == Channel::getChannel()) {
+      return TASK_DONE;
+    }
+    newChannel = Parasite::channel;
+  } else {
+    newChannel = Channel::next(Channel::hopState);
+  }
+  Channel::hops++;
+  Channel::activity[newChannel].lastHop = Channel::hops;
 
   // switch here
   switchChannel(newChannel);
+  Channel::switched = true;
+
+  // let the radio settle on the new channel
+  return Scheduler::interval();
+}
+
+/** developer note:
+ *
+ * the full switch tears monitor mode down and brings it back up around the
+ * retune, which is slow. the fast switch leaves monitor mode up and just
+ * retunes, checks it landed, and only then tells the serial/display about it.
+ * if the fast switch doesn't work out we fall back to the full one.
+ *
+ * either way the time from the switch to the first frame we hear afterwards is
+ * recorded, send "bench hop" over serial to compare the two directly.
+ *
+ */
+
+// retune, false if we didn't end up on the channel
+bool Channel::hop(int newChannel, bool fast) {
+  Hal::armFirstFrame();
+  Channel::hopTimer = (uint32_t)Stats::now();
+  Channel::hopFast = fast;
+
+  if (fast) {
+    return Hal::setChannel(newChannel) && Hal::getChannel() == newChannel;
+  }
+
+  Minigotchi::monStop();
+  bool switched = Hal::setChannel(newChannel);
+  Minigotchi::monStart();
+  return switched;
+}
+
+static const bool registered = Commands::add(Channel::command);
+
+// how long until we heard something after the last hop
+void Channel::measure() {
+  uint32_t first = Hal::firstFrame();
+  if (first != 0) {
+    Stats::record(Channel::hopFast ? STAT_HOP_FAST : STAT_HOP_FULL,
+                  first - Channel::hopTimer);
+  }
+}
+
+bool Channel::command(const String &line) {
+  if (line == "bench hop") {
+    Channel::benchmark();
+  } else if (line == "hop plan") {
+    Channel::plan();
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void Channel::benchmark() {
+  int home = Channel::getChannel();
+  uint32_t total[2] = {0, 0};
+  int heard[2] = {0, 0};
+
+  Serial.println("(>-<) Benchmarking channel switches...");
+  Minigotchi::monStart();
+
+  // alternate between full and fast switches
+  for (int i = 0; i < 20; i++) {
+    bool fast = i % 2;
+    if (!Channel::hop(channelList[random(numChannels)], fast)) {
+      continue;
+    }
+
+    // wait for the first frame, give up after a bit
+    unsigned long deadline = millis() + 250;
+    while (Hal::firstFrame() == 0 && (long)(millis() - deadline) < 0) {
+      delay(1);
+    }
+
+    if (Hal::firstFrame() != 0) {
+      Channel::measure();
+      total[fast] += Hal::firstFrame() - Channel::hopTimer;
+      heard[fast]++;
+    }
+  }
+
+  Channel::hop(home, false);
+
+  const char *paths[2] = {"Full", "Fast"};
+  for (int i = 0; i < 2; i++) {
+    Serial.printf("('-') %s switch: %u us to first frame (%d/10 heard)\n",
+                  paths[i], heard[i] ? (unsigned)(total[i] / heard[i]) : 0,
+                  heard[i]);
+  }
+  Serial.println(" ");
 }
 
 void Channel::switchChannel(int newChannel) {
+  int64_t started = Stats::now();
+
+  // the fast switch only works if monitor mode is still up. if something else
+  // turned it off(the deauth scan does) bringing it back is a full switch, and
+  // it's timed as one
+  if (Config::fastSwitch && Hal::monitoring() &&
+      Channel::hop(newChannel, true)) {
+    Stats::since(STAT_SWITCH, started);
+    Serial.print("('-') Hopped to channel ");
+    Serial.println(newChannel);
+    Serial.println(" ");
+    Display::updateDisplay("('-')", "Hopped to channel " + (String)newChannel);
+    return;
+  }
+
   // switch to channel
-  delay(250);
   Serial.print("(-.-) Switching to channel ");
   Serial.println(newChannel);
   Serial.println(" ");
   Display::updateDisplay("(-.-)", "Switching to channel " + (String)newChannel);
-  delay(250);
 
   // monitor this one channel
-  Minigotchi::monStop();
-  esp_err_t err = esp_wifi_set_channel(newChannel, WIFI_SECOND_CHAN_NONE);
-  Minigotchi::monStart();
+  bool switched = Channel::hop(newChannel, false);
+  Stats::since(STAT_SWITCH, started);
 
   // check if the channel switch was successful
-  if (err == ESP_OK) {
+  if (switched) {
     checkChannel(newChannel);
   } else {
 
@@ -104,7 +233,6 @@ void Channel::switchChannel(int newChannel) {
     Serial.println(" ");
     Display::updateDisplay("(X-X)", "Failed to switch channel.");
     checkChannel(newChannel);
-    delay(250);
   }
 }
 
@@ -117,7 +245,6 @@ void Channel::checkChannel(int channel) {
     Display::updateDisplay("('-')",
                            "Currently on channel " + (String)getChannel());
     Serial.println(" ");
-    delay(250);
   } else {
     Serial.print("(X-X) Channel switch to channel ");
     Serial.print(channel);
@@ -128,13 +255,238 @@ void Channel::checkChannel(int channel) {
     Serial.println(" ");
     Display::updateDisplay("(X-X)", "Channel switch to " + (String)channel +
                                         " has failed");
-    delay(250);
   }
 }
 
+/** developer note:
+ *
+ * hopping isn't uniform anymore. while we listen the promiscuous callback
+ * counts beacons, pwngrid frames and (roughly) unique bssids per channel, and
+ * once we leave a channel that gets folded into a decaying score. busy channels
+ * get picked more often and listened on longer (see Epoch::dwell()), but any
+ * channel we haven't been on for Config::maxHopAge hops gets picked no matter
+ * what so nothing gets starved.
+ *
+ */
+
+// called from the promiscuous callback for every beacon, keep it cheap
+void Channel::record(int channel, const uint8_t *bssid, bool pwngrid) {
+  if (channel <= 0 || channel >= 15) {
+    return;
+  }
+
+  channel_activity_t &heard = Channel::activity[channel];
+  heard.beacons++;
+  if (pwngrid) {
+    heard.pwngrid++;
+  }
+
+  // hash the bssid into a 64 bit bitmap, good enough to count unique ones
+  int slot = (bssid[3] ^ bssid[4] ^ bssid[5] ^ (bssid[5] >> 6)) & 63;
+  uint64_t bit = 1ULL << slot;
+  if (!(heard.seen & bit)) {
+    heard.seen |= bit;
+    heard.bssids++;
+  }
+}
+
+// done listening on a channel, fold what we heard into its score
+void Channel::visit(int channel) {
+  if (channel <= 0 || channel >= 15) {
+    return;
+  }
+
+  channel_activity_t &heard = Channel::activity[channel];
+  heard.score = heard.score * 3 / 4 + heard.bssids * 4 + heard.pwngrid * 32 +
+                heard.beacons / 16;
+  if (heard.pwngrid > 0) {
+    Channel::discoveries++;
+  }
+
+  heard.beacons = 0;
+  heard.pwngrid = 0;
+  heard.bssids = 0;
+  heard.seen = 0;
+}
+
+// how likely we are to hop here, grows slower than the score itself so busy
+// channels don't completely drown out the quiet ones
+int Channel::weight(int channel) {
+  if (channel <= 0 || channel >= 15) {
+    return 1;
+  }
+
+  return 1 + (int)sqrtf((float)Channel::activity[channel].score);
+}
+
+// this channel's weight compared to the average one, in percent(50-200)
+int Channel::share(int channel) {
+  int total = 0;
+  for (int i = 0; i < numChannels; i++) {
+    total += Channel::weight(channelList[i]);
+  }
+
+  int share = Channel::weight(channel) * 100 * numChannels / total;
+  return constrain(share, 50, 200);
+}
+
+int Channel::pick() {
+  int current = Channel::getChannel();
+  int starved = 0;
+  int starvedAge = 0;
+  int total = 0;
+
+  for (int i = 0; i < numChannels; i++) {
+    int channel = channelList[i];
+    if (channel == current && numChannels > 1) {
+      continue;
+    }
+
+    // haven't been here in too long, this one goes first
+    int age = Channel::hops - Channel::activity[channel].lastHop;
+    if (age >= Config::maxHopAge && age > starvedAge) {
+      starved = channel;
+      starvedAge = age;
+    }
+
+    total += Channel::weight(channel);
+  }
+
+  if (starved > 0) {
+    return starved;
+  }
+
+  // weighted random pick
+  int ticket = random(total);
+  for (int i = 0; i < numChannels; i++) {
+    int channel = channelList[i];
+    if (channel == current && numChannels > 1) {
+      continue;
+    }
+
+    ticket -= Channel::weight(channel);
+    if (ticket < 0) {
+      return channel;
+    }
+  }
+
+  return channelList[0];
+}
+
+/** developer note:
+ *
+ * the other two strategies don't look at activity at all, they walk through
+ * a whole round of the channel plan before repeating anything. HOP_ORDERED
+ * always uses hopOrder, HOP_SHUFFLE reshuffles it at the start of every round
+ * from a fixed seed. either way every channel in the plan gets visited within
+ * numChannels hops, and the same build always hops the same way, so send
+ * "hop plan" over serial to see exactly where we're going next.
+ *
+ */
+
+// next channel from the strategy picked in config.h
+int Channel::next(hop_state_t &state) {
+#if HOP_STRATEGY == HOP_ADAPTIVE
+  return Channel::pick();
+#else
+  // start of a round
+  if (state.position == 0) {
+    memcpy(state.order, Channel::hopOrder, sizeof(Channel::hopOrder));
+#if HOP_STRATEGY == HOP_SHUFFLE
+    for (int i = Channel::numChannels - 1; i > 0; i--) {
+      int j = Channel::xorshift(state.seed) % (i + 1);
+      int swap = state.order[i];
+      state.order[i] = state.order[j];
+      state.order[j] = swap;
+    }
+
+    // don't hop to the channel we're already on across rounds
+    if (state.order[0] == state.last && Channel::numChannels > 1) {
+      state.order[0] = state.order[1];
+      state.order[1] = state.last;
+    }
+#endif
+  }
+
+  int channel = state.order[state.position];
+  state.position = (state.position + 1) % Channel::numChannels;
+  state.last = channel;
+  return channel;
+#endif
+}
+
+uint32_t Channel::xorshift(uint32_t &seed) {
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+constexpr bool Channel::contains(const int *table, int size, int channel) {
+  return size > 0 && (table[size - 1] == channel ||
+                      Channel::contains(table, size - 1, channel));
+}
+
+// is every channel in plan somewhere in order?
+constexpr bool Channel::covers(const int *order, int size, const int *plan,
+                               int count) {
+  return count == 0 || (Channel::contains(order, size, plan[count - 1]) &&
+                        Channel::covers(order, size, plan, count - 1));
+}
+
+// a hop order that skips a channel would starve it forever
+static_assert(sizeof(Channel::hopOrder) == sizeof(Channel::channelList),
+              "hop order and channel plan differ in size");
+static_assert(Channel::numChannels <= 14, "channel plan is too big");
+static_assert(Channel::covers(Channel::hopOrder, Channel::numChannels,
+                              Channel::channelList, Channel::numChannels),
+              "hop order doesn't cover every channel in the plan");
+
+// print where we're hopping next and how that's working out so far
+void Channel::plan() {
+  const char *strategies[3] = {"adaptive", "shuffle", "ordered"};
+  Serial.printf("('-') Hop strategy: %s, %d channels, country %s\n",
+                strategies[HOP_STRATEGY], Channel::numChannels,
+                CHANNEL_PLAN_COUNTRY);
+
+#if HOP_STRATEGY == HOP_ADAPTIVE
+  Serial.printf("('-') Every channel at least once every %d hops\n",
+                Config::maxHopAge);
+#else
+  // dry run on a copy so we don't disturb the real thing
+  hop_state_t preview = Channel::hopState;
+  bool seen[15] = {};
+  int covered = 0;
+  int coveredAt = 0;
+
+  Serial.print("('-') Next hops:");
+  for (int i = 0; i < Channel::numChannels * 2; i++) {
+    int channel = Channel::next(preview);
+    Serial.print(" ");
+    Serial.print(channel);
+
+    if (!seen[channel]) {
+      seen[channel] = true;
+      if (++covered == Channel::numChannels) {
+        coveredAt = i + 1;
+      }
+    }
+  }
+  Serial.println();
+  Serial.printf("('-') Every channel covered within %d hops\n", coveredAt);
+#endif
+
+  // compare these between builds to see which strategy finds more
+  Serial.printf("('-') %d hops, %d with pwngrid frames (%d%%)\n",
+                Channel::hops, Channel::discoveries,
+                Channel::hops ? Channel::discoveries * 100 / Channel::hops
+                              : 0);
+  Serial.println(" ");
+}
+
 bool Channel::isValidChannel(int channel) {
   bool isValidChannel = false;
-  for (int i = 0; i < sizeof(channelList) / sizeof(channelList[0]); i++) {
+  for (int i = 0; i < Channel::numChannels; i++) {
     if (channelList[i] == channel) {
       isValidChannel = true;
       break;
@@ -143,9 +495,4 @@ bool Channel::isValidChannel(int channel) {
   return isValidChannel;
 }
 
-int Channel::getChannel() {
-  uint8_t primary;
-  wifi_second_chan_t second;
-  esp_wifi_get_channel(&primary, &second);
-  return primary;
-}
+int Channel::getChannel() { return Hal::getChannel(); }
@@ -23,28 +23,88 @@
 #ifndef CHANNEL_H
 #define CHANNEL_H
 
+#include "commands.h"
 #include "config.h"
 #include "display.h"
+#include "hal.h"
 #include "minigotchi.h"
 #include "parasite.h"
-#include <WiFi.h>
-#include <esp_wifi.h>
+#include "scheduler.h"
+#include "stats.h"
+
+// channel plans, hopOrder puts the non-overlapping channels first and spreads
+// the rest out across the band
+#if CHANNEL_PLAN == CHANNEL_PLAN_US
+#define CHANNEL_PLAN_COUNTRY "US"
+#define CHANNEL_PLAN_LIST 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11
+#define CHANNEL_PLAN_ORDER 1, 6, 11, 3, 8, 2, 7, 4, 9, 5, 10
+#elif CHANNEL_PLAN == CHANNEL_PLAN_JP
+#define CHANNEL_PLAN_COUNTRY "JP"
+#define CHANNEL_PLAN_LIST 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14
+#define CHANNEL_PLAN_ORDER 1, 6, 11, 14, 3, 8, 13, 2, 7, 12, 4, 9, 5, 10
+#else
+#define CHANNEL_PLAN_COUNTRY "EU"
+#define CHANNEL_PLAN_LIST 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13
+#define CHANNEL_PLAN_ORDER 1, 6, 11, 3, 8, 13, 2, 7, 12, 4, 9, 5, 10
+#endif
+
+// what we've heard on a channel, see Channel::record()
+typedef struct {
+  uint32_t beacons;
+  uint32_t pwngrid;
+  uint32_t bssids;
+  uint64_t seen;
+  uint32_t score;
+  int lastHop;
+} channel_activity_t;
+
+// where a hop generator is at, see Channel::next()
+typedef struct {
+  uint32_t seed;
+  int position;
+  int last;
+  int order[14];
+} hop_state_t;
 
 class Channel {
 public:
   static void init(int initChannel);
-  static void cycle();
+  static long cycle();
   static void switchChannel(int newChannel);
   static int getChannel();
   static void checkChannel(int channel);
   static bool isValidChannel(int channel);
-  static int channelList[13]; // 13 channels
+  static void record(int channel, const uint8_t *bssid, bool pwngrid);
+  static void visit(int channel);
+  static int weight(int channel);
+  static int share(int channel);
+  static bool command(const String &line);
+  static void benchmark();
+  static void plan();
+  static constexpr bool contains(const int *table, int size, int channel);
+  static constexpr bool covers(const int *order, int size, const int *plan,
+                               int count);
+  static constexpr int channelList[] = {CHANNEL_PLAN_LIST};
+  static constexpr int hopOrder[] = {CHANNEL_PLAN_ORDER};
+  static constexpr int numChannels =
+      sizeof(channelList) / sizeof(channelList[0]);
 
 private:
   static int randomIndex;
-  static int numChannels;
   static int currentChannel;
   static int newChannel;
+  static bool switched;
+  static int pick();
+  static int next(hop_state_t &state);
+  static uint32_t xorshift(uint32_t &seed);
+  static bool hop(int newChannel, bool fast);
+  static void measure();
+  static uint32_t hopTimer;
+  static bool hopFast;
+  static channel_activity_t activity[15];
+  static int hops;
+  static int discoveries;
+  static hop_state_t hopState;
 };
 
 #endif // CHANNEL_H
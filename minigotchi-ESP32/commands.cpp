@@ -0,0 +1,60 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * commands.cpp: hands serial commands to whichever module they're for
+ */
+
+#include "commands.h"
+
+/** developer note:
+ *
+ * every module with serial commands has a command(line) that says if the line
+ * was one of its own, and adds it here from its own .cpp:
+ *
+ * static const bool registered = Commands::add(Frame::command);
+ *
+ * that runs before setup(), so nothing here can depend on the order modules
+ * get added in(the table itself is zeroed before any of them run).
+ * Parasite::readData() is the only place reading serial, anything that isn't
+ * a parasite command comes through dispatch(). see each module for what it
+ * takes.
+ *
+ */
+
+command_handler_t Commands::handlers[COMMANDS_MAX] = {};
+int Commands::count = 0;
+
+bool Commands::add(command_handler_t handler) {
+  if (Commands::count >= COMMANDS_MAX) {
+    return false;
+  }
+
+  Commands::handlers[Commands::count++] = handler;
+  return true;
+}
+
+// first module to take the line wins
+bool Commands::dispatch(const String &line) {
+  for (int i = 0; i < Commands::count; i++) {
+    if (Commands::handlers[i](line)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,44 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * commands.h: header files for commands.cpp
+ */
+
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <Arduino.h>
+
+// modules with serial commands, there's one slot each
+#define COMMANDS_MAX 16
+
+// a module's serial commands, says if the line was one of them
+typedef bool (*command_handler_t)(const String &line);
+
+class Commands {
+public:
+  static bool add(command_handler_t handler);
+  static bool dispatch(const String &line);
+
+private:
+  static command_handler_t handlers[COMMANDS_MAX];
+  static int count;
+};
+
+#endif // COMMANDS_H
@@ -21,6 +21,8 @@
  */
 
 #include "config.h"
+#include "hal.h"
+#include "minigotchi.h"
 
 /** developer note:
  *
@@ -38,6 +40,47 @@ bool Config::advertise = true;
 int Config::shortDelay = 500;
 int Config::longDelay = 5000;
 
+// per-phase time budgets(ms), in order: cycle, detect, advertise, deauth
+// a phase is wrapped up once it has run for this long
+int Config::phaseBudget[4] = {250, 15000, 16000, 30000};
+
+// how often(ms) each phase gets serviced while it's running, this is the
+// channel settle time, the scanning animation, the pause before the first
+// beacon(the rest are paced by beaconInterval) and the deauth interval
+int Config::phaseInterval[4] = {250, 500, 102, 102};
+
+// which frames the driver passes up during each phase, same order. detection
+// only needs beacons, the channel survey after a hop takes anything busy
+uint32_t Config::phaseFilter[4] = {
+    HAL_FILTER_MGMT | HAL_FILTER_DATA, HAL_FILTER_MGMT, HAL_FILTER_MGMT,
+    HAL_FILTER_MGMT};
+
+// print a one line stats summary every n epochs, 0 turns it off
+int Config::statsInterval = 10;
+
+// every channel gets revisited within this many hops, no matter how quiet
+int Config::maxHopAge = 20;
+
+// retune without restarting monitor mode, see Channel::switchChannel()
+bool Config::fastSwitch = true;
+
+// deflate our advertisment when that makes it smaller, see Frame::squeeze()
+bool Config::compress = true;
+
+// sign our advertisment with our own key like a real pwnagotchi does, see
+// identity.cpp. the first boot takes a while to generate the key
+bool Config::sign = true;
+
+// log the beacons we hear to a pcap file, on the sd card for the CYD and
+// LittleFS for everything else. see capture.cpp
+bool Config::capture = false;
+
+// time between beacons(ms), or beacons per second if beaconRate isn't 0, and
+// the most we send per advertisment. see Frame::due()
+int Config::beaconInterval = 102;
+int Config::beaconRate = 0;
+int Config::beaconCount = 150;
+
 // Defines if this is running in parasite mode where it hooks up directly to a
 // Pwnagotchi
 bool Config::parasite = false;
@@ -75,9 +118,6 @@ int Config::ap_ttl = Config::random(30, 600);
 bool Config::associate = true;
 int Config::bored_num_epochs = Config::random(5, 30);
 
-// define channels
-int Config::channels[13] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
-
 // see https://github.com/evilsocket/pwnagotchi/blob/master/pwnagotchi/ai/gym.py
 int Config::excited_num_epochs = Config::random(5, 30);
 int Config::hop_recon_time = Config::random(5, 60);
@@ -95,9 +135,6 @@ int Config::pwnd_tot = 0;
 std::string Config::session_id = "84:f3:eb:58:95:bd";
 int Config::uptime = Config::time();
 
-// wifi settings
-wifi_init_config_t Config::config = WIFI_INIT_CONFIG_DEFAULT();
-
 // define version(please do not change, this should not be changed)
 std::string Config::version = "3.3.2-beta";
 
@@ -23,21 +23,45 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-#include "minigotchi.h"
-#include "parasite.h"
 #include <Arduino.h>
-#include <esp_wifi.h>
 #include <iostream>
 #include <random>
 #include <string>
 #include <vector>
 
+// regional channel plans, which channels we hop on
+#define CHANNEL_PLAN_US 0 // 1-11
+#define CHANNEL_PLAN_EU 1 // 1-13
+#define CHANNEL_PLAN_JP 2 // 1-14
+#define CHANNEL_PLAN CHANNEL_PLAN_EU
+
+// hop strategies, see channel.cpp
+#define HOP_ADAPTIVE 0 // weighted by what we've heard on each channel
+#define HOP_SHUFFLE 1  // every channel once per round, shuffled every round
+#define HOP_ORDERED 2  // fixed order, non-overlapping channels first
+#define HOP_STRATEGY HOP_ADAPTIVE
+
+// seed for HOP_SHUFFLE, the same seed always gives the same hops
+#define HOP_SEED 0x6d696e69
+
 class Config {
 public:
   static bool deauth;
   static bool advertise;
   static int shortDelay;
   static int longDelay;
+  static int phaseBudget[4];
+  static int phaseInterval[4];
+  static uint32_t phaseFilter[4];
+  static int statsInterval;
+  static int maxHopAge;
+  static bool fastSwitch;
+  static bool compress;
+  static bool sign;
+  static bool capture;
+  static int beaconInterval;
+  static int beaconRate;
+  static int beaconCount;
   static bool parasite;
   static bool display;
   static std::string screen;
@@ -59,7 +83,6 @@ public:
   static int ap_ttl;
   static bool associate;
   static int bored_num_epochs;
-  static int channels[13];
   static int excited_num_epochs;
   static int hop_recon_time;
   static int max_inactive_scale;
@@ -76,7 +99,6 @@ public:
   static std::string session_id;
   static int uptime;
   static std::string version;
-  static wifi_init_config_t config;
 
 private:
   static int random(int min, int max);
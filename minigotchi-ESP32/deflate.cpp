@@ -0,0 +1,467 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * deflate.cpp: small raw deflate(RFC 1951) for pwngrid payloads
+ */
+
+#include "deflate.h"
+
+/** developer note:
+ *
+ * pwngrid compresses advertisments with go's compress/flate, that's plain
+ * deflate without a zlib or gzip wrapper. we don't need anything near zlib for
+ * a json blob under a kilobyte, so compress() only ever writes one block with
+ * the fixed huffman codes and finds matches with a small hash chain. that's a
+ * few kb of static tables and no heap.
+ *
+ * inflate() has to read whatever peers send us, which means stored, fixed and
+ * dynamic blocks. it's based on Mark Adler's puff.c, decoding straight from
+ * the canonical code counts instead of building lookup tables.
+ *
+ */
+
+const uint16_t Deflate::lengthBase[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t Deflate::lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                          1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                          4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t Deflate::distanceBase[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+const uint8_t Deflate::distanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+uint8_t *Deflate::output = nullptr;
+size_t Deflate::outputCapacity = 0;
+size_t Deflate::outputLength = 0;
+uint32_t Deflate::pending = 0;
+int Deflate::pendingBits = 0;
+uint16_t Deflate::head[DEFLATE_HASH];
+uint16_t Deflate::prev[DEFLATE_WINDOW];
+
+// compress in into out, 0 if it didn't fit in capacity
+size_t Deflate::compress(const uint8_t *in, size_t length, uint8_t *out,
+                         size_t capacity) {
+  Deflate::output = out;
+  Deflate::outputCapacity = capacity;
+  Deflate::outputLength = 0;
+  Deflate::pending = 0;
+  Deflate::pendingBits = 0;
+
+  // positions are stored +1 so 0 means nothing there yet
+  memset(Deflate::head, 0, sizeof(Deflate::head));
+
+  // one final block with the fixed codes
+  Deflate::put(1, 1);
+  Deflate::put(1, 2);
+
+  size_t i = 0;
+  while (i < length) {
+    int bestLength = 0;
+    int bestDistance = 0;
+
+    if (i + 3 <= length) {
+      uint32_t hash = ((in[i] << 10) ^ (in[i + 1] << 5) ^ in[i + 2]) &
+                      (DEFLATE_HASH - 1);
+      size_t candidate = Deflate::head[hash];
+      int maxLength = min(length - i, (size_t)258);
+
+      for (int chain = 0; candidate > 0 && chain < DEFLATE_CHAIN; chain++) {
+        size_t from = candidate - 1;
+        if (i - from >= DEFLATE_WINDOW) {
+          break;
+        }
+
+        int matched = 0;
+        while (matched < maxLength && in[from + matched] == in[i + matched]) {
+          matched++;
+        }
+
+        if (matched > bestLength) {
+          bestLength = matched;
+          bestDistance = i - from;
+          if (matched == maxLength) {
+            break;
+          }
+        }
+
+        size_t older = Deflate::prev[from & (DEFLATE_WINDOW - 1)];
+        if (older >= candidate) {
+          break;
+        }
+        candidate = older;
+      }
+
+      Deflate::prev[i & (DEFLATE_WINDOW - 1)] = Deflate::head[hash];
+      Deflate::head[hash] = i + 1;
+    }
+
+    if (bestLength >= 3) {
+      Deflate::match(bestLength, bestDistance);
+
+      // the bytes we skip over still go into the hash chains
+      for (size_t j = i + 1; j < i + bestLength && j + 3 <= length; j++) {
+        uint32_t hash = ((in[j] << 10) ^ (in[j + 1] << 5) ^ in[j + 2]) &
+                        (DEFLATE_HASH - 1);
+        Deflate::prev[j & (DEFLATE_WINDOW - 1)] = Deflate::head[hash];
+        Deflate::head[hash] = j + 1;
+      }
+      i += bestLength;
+    } else {
+      Deflate::literal(in[i]);
+      i++;
+    }
+  }
+
+  // end of block, then whatever bits are left over
+  Deflate::putCode(0, 7);
+  Deflate::put(0, 7);
+
+  if (Deflate::outputLength > Deflate::outputCapacity) {
+    return 0;
+  }
+  return Deflate::outputLength;
+}
+
+// deflate packs bits starting from the least significant one
+void Deflate::put(uint32_t value, int bits) {
+  Deflate::pending |= value << Deflate::pendingBits;
+  Deflate::pendingBits += bits;
+
+  while (Deflate::pendingBits >= 8) {
+    // keep counting past the end so compress() knows it didn't fit
+    if (Deflate::outputLength < Deflate::outputCapacity) {
+      Deflate::output[Deflate::outputLength] = Deflate::pending & 0xFF;
+    }
+    Deflate::outputLength++;
+    Deflate::pending >>= 8;
+    Deflate::pendingBits -= 8;
+  }
+}
+
+// huffman codes go out most significant bit first
+void Deflate::putCode(uint32_t code, int bits) {
+  uint32_t reversed = 0;
+  for (int i = 0; i < bits; i++) {
+    reversed = (reversed << 1) | ((code >> i) & 1);
+  }
+  Deflate::put(reversed, bits);
+}
+
+// fixed literal/length code, RFC 1951 3.2.6
+void Deflate::literal(uint8_t value) {
+  if (value < 144) {
+    Deflate::putCode(0x30 + value, 8);
+  } else {
+    Deflate::putCode(0x190 + value - 144, 9);
+  }
+}
+
+void Deflate::match(int length, int distance) {
+  int code = 28;
+  while (Deflate::lengthBase[code] > length) {
+    code--;
+  }
+
+  int symbol = 257 + code;
+  if (symbol < 280) {
+    Deflate::putCode(symbol - 256, 7);
+  } else {
+    Deflate::putCode(0xC0 + symbol - 280, 8);
+  }
+  Deflate::put(length - Deflate::lengthBase[code], Deflate::lengthExtra[code]);
+
+  code = 29;
+  while (Deflate::distanceBase[code] > distance) {
+    code--;
+  }
+
+  Deflate::putCode(code, 5);
+  Deflate::put(distance - Deflate::distanceBase[code],
+               Deflate::distanceExtra[code]);
+}
+
+// decompress in into out, returns the decompressed length or -1
+int Deflate::inflate(const uint8_t *in, size_t length, uint8_t *out,
+                     size_t capacity) {
+  deflate_reader_t reader = {in, length, 0, 0, 0, false};
+  deflate_huffman_t lencode;
+  deflate_huffman_t distcode;
+  size_t written = 0;
+  int last;
+
+  do {
+    last = Deflate::bits(reader, 1);
+    int type = Deflate::bits(reader, 2);
+    int result = -1;
+
+    if (type == 0) {
+      // stored, byte aligned length and its complement then raw bytes
+      reader.bits = 0;
+      reader.count = 0;
+      if (reader.position + 4 > reader.length) {
+        return -1;
+      }
+
+      unsigned stored =
+          reader.in[reader.position] | (reader.in[reader.position + 1] << 8);
+      unsigned check = reader.in[reader.position + 2] |
+                       (reader.in[reader.position + 3] << 8);
+      reader.position += 4;
+      if (stored != (~check & 0xFFFF) ||
+          reader.position + stored > reader.length ||
+          written + stored > capacity) {
+        return -1;
+      }
+
+      memcpy(out + written, reader.in + reader.position, stored);
+      reader.position += stored;
+      written += stored;
+      result = 0;
+    } else if (type == 1) {
+      Deflate::fixed(lencode, distcode);
+      result =
+          Deflate::codes(reader, lencode, distcode, out, capacity, written);
+    } else if (type == 2) {
+      if (Deflate::dynamic(reader, lencode, distcode) == 0) {
+        result =
+            Deflate::codes(reader, lencode, distcode, out, capacity, written);
+      }
+    }
+
+    if (result != 0 || reader.error) {
+      return -1;
+    }
+  } while (!last);
+
+  return written;
+}
+
+int Deflate::bits(deflate_reader_t &reader, int need) {
+  uint32_t value = reader.bits;
+  while (reader.count < need) {
+    if (reader.position >= reader.length) {
+      reader.error = true;
+      return 0;
+    }
+    value |= (uint32_t)reader.in[reader.position++] << reader.count;
+    reader.count += 8;
+  }
+
+  reader.bits = value >> need;
+  reader.count -= need;
+  return value & ((1UL << need) - 1);
+}
+
+// one symbol, walking the code one bit at a time
+int Deflate::decode(deflate_reader_t &reader,
+                    const deflate_huffman_t &huffman) {
+  int code = 0;
+  int first = 0;
+  int index = 0;
+
+  for (int length = 1; length < 16; length++) {
+    code |= Deflate::bits(reader, 1);
+    int count = huffman.count[length];
+    if (code - count < first) {
+      return huffman.symbol[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+
+    if (reader.error) {
+      return -1;
+    }
+  }
+
+  return -1;
+}
+
+// build a canonical code from code lengths, false if it's over-subscribed
+bool Deflate::construct(deflate_huffman_t &huffman, const uint8_t *lengths,
+                        int count) {
+  int16_t offsets[16];
+
+  memset(huffman.count, 0, sizeof(huffman.count));
+  for (int symbol = 0; symbol < count; symbol++) {
+    huffman.count[lengths[symbol]]++;
+  }
+
+  int left = 1;
+  for (int length = 1; length < 16; length++) {
+    left <<= 1;
+    left -= huffman.count[length];
+    if (left < 0) {
+      return false;
+    }
+  }
+
+  offsets[1] = 0;
+  for (int length = 1; length < 15; length++) {
+    offsets[length + 1] = offsets[length] + huffman.count[length];
+  }
+
+  for (int symbol = 0; symbol < count; symbol++) {
+    if (lengths[symbol] != 0) {
+      huffman.symbol[offsets[lengths[symbol]]++] = symbol;
+    }
+  }
+
+  return true;
+}
+
+// literals and matches until the end of the block
+int Deflate::codes(deflate_reader_t &reader, const deflate_huffman_t &lencode,
+                   const deflate_huffman_t &distcode, uint8_t *out,
+                   size_t capacity, size_t &written) {
+  for (;;) {
+    int symbol = Deflate::decode(reader, lencode);
+    if (symbol < 0 || reader.error) {
+      return -1;
+    }
+
+    if (symbol < 256) {
+      if (written >= capacity) {
+        return -1;
+      }
+      out[written++] = symbol;
+    } else if (symbol == 256) {
+      return 0;
+    } else {
+      symbol -= 257;
+      if (symbol >= 29) {
+        return -1;
+      }
+      size_t length = Deflate::lengthBase[symbol] +
+                      Deflate::bits(reader, Deflate::lengthExtra[symbol]);
+
+      symbol = Deflate::decode(reader, distcode);
+      if (symbol < 0 || symbol >= 30) {
+        return -1;
+      }
+      size_t distance = Deflate::distanceBase[symbol] +
+                        Deflate::bits(reader, Deflate::distanceExtra[symbol]);
+
+      if (reader.error || distance > written || written + length > capacity) {
+        return -1;
+      }
+
+      // can overlap itself, so byte by byte
+      for (size_t i = 0; i < length; i++) {
+        out[written] = out[written - distance];
+        written++;
+      }
+    }
+  }
+}
+
+// the code lengths come first, themselves huffman coded
+int Deflate::dynamic(deflate_reader_t &reader, deflate_huffman_t &lencode,
+                     deflate_huffman_t &distcode) {
+  static const uint8_t order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                    11, 4,  12, 3, 13, 2, 14, 1, 15};
+  uint8_t lengths[288 + 32];
+
+  int nlen = Deflate::bits(reader, 5) + 257;
+  int ndist = Deflate::bits(reader, 5) + 1;
+  int ncode = Deflate::bits(reader, 4) + 4;
+  if (nlen > 286 || ndist > 30 || reader.error) {
+    return -1;
+  }
+
+  memset(lengths, 0, sizeof(lengths));
+  for (int i = 0; i < ncode; i++) {
+    lengths[order[i]] = Deflate::bits(reader, 3);
+  }
+  if (!Deflate::construct(lencode, lengths, 19)) {
+    return -1;
+  }
+
+  int index = 0;
+  while (index < nlen + ndist) {
+    int symbol = Deflate::decode(reader, lencode);
+    if (symbol < 0 || reader.error) {
+      return -1;
+    }
+
+    if (symbol < 16) {
+      lengths[index++] = symbol;
+      continue;
+    }
+
+    int length = 0;
+    int repeat;
+    if (symbol == 16) {
+      if (index == 0) {
+        return -1;
+      }
+      length = lengths[index - 1];
+      repeat = 3 + Deflate::bits(reader, 2);
+    } else if (symbol == 17) {
+      repeat = 3 + Deflate::bits(reader, 3);
+    } else {
+      repeat = 11 + Deflate::bits(reader, 7);
+    }
+
+    if (index + repeat > nlen + ndist) {
+      return -1;
+    }
+    while (repeat--) {
+      lengths[index++] = length;
+    }
+  }
+
+  // no end of block code means there's no way out of this block
+  if (lengths[256] == 0) {
+    return -1;
+  }
+
+  if (!Deflate::construct(lencode, lengths, nlen) ||
+      !Deflate::construct(distcode, lengths + nlen, ndist)) {
+    return -1;
+  }
+
+  return 0;
+}
+
+// RFC 1951 3.2.6
+void Deflate::fixed(deflate_huffman_t &lencode, deflate_huffman_t &distcode) {
+  uint8_t lengths[288];
+
+  for (int symbol = 0; symbol < 288; symbol++) {
+    if (symbol < 144) {
+      lengths[symbol] = 8;
+    } else if (symbol < 256) {
+      lengths[symbol] = 9;
+    } else if (symbol < 280) {
+      lengths[symbol] = 7;
+    } else {
+      lengths[symbol] = 8;
+    }
+  }
+  Deflate::construct(lencode, lengths, 288);
+
+  memset(lengths, 5, 30);
+  Deflate::construct(distcode, lengths, 30);
+}
@@ -0,0 +1,93 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * deflate.h: header files for deflate.cpp
+ */
+
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <Arduino.h>
+
+// how far back compress() looks for matches, a power of two
+#define DEFLATE_WINDOW 2048
+
+// hash table size for finding matches, a power of two
+#define DEFLATE_HASH 1024
+
+// how many earlier matches compress() tries before settling
+#define DEFLATE_CHAIN 32
+
+// bit reader used by inflate(), see deflate.cpp
+typedef struct {
+  const uint8_t *in;
+  size_t length;
+  size_t position;
+  uint32_t bits;
+  int count;
+  bool error;
+} deflate_reader_t;
+
+// canonical huffman code, how many codes of each length and their symbols
+typedef struct {
+  int16_t count[16];
+  int16_t symbol[288];
+} deflate_huffman_t;
+
+class Deflate {
+public:
+  static size_t compress(const uint8_t *in, size_t length, uint8_t *out,
+                         size_t capacity);
+  static int inflate(const uint8_t *in, size_t length, uint8_t *out,
+                     size_t capacity);
+
+private:
+  // compress()
+  static void put(uint32_t value, int bits);
+  static void putCode(uint32_t code, int bits);
+  static void literal(uint8_t value);
+  static void match(int length, int distance);
+  static uint8_t *output;
+  static size_t outputCapacity;
+  static size_t outputLength;
+  static uint32_t pending;
+  static int pendingBits;
+  static uint16_t head[DEFLATE_HASH];
+  static uint16_t prev[DEFLATE_WINDOW];
+
+  // inflate()
+  static int bits(deflate_reader_t &reader, int need);
+  static int decode(deflate_reader_t &reader, const deflate_huffman_t &huffman);
+  static bool construct(deflate_huffman_t &huffman, const uint8_t *lengths,
+                        int count);
+  static int codes(deflate_reader_t &reader, const deflate_huffman_t &lencode,
+                   const deflate_huffman_t &distcode, uint8_t *out,
+                   size_t capacity, size_t &written);
+  static int dynamic(deflate_reader_t &reader, deflate_huffman_t &lencode,
+                     deflate_huffman_t &distcode);
+  static void fixed(deflate_huffman_t &lencode, deflate_huffman_t &distcode);
+
+  // shared tables from RFC 1951
+  static const uint16_t lengthBase[29];
+  static const uint8_t lengthExtra[29];
+  static const uint16_t distanceBase[30];
+  static const uint8_t distanceExtra[30];
+};
+
+#endif // DEFLATE_H
@@ -36,6 +36,8 @@ String Display::previousFace = "";
 String Display::storedText = "";
 String Display::previousText = "";
 
+QueueHandle_t Display::queue = nullptr;
+
 Display::~Display() {
   if (ssd1306_adafruit_display) {
     delete ssd1306_adafruit_display;
@@ -141,6 +143,16 @@ void Display::startScreen() {
       tft.setTextSize(2); // Set text size)
       delay(100);
     }
+
+    // hand all drawing off to the ui task from here on out
+    Display::queue = xQueueCreate(UI_QUEUE_LENGTH, sizeof(display_message_t));
+#if CONFIG_FREERTOS_UNICORE
+    xTaskCreate(Display::task, "ui", UI_TASK_STACK, nullptr, UI_TASK_PRIORITY,
+                nullptr);
+#else
+    xTaskCreatePinnedToCore(Display::task, "ui", UI_TASK_STACK, nullptr,
+                            UI_TASK_PRIORITY, nullptr, UI_TASK_CORE);
+#endif
   }
 }
 
@@ -156,7 +168,56 @@ void Display::startScreen() {
 
 void Display::updateDisplay(String face) { Display::updateDisplay(face, ""); }
 
+/** developer note:
+ *
+ * screen updates are slow (especially over i2c), so whoever calls this only
+ * drops a message into a queue. the ui task drains it on its own core and does
+ * the actual drawing, so a screen update never holds up a channel hop or a
+ * beacon burst.
+ *
+ * if the queue is full the oldest message gets thrown out, the newest one is
+ * what should end up on screen anyways.
+ *
+ */
+
 void Display::updateDisplay(String face, String text) {
+  if (!Config::display) {
+    return;
+  }
+
+  // ui task isn't up yet, just draw it here
+  if (Display::queue == nullptr) {
+    int64_t started = Stats::now();
+    Display::render(face, text);
+    Stats::since(STAT_DISPLAY, started);
+    return;
+  }
+
+  display_message_t message;
+  strncpy(message.face, face.c_str(), sizeof(message.face) - 1);
+  message.face[sizeof(message.face) - 1] = '\0';
+  strncpy(message.text, text.c_str(), sizeof(message.text) - 1);
+  message.text[sizeof(message.text) - 1] = '\0';
+
+  if (xQueueSend(Display::queue, &message, 0) != pdTRUE) {
+    display_message_t oldest;
+    xQueueReceive(Display::queue, &oldest, 0);
+    xQueueSend(Display::queue, &message, 0);
+  }
+}
+
+void Display::task(void *parameter) {
+  display_message_t message;
+  for (;;) {
+    if (xQueueReceive(Display::queue, &message, portMAX_DELAY) == pdTRUE) {
+      int64_t started = Stats::now();
+      Display::render(message.face, message.text);
+      Stats::since(STAT_DISPLAY, started);
+    }
+  }
+}
+
+void Display::render(String face, String text) {
   if (Config::display) {
     if ((Config::screen == "SSD1306" ||
          Config::screen == "WEMOS_OLED_SHIELD") &&
@@ -25,6 +25,7 @@
 
 #include "config.h"
 #include "mood.h"
+#include "stats.h"
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1305.h>
 #include <Adafruit_SSD1306.h>
@@ -32,6 +33,9 @@
 #include <TFT_eSPI.h> // Defines the TFT_eSPI library for CYD
 #include <U8g2lib.h>
 #include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
 #include <string>
 
 #define SSD1306_SCREEN_WIDTH 128
@@ -66,6 +70,17 @@
 #define T_DISPLAY_S3_WIDTH 320
 #define T_DISPLAY_S3_HEIGHT 170
 
+// ui task, runs on the core the radio isn't using
+#define UI_TASK_CORE 1
+#define UI_TASK_PRIORITY 1
+#define UI_TASK_STACK 4096
+#define UI_QUEUE_LENGTH 8
+
+typedef struct {
+  char face[16];
+  char text[128];
+} display_message_t;
+
 class Display {
 public:
   static void startScreen();
@@ -79,6 +94,9 @@ public:
   ~Display();
 
 private:
+  static void render(String face, String text);
+  static void task(void *parameter);
+  static QueueHandle_t queue;
   static Adafruit_SSD1306 *ssd1306_adafruit_display;
   static Adafruit_SSD1305 *ssd1305_adafruit_display;
   static U8G2_SSD1306_128X64_NONAME_F_SW_I2C *ssd1306_ideaspark_display;
@@ -0,0 +1,174 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * epoch.cpp: keeps track of what happened each epoch and times the next one
+ */
+
+#include "epoch.h"
+
+/** developer note:
+ *
+ * this is our take on the pwnagotchi's automata/epoch tracking, see:
+ *
+ * https://github.com/evilsocket/pwnagotchi/blob/master/pwnagotchi/ai/epoch.py
+ * https://github.com/evilsocket/pwnagotchi/blob/master/pwnagotchi/automata.py
+ *
+ * the timing values Config randomizes are the same ones a pwnagotchi uses:
+ *
+ * hop_recon_time: how long we listen on a channel by default
+ * recon_time: how long we listen on a channel that had something going on
+ * min_recon_time: the shortest we'll ever listen on a channel
+ * max_inactive_scale: how far a dead channel's dwell gets halved, and how many
+ * inactive epochs before we start backing off
+ * recon_inactive_multiplier: how much longer we listen once we're backing off
+ * max_misses_for_recon: misses in a row before we do one long recon
+ *
+ */
+
+int Epoch::inactiveFor = 0;
+int Epoch::activeFor = 0;
+int Epoch::boredFor = 0;
+int Epoch::sadFor = 0;
+int Epoch::missed = 0;
+bool Epoch::recon = false;
+
+volatile bool Epoch::didPeer = false;
+bool Epoch::didDeauth = false;
+bool Epoch::didMiss = false;
+
+// per channel, index is the channel number
+volatile bool Epoch::heard[15] = {false};
+bool Epoch::hot[15] = {false};
+int Epoch::idle[15] = {0};
+
+void Epoch::track(epoch_event_t event) { Epoch::track(event, 0); }
+
+// this gets called from the promiscuous callback too, so keep it cheap
+void Epoch::track(epoch_event_t event, int channel) {
+  switch (event) {
+  case EPOCH_PEER:
+    Epoch::didPeer = true;
+    if (channel > 0 && channel < 15) {
+      Epoch::heard[channel] = true;
+    }
+    break;
+  case EPOCH_DEAUTH:
+    Epoch::didDeauth = true;
+    break;
+  case EPOCH_MISS:
+    Epoch::didMiss = true;
+    break;
+  }
+}
+
+// done listening on a channel, remember if it was worth it
+void Epoch::visit(int channel) {
+  if (channel <= 0 || channel >= 15) {
+    return;
+  }
+
+  if (Epoch::heard[channel]) {
+    Epoch::hot[channel] = true;
+    Epoch::idle[channel] = 0;
+  } else {
+    Epoch::hot[channel] = false;
+    Epoch::idle[channel]++;
+  }
+
+  Epoch::heard[channel] = false;
+}
+
+// how long(ms) we should listen on this channel
+int Epoch::dwell(int channel) {
+  int dwell = Config::hop_recon_time * 1000;
+
+  if (Epoch::recon) {
+    // too many misses, take a good long look around
+    dwell = Config::recon_time * 1000;
+  } else if (channel > 0 && channel < 15) {
+    if (Epoch::hot[channel]) {
+      // something was here last time, stick around
+      dwell = max(dwell, Config::recon_time * 1000);
+    } else {
+      // halve it for every visit nothing showed up
+      dwell >>= min(Epoch::idle[channel], Config::max_inactive_scale);
+    }
+  }
+
+  // busier channels get more of our time, see Channel::share()
+  dwell = dwell * Channel::share(channel) / 100;
+
+  // nothing has happened in a while, slow down like the pwnagotchi does
+  if (Epoch::inactiveFor >= Config::max_inactive_scale) {
+    dwell *= Config::recon_inactive_multiplier;
+  }
+
+  return max(dwell, Config::min_recon_time * 1000);
+}
+
+void Epoch::next() {
+  bool active = Epoch::didPeer || Epoch::didDeauth;
+
+  if (active) {
+    Epoch::activeFor++;
+    Epoch::inactiveFor = 0;
+    Epoch::boredFor = 0;
+    Epoch::sadFor = 0;
+  } else {
+    Epoch::activeFor = 0;
+    Epoch::inactiveFor++;
+  }
+
+  if (Epoch::inactiveFor >= Config::sad_num_epochs) {
+    Epoch::sadFor++;
+    Epoch::boredFor = 0;
+  } else if (Epoch::inactiveFor >= Config::bored_num_epochs) {
+    Epoch::boredFor++;
+    Epoch::sadFor = 0;
+  }
+
+  // only one long recon, then back to hopping
+  Epoch::recon = false;
+  if (Epoch::didMiss) {
+    Epoch::missed++;
+    if (Epoch::missed > Config::max_misses_for_recon) {
+      Epoch::recon = true;
+      Epoch::missed = 0;
+    }
+  } else {
+    Epoch::missed = 0;
+  }
+
+  // update what we advertise
+  if (Epoch::sadFor > 0) {
+    Config::face = Config::sad.c_str();
+  } else if (Epoch::boredFor > 0) {
+    Config::face = Config::sleeping.c_str();
+  } else if (Epoch::activeFor >= Config::excited_num_epochs) {
+    Config::face = Config::intense.c_str();
+  } else {
+    Config::face = Config::happy.c_str();
+  }
+  Config::epoch = Minigotchi::currentEpoch;
+  Config::uptime = millis() / 1000;
+
+  Epoch::didPeer = false;
+  Epoch::didDeauth = false;
+  Epoch::didMiss = false;
+}
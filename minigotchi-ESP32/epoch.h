@@ -0,0 +1,59 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * epoch.h: header files for epoch.cpp
+ */
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include "config.h"
+#include "minigotchi.h"
+#include <Arduino.h>
+
+typedef enum {
+  EPOCH_PEER = 0,
+  EPOCH_DEAUTH = 1,
+  EPOCH_MISS = 2,
+} epoch_event_t;
+
+class Epoch {
+public:
+  static void track(epoch_event_t event);
+  static void track(epoch_event_t event, int channel);
+  static void visit(int channel);
+  static void next();
+  static int dwell(int channel);
+  static int inactiveFor;
+  static int activeFor;
+  static int boredFor;
+  static int sadFor;
+  static int missed;
+  static bool recon;
+
+private:
+  static volatile bool didPeer;
+  static bool didDeauth;
+  static bool didMiss;
+  static volatile bool heard[15];
+  static bool hot[15];
+  static int idle[15];
+};
+
+#endif // EPOCH_H
@@ -36,14 +36,56 @@
  */
 
 // initializing
-size_t Frame::payloadSize = 255; // by default
 const size_t Frame::chunkSize = 0xFF;
 
+/** developer note:
+ *
+ * the beacon used to be new[]'d on every pack, which chews up the heap over a
+ * long session. now there's one buffer sized for the biggest payload we allow
+ * and every beacon gets built in it, frameLength is how much of it is used.
+ *
+ */
+
 // beacon stuff
-uint8_t *Frame::Frame::beaconFrame = nullptr;
+uint8_t Frame::beaconFrame[FRAME_BUFFER_LENGTH];
+char Frame::payload[FRAME_PAYLOAD_MAX + 1];
+uint8_t Frame::compressed[FRAME_PAYLOAD_MAX];
+bool Frame::deflated = false;
+size_t Frame::rawLength = 0;
+uint8_t Frame::signature[IDENTITY_SIGNATURE_LENGTH];
+size_t Frame::signedLength = 0;
+size_t Frame::frameLength = 0;
 size_t Frame::essidLength = 0;
 uint8_t Frame::headerLength = 0;
 
+// same layout as pack.go, a chunk is at most 255 bytes and each one gets its
+// own 0xDE id and length
+static_assert(FRAME_LENGTH(1) == FRAME_HEADER_LENGTH + 3, "one short chunk");
+static_assert(FRAME_LENGTH(255) == FRAME_HEADER_LENGTH + 257, "one full chunk");
+static_assert(FRAME_LENGTH(256) == FRAME_HEADER_LENGTH + 260, "two chunks");
+static_assert(FRAME_SIGNED_LENGTH == 2 + 32 + 257 + 3,
+              "fingerprint and a two chunk signature");
+static_assert(FRAME_BUFFER_LENGTH <= FRAME_TX_MAX,
+              "FRAME_PAYLOAD_MAX doesn't fit in one signed frame");
+
+// advertisment state
+advertise_state_t Frame::state = ADVERTISE_START;
+int Frame::sent = 0;
+int Frame::packets = 0;
+
+// tx times of the last few beacons, see Frame::due()
+int64_t Frame::completions[FRAME_METER_WINDOW];
+int Frame::metered = 0;
+int64_t Frame::failedAt = 0; // the last one the driver couldn't send, 0 if none
+portMUX_TYPE Frame::meterLock = portMUX_INITIALIZER_UNLOCKED;
+
+// a beacon the driver hasn't reported back on yet
+volatile bool Frame::inFlight = false;
+
+// what the cached beacon was packed with
+beacon_fields_t Frame::packed = {};
+bool Frame::stale = true;
+
 // payload ID's according to pwngrid
 const uint8_t Frame::IDWhisperPayload = 0xDE;
 const uint8_t Frame::IDWhisperCompression = 0xDF;
@@ -97,14 +139,17 @@ const uint8_t Frame::header[]{
 
 // get header length
 const int Frame::pwngridHeaderLength = sizeof(Frame::header);
+static_assert(sizeof(Frame::header) == FRAME_HEADER_LENGTH,
+              "FRAME_HEADER_LENGTH is out of date");
 
 /** developer note:
  *
  * frame structure based on how it was built here
  *
  * 1. header
- * 2. payload id's
- * 3. (chunked) pwnagotchi data
+ * 2. identity and (chunked) signature, if we sign
+ * 3. payload id's
+ * 4. (chunked) pwnagotchi data
  *
  */
 
@@ -116,11 +161,82 @@ const int Frame::pwngridHeaderLength = sizeof(Frame::header);
  *
  */
 
+/** developer note:
+ *
+ * the json is always the same keys in the same order, only epoch, face,
+ * pwnd_run, pwnd_tot and uptime ever change. so it gets put together with
+ * ArduinoJson once, with those five left as fixed width slots, and laid out
+ * in beaconFrame with the 0xDE chunk headers already in place. packing a
+ * beacon after that is just writing the five values into their slots, padded
+ * with spaces(json doesn't care about whitespace between a value and the next
+ * comma).
+ *
+ * anything the template can't handle(a face that doesn't fit, or has to be
+ * escaped) goes through the old ArduinoJson path instead. send "bench pack"
+ * over serial to time both and check they come out the same.
+ *
+ */
+
+// json key and width of each slot, same order as beacon_slot_id_t
+beacon_slot_t Frame::slots[SLOT_COUNT] = {
+    {"\"epoch\":", 0, FRAME_SLOT_NUMBER},
+    {"\"face\":", 0, FRAME_SLOT_FACE + 2},
+    {"\"pwnd_run\":", 0, FRAME_SLOT_NUMBER},
+    {"\"pwnd_tot\":", 0, FRAME_SLOT_NUMBER},
+    {"\"uptime\":", 0, FRAME_SLOT_NUMBER},
+};
+bool Frame::compiled = false;
+
+// builds the beacon in beaconFrame, nullptr if the json is too big to send
 uint8_t *Frame::pack() {
-  // make a json doc
-  String jsonString = "";
-  DynamicJsonDocument doc(2048);
+  if (!Frame::compose()) {
+    return nullptr;
+  }
 
+  Frame::sign();
+  Frame::squeeze();
+  return Frame::beaconFrame;
+}
+
+// just the json, laid out raw in beaconFrame. no signature, no compression
+bool Frame::compose() {
+  // remember what this beacon was built from
+  Frame::packed.epoch = Config::epoch;
+  Frame::packed.face = Config::face;
+  Frame::packed.pwnd_run = Config::pwnd_run;
+  Frame::packed.pwnd_tot = Config::pwnd_tot;
+  Frame::packed.uptime = Config::uptime;
+  Frame::stale = false;
+
+  if (!Frame::compiled && !Frame::compile()) {
+    return Frame::composeJson();
+  }
+
+  // faces are plain ascii, anything that would need escaping takes the slow
+  // path
+  const std::string &face = Config::face;
+  if (face.length() > FRAME_SLOT_FACE ||
+      face.find_first_of("\"\\") != std::string::npos) {
+    Frame::compiled = false;
+    return Frame::composeJson();
+  }
+
+  char text[FRAME_SLOT_FACE + 3];
+  snprintf(text, sizeof(text), "%d", Config::epoch);
+  Frame::patch(SLOT_EPOCH, text);
+  snprintf(text, sizeof(text), "\"%s\"", face.c_str());
+  Frame::patch(SLOT_FACE, text);
+  snprintf(text, sizeof(text), "%d", Config::pwnd_run);
+  Frame::patch(SLOT_PWND_RUN, text);
+  snprintf(text, sizeof(text), "%d", Config::pwnd_tot);
+  Frame::patch(SLOT_PWND_TOT, text);
+  snprintf(text, sizeof(text), "%d", Config::uptime);
+  Frame::patch(SLOT_UPTIME, text);
+  return true;
+}
+
+// the whole advertisment, the way pwngrid wants it
+void Frame::build(JsonDocument &doc) {
   doc["epoch"] = Config::epoch;
   doc["face"] = Config::face;
   doc["identity"] = Config::identity;
@@ -133,9 +249,8 @@ uint8_t *Frame::pack() {
   policy["bored_num_epochs"] = Config::bored_num_epochs;
 
   JsonArray channels = policy.createNestedArray("channels");
-  for (size_t i = 0; i < sizeof(Config::channels) / sizeof(Config::channels[0]);
-       ++i) {
-    channels.add(Config::channels[i]);
+  for (int i = 0; i < Channel::numChannels; ++i) {
+    channels.add(Channel::channelList[i]);
   }
 
   policy["deauth"] = Config::deauth;
@@ -156,49 +271,110 @@ uint8_t *Frame::pack() {
   doc["session_id"] = Config::session_id;
   doc["uptime"] = Config::uptime;
   doc["version"] = Config::version;
+}
+
+// the old way, ArduinoJson for the whole thing every time
+bool Frame::composeJson() {
+  DynamicJsonDocument doc(2048);
+  Frame::build(doc);
 
   // serialize then put into beacon frame
-  serializeJson(doc, jsonString);
-  Frame::essidLength = measureJson(doc);
-  Frame::headerLength = 2 + ((uint8_t)(essidLength / 255) * 2);
-  Frame::beaconFrame = new uint8_t[Frame::pwngridHeaderLength +
-                                   Frame::essidLength + Frame::headerLength];
+  if (measureJson(doc) > FRAME_PAYLOAD_MAX) {
+    Serial.println("(X-X) Advertisment is too big to send!");
+    Frame::frameLength = 0;
+    return false;
+  }
+
+  Frame::essidLength =
+      serializeJson(doc, Frame::payload, sizeof(Frame::payload));
+  Frame::layout((const uint8_t *)Frame::payload, Frame::essidLength, false);
+  return true;
+}
+
+// lay the json out with placeholders in the slots and remember where they are
+bool Frame::compile() {
+  DynamicJsonDocument doc(2048);
+  Frame::build(doc);
+
+  // the quotes around a placeholder are part of the slot too
+  std::string number(FRAME_SLOT_NUMBER - 2, '#');
+  std::string face(FRAME_SLOT_FACE, '#');
+  doc["epoch"] = number;
+  doc["face"] = face;
+  doc["pwnd_run"] = number;
+  doc["pwnd_tot"] = number;
+  doc["uptime"] = number;
+
+  if (measureJson(doc) > FRAME_PAYLOAD_MAX) {
+    return false;
+  }
+
+  size_t length = serializeJson(doc, Frame::payload, sizeof(Frame::payload));
+  for (int i = 0; i < SLOT_COUNT; i++) {
+    const char *key = strstr(Frame::payload, Frame::slots[i].key);
+    if (key == nullptr) {
+      return false;
+    }
+    Frame::slots[i].offset =
+        key - Frame::payload + strlen(Frame::slots[i].key);
+  }
+
+  Frame::essidLength = length;
+  Frame::layout((const uint8_t *)Frame::payload, length, false);
+  Frame::compiled = true;
+  return true;
+}
+
+// copy a payload into beaconFrame, chunk headers and all
+void Frame::layout(const uint8_t *data, size_t length, bool deflated) {
+  Frame::signedLength =
+      Config::sign && Identity::ready() ? FRAME_SIGNED_LENGTH : 0;
+  Frame::headerLength = FRAME_CHUNKED(length) - length + Frame::signedLength;
+  Frame::frameLength = FRAME_LENGTH(length) + Frame::signedLength;
+  Frame::deflated = deflated;
   memcpy(Frame::beaconFrame, Frame::header, Frame::pwngridHeaderLength);
+  Frame::stamp();
 
   /** developer note:
    *
    * if you literally want to check the json everytime you send a packet(non
    * serialized ofc)
    *
-   * Serial.println(jsonString);
+   * Serial.println(Frame::payload);
    */
 
-  int currentByte = pwngridHeaderLength;
+  int currentByte = pwngridHeaderLength + Frame::signedLength;
+
+  // compressed payloads get flagged before the first chunk, like pack.go
+  if (deflated) {
+    Frame::beaconFrame[currentByte++] = Frame::IDWhisperCompression;
+    Frame::beaconFrame[currentByte++] = 1;
+    Frame::beaconFrame[currentByte++] = 1;
+    Frame::headerLength += 3;
+    Frame::frameLength += 3;
+  }
 
-  for (int i = 0; i < Frame::essidLength; i++) {
-    if (i == 0 || i % 255 == 0) {
+  for (size_t i = 0; i < length; i++) {
+    if (i % Frame::chunkSize == 0) {
       Frame::beaconFrame[currentByte++] = Frame::IDWhisperPayload;
-      if (Frame::essidLength - i < Frame::chunkSize) {
-        Frame::payloadSize = Frame::essidLength - i;
-      }
-      Frame::beaconFrame[currentByte++] = Frame::payloadSize;
+      Frame::beaconFrame[currentByte++] = min(length - i, Frame::chunkSize);
     }
 
-    uint8_t nextByte = (uint8_t)'?';
-    if (isAscii(jsonString[i])) {
-      nextByte = (uint8_t)jsonString[i];
+    // json is ascii only, compressed data is whatever it is
+    uint8_t nextByte = data[i];
+    if (!deflated && !isAscii(data[i])) {
+      nextByte = (uint8_t)'?';
     }
 
     Frame::beaconFrame[currentByte++] = nextByte;
   }
 
-  return Frame::beaconFrame;
   /** developer note:
    *
    * we can print the beacon frame like so...
    *
    * Serial.println("('-') Full Beacon Frame:");
-   * for (size_t i = 0; i < Frame::beaconFrame.size(); ++i) {
+   * for (size_t i = 0; i < Frame::frameLength; ++i) {
    *     Serial.print(Frame::beaconFrame[i], HEX);
    *     Serial.print(" ");
    * }
@@ -207,58 +383,535 @@ uint8_t *Frame::pack() {
    */
 }
 
-bool Frame::send() {
-  // build frame
-  uint8_t *frame = Frame::pack();
+/** developer note:
+ *
+ * pwngrid can deflate the json(see deflate.cpp) and mark it with a 0xDF
+ * element, our json usually shrinks by a good chunk which is less airtime for
+ * every single beacon. we only send it compressed if that actually makes the
+ * frame smaller, Config::compress turns it off completely.
+ *
+ */
+
+// compress the json if that makes the beacon smaller
+void Frame::squeeze() {
+  Frame::rawLength = FRAME_LENGTH(Frame::essidLength) + Frame::signedLength;
+
+  if (Config::compress) {
+    size_t length =
+        Deflate::compress((const uint8_t *)Frame::payload, Frame::essidLength,
+                          Frame::compressed, sizeof(Frame::compressed));
+    if (length > 0 &&
+        FRAME_LENGTH(length) + Frame::signedLength + 3 < Frame::rawLength) {
+      Frame::layout(Frame::compressed, length, true);
+      return;
+    }
+  }
+
+  // patch() only touches the raw layout, so put that back if it's gone
+  if (Frame::deflated) {
+    Frame::layout((const uint8_t *)Frame::payload, Frame::essidLength, false);
+  }
+}
+
+/** developer note:
+ *
+ * a real pwnagotchi puts its identity(0xE0) and a signature of the json(0xE1)
+ * in front of the payload, see identity.cpp. an RSA signature costs way more
+ * than packing does, so it only gets worked out when pack() runs, which is
+ * when the json has actually changed, and sits in beaconFrame next to the
+ * payload until the next one. a 2048 bit signature is one byte too long for
+ * a single element, so it gets chunked the same way the payload does. send
+ * "bench sign" over serial to see what it costs.
+ *
+ */
 
-  // send full frame
-  // we dont use raw80211 since it sends a header(which we don't need), although
-  // we do use it for monitoring, etc.
-  delay(102);
-  esp_err_t err = esp_wifi_80211_tx(WIFI_IF_STA, frame, sizeof(frame), false);
+// sign the raw json, compressed or not that's what peers end up reading
+void Frame::sign() {
+  if (Frame::signedLength == 0) {
+    return;
+  }
 
-  delete[] frame;
-  return (err == ESP_OK);
+  if (!Identity::sign((const uint8_t *)Frame::payload, Frame::essidLength,
+                      Frame::signature)) {
+    // better a signature that won't check out than the last payload's
+    Serial.println("(X-X) Couldn't sign advertisment!");
+    memset(Frame::signature, 0, sizeof(Frame::signature));
+  }
+  Frame::stamp();
 }
 
-void Frame::advertise() {
-  int packets = 0;
-  unsigned long startTime = millis();
+// write the identity and signature elements in after the header
+void Frame::stamp() {
+  if (Frame::signedLength == 0) {
+    return;
+  }
+
+  int currentByte = pwngridHeaderLength;
+  Frame::beaconFrame[currentByte++] = Frame::IDWhisperIdentity;
+  Frame::beaconFrame[currentByte++] = IDENTITY_FINGERPRINT_LENGTH;
+  memcpy(Frame::beaconFrame + currentByte, Identity::fingerprint(),
+         IDENTITY_FINGERPRINT_LENGTH);
+  currentByte += IDENTITY_FINGERPRINT_LENGTH;
+
+  for (size_t i = 0; i < IDENTITY_SIGNATURE_LENGTH; i += Frame::chunkSize) {
+    size_t chunk = min(IDENTITY_SIGNATURE_LENGTH - i, Frame::chunkSize);
+    Frame::beaconFrame[currentByte++] = Frame::IDWhisperSignature;
+    Frame::beaconFrame[currentByte++] = chunk;
+    memcpy(Frame::beaconFrame + currentByte, Frame::signature + i, chunk);
+    currentByte += chunk;
+  }
+}
+
+// how much smaller compression made the beacon, and how much time that saves
+// on air for every beacon at 1 Mbps(8 us a byte)
+void Frame::report() {
+  if (Frame::rawLength == 0) {
+    return;
+  }
+
+  Serial.printf("('-') Beacon is %u bytes, %u uncompressed (%u%%)\n",
+                (unsigned)Frame::frameLength, (unsigned)Frame::rawLength,
+                (unsigned)(Frame::frameLength * 100 / Frame::rawLength));
+  Serial.printf("('-') Compression saves %u us of airtime per beacon\n",
+                (unsigned)((Frame::rawLength - Frame::frameLength) * 8));
+}
+
+// write text into a slot, space padded, skipping over any chunk header in the
+// way
+void Frame::patch(beacon_slot_id_t id, const char *text) {
+  const beacon_slot_t &slot = Frame::slots[id];
+  size_t length = strlen(text);
+
+  for (size_t i = 0; i < slot.width; i++) {
+    size_t at = slot.offset + i;
+    char c = i < length ? text[i] : ' ';
+    if (!isAscii(c)) {
+      c = '?';
+    }
+    Frame::payload[at] = c;
+    Frame::beaconFrame[FRAME_HEADER_LENGTH + Frame::signedLength + at +
+                       2 * (at / Frame::chunkSize + 1)] = c;
+  }
+}
+
+/** developer note:
+ *
+ * packing used to happen for every single beacon, that's a json document,
+ * a String and a new buffer 150 times per advertisment for what's almost
+ * always the same bytes. now the packed beacon is kept around and only
+ * rebuilt when one of the fields that actually change does, which is about
+ * once an epoch. each rebuild is timed as "pack" in the stats, send
+ * "bench pack" over serial to compare packing every beacon against the cache.
+ *
+ */
+
+// has anything in the beacon changed since we last packed it?
+bool Frame::dirty() {
+  return Frame::stale || Frame::frameLength == 0 ||
+         Frame::packed.epoch != Config::epoch ||
+         Frame::packed.face != Config::face ||
+         Frame::packed.pwnd_run != Config::pwnd_run ||
+         Frame::packed.pwnd_tot != Config::pwnd_tot ||
+         Frame::packed.uptime != Config::uptime;
+}
+
+// force a re-pack on the next beacon, template and all
+void Frame::invalidate() {
+  Frame::stale = true;
+  Frame::compiled = false;
+}
+
+hal_tx_result_t Frame::send() {
+  // build frame, only if we have to
+  if (Frame::dirty()) {
+    int64_t started = Stats::now();
+    Frame::pack();
+    Stats::since(STAT_PACK, started);
+  }
 
-  if (Config::advertise) {
+  if (Frame::frameLength == 0) {
+    return HAL_TX_FAILED;
+  }
+
+  // send full frame, every byte of it
+  // pacing between frames is handled by advertise(), see Frame::due()
+  Frame::inFlight = true;
+  hal_tx_result_t result = Hal::submit(Frame::beaconFrame, Frame::frameLength,
+                                       false, Frame::done);
+  if (result != HAL_TX_QUEUED) {
+    Frame::inFlight = false;
+  }
+  return result;
+}
+
+// the driver is done with our beacon, runs in the wifi task
+void Frame::done(bool sent, int64_t at) {
+  if (sent) {
+    Frame::meter(at);
+  } else {
+    portENTER_CRITICAL(&Frame::meterLock);
+    Frame::failedAt = at;
+    portEXIT_CRITICAL(&Frame::meterLock);
+  }
+  Frame::inFlight = false;
+}
+
+/** developer note:
+ *
+ * the json is what gets built for every beacon if nothing is cached, so that's
+ * what the three ways are compared on. signing and compressing happen once per
+ * rebuild whichever way the json was made, they're timed on their own
+ * afterwards(an RSA signature is a good 100 ms, 150 of them in a row would
+ * have the radio task sitting here for half a minute).
+ *
+ */
+
+bool Frame::benchmark() {
+  const int beacons = 150;
+  const int stages = 4;
+  uint32_t freeHeap = ESP.getFreeHeap();
+  static char reference[FRAME_PAYLOAD_MAX + 1];
+
+  // oldest way, ArduinoJson for every beacon
+  int64_t started = Stats::now();
+  for (int i = 0; i < beacons; i++) {
+    Frame::composeJson();
+  }
+  uint32_t json = (uint32_t)(Stats::now() - started);
+  memcpy(reference, Frame::payload, sizeof(reference));
+
+  // patch the template for every beacon
+  Frame::invalidate();
+  started = Stats::now();
+  for (int i = 0; i < beacons; i++) {
+    Frame::compose();
+  }
+  uint32_t patched = (uint32_t)(Stats::now() - started);
+
+  // new way, pack once and reuse it
+  Frame::invalidate();
+  started = Stats::now();
+  for (int i = 0; i < beacons; i++) {
+    if (Frame::dirty()) {
+      Frame::compose();
+    }
+  }
+  uint32_t cached = (uint32_t)(Stats::now() - started);
+  bool same = Frame::matches(reference, Frame::payload);
+
+  // what a rebuild costs on top of the json
+  uint32_t signing = 0;
+  uint32_t squeezing = 0;
+  for (int i = 0; i < stages; i++) {
+    started = Stats::now();
+    Frame::sign();
+    signing += (uint32_t)(Stats::now() - started);
+
+    started = Stats::now();
+    Frame::squeeze();
+    squeezing += (uint32_t)(Stats::now() - started);
+    Frame::compose();
+  }
+
+  Serial.printf("('-') ArduinoJson every beacon: %u us/beacon\n",
+                (unsigned)(json / beacons));
+  Serial.printf("('-') Template every beacon: %u us/beacon\n",
+                (unsigned)(patched / beacons));
+  Serial.printf("('-') Cached beacon: %u us/beacon\n",
+                (unsigned)(cached / beacons));
+  if (Frame::signedLength > 0) {
+    Serial.printf("('-') Signing: %u us per rebuild\n",
+                  (unsigned)(signing / stages));
+  } else {
+    Serial.println("('-') Signing: off");
+  }
+  Serial.printf("('-') Compressing: %u us per rebuild\n",
+                (unsigned)(squeezing / stages));
+  Serial.printf("('-') Free heap %u -> %u\n", (unsigned)freeHeap,
+                (unsigned)ESP.getFreeHeap());
+
+  // a whole beacon again, signed and compressed like the real thing
+  Frame::invalidate();
+  Frame::pack();
+  Frame::report();
+  Serial.println(same ? "('-') Template matches ArduinoJson"
+                      : "(X-X) Template doesn't match ArduinoJson!");
+  Serial.println(" ");
+  return same;
+}
+
+// sign a few versions of the advertisment, the way an epoch's worth of uptime
+// changes it
+void Frame::benchmarkSign() {
+  if (!Identity::ready()) {
+    Serial.println("(X-X) No key to sign with, is Config::sign on?");
+    Serial.println(" ");
+    return;
+  }
+
+  const int versions = 8;
+  int uptime = Config::uptime;
+  uint32_t total = 0;
+  uint32_t slowest = 0;
+
+  for (int i = 0; i < versions; i++) {
+    Config::uptime = uptime + i + 1;
+
+    // just the json, pack() would sign it as well
+    int64_t started = Stats::now();
+    Frame::compose();
+    uint32_t composed = (uint32_t)(Stats::now() - started);
+
+    started = Stats::now();
+    Identity::sign((const uint8_t *)Frame::payload, Frame::essidLength,
+                   Frame::signature);
+    uint32_t signing = (uint32_t)(Stats::now() - started);
+    total += signing;
+    slowest = max(slowest, signing);
+
+    Serial.printf("('-') Version %d: %u byte payload, signed in %u us, "
+                  "composed in %u us\n",
+                  i + 1, (unsigned)Frame::essidLength, (unsigned)signing,
+                  (unsigned)composed);
+  }
+
+  // put the real one back
+  Config::uptime = uptime;
+  Frame::invalidate();
+
+  uint32_t average = total / versions;
+  Serial.printf("('-') Signing: %u us avg, %u us max per payload version\n",
+                (unsigned)average, (unsigned)slowest);
+  Serial.printf("('-') Cached over %d beacons: %u us/beacon, every beacon "
+                "would be %u us/beacon\n",
+                Config::beaconCount,
+                (unsigned)(average / max(1, Config::beaconCount)),
+                (unsigned)average);
+  Serial.println(" ");
+}
+
+// same json once the padding outside of strings is ignored?
+bool Frame::matches(const char *json, const char *padded) {
+  bool quoted = false;
+  bool escaped = false;
+  while (*padded != '\0') {
+    if (!quoted && *padded == ' ') {
+      padded++;
+      continue;
+    }
+
+    if (*json != *padded) {
+      return false;
+    }
+
+    if (escaped) {
+      escaped = false;
+    } else if (*padded == '\\') {
+      escaped = true;
+    } else if (*padded == '"') {
+      quoted = !quoted;
+    }
+    json++;
+    padded++;
+  }
+
+  return *json == '\0';
+}
+
+/** developer note:
+ *
+ * beacons are paced by when they actually went out, not by a fixed wait. the
+ * last few tx times are kept in a small window and the next beacon is due once
+ * the window averages out to the interval we want(Config::beaconInterval, or
+ * Config::beaconRate if that's set). time spent on serial and the display
+ * then just comes out of the next wait instead of slowing everything down.
+ * a beacon the driver failed to send doesn't count towards the rate, but the
+ * next one still waits a whole interval after it.
+ *
+ * once the next beacon wouldn't go out before the phase's budget is up we stop
+ * right there, the channel is about to change anyway. send "beacon" over
+ * serial to see the settings, "beacon interval <ms>", "beacon rate <pps>" or
+ * "beacon count <n>" change them until the next reboot.
+ *
+ */
+
+// time we want between beacons, us
+int64_t Frame::gap() {
+  if (Config::beaconRate > 0) {
+    return 1000000 / Config::beaconRate;
+  }
+  return (int64_t)Config::beaconInterval * 1000;
+}
+
+// a beacon made it out
+void Frame::meter(int64_t at) {
+  portENTER_CRITICAL(&Frame::meterLock);
+  Frame::completions[Frame::metered % FRAME_METER_WINDOW] = at;
+  Frame::metered++;
+  portEXIT_CRITICAL(&Frame::meterLock);
+}
+
+// beacons per second over the window
+float Frame::pps() {
+  portENTER_CRITICAL(&Frame::meterLock);
+  int count = min(Frame::metered, FRAME_METER_WINDOW);
+  int64_t newest =
+      Frame::completions[(Frame::metered + FRAME_METER_WINDOW - 1) %
+                         FRAME_METER_WINDOW];
+  int64_t oldest =
+      Frame::completions[(Frame::metered - count) % FRAME_METER_WINDOW];
+  portEXIT_CRITICAL(&Frame::meterLock);
+
+  if (count < 2 || newest == oldest) {
+    return 0;
+  }
+  return (count - 1) * 1000000.0f / (newest - oldest);
+}
+
+// when the next beacon should go out, 0 for right away
+int64_t Frame::due() {
+  portENTER_CRITICAL(&Frame::meterLock);
+  int count = min(Frame::metered, FRAME_METER_WINDOW);
+  int64_t newest =
+      Frame::completions[(Frame::metered + FRAME_METER_WINDOW - 1) %
+                         FRAME_METER_WINDOW];
+  int64_t oldest =
+      Frame::completions[(Frame::metered - count) % FRAME_METER_WINDOW];
+  int64_t failedAt = Frame::failedAt;
+  portEXIT_CRITICAL(&Frame::meterLock);
+
+  // a beacon the driver couldn't send still waits out a whole gap, or a
+  // failing driver would get them back to back
+  int64_t retry = failedAt != 0 ? failedAt + Frame::gap() : 0;
+  if (count == 0) {
+    return retry;
+  }
+
+  // catch up if we've fallen behind, but never back to back
+  return max(max(oldest + count * Frame::gap(), newest + Frame::gap() / 4),
+             retry);
+}
+
+static const bool registered = Commands::add(Frame::command);
+
+bool Frame::command(const String &line) {
+  if (line == "bench pack") {
+    Frame::benchmark();
+    return true;
+  } else if (line == "bench sign") {
+    Frame::benchmarkSign();
+    return true;
+  } else if (line.startsWith("beacon interval ")) {
+    Config::beaconInterval = max(1L, line.substring(16).toInt());
+    Config::beaconRate = 0;
+  } else if (line.startsWith("beacon rate ")) {
+    Config::beaconRate = max(0L, line.substring(12).toInt());
+  } else if (line.startsWith("beacon count ")) {
+    Config::beaconCount = max(0L, line.substring(13).toInt());
+  } else if (line != "beacon") {
+    return false;
+  }
+
+  Serial.printf("('-') Beacons: every %u us, up to %d per advertisment\n",
+                (unsigned)Frame::gap(), Config::beaconCount);
+  Serial.print("('-') Last advertisment: ");
+  Serial.print(Frame::pps());
+  Serial.println(" pkt/s");
+  Serial.println(" ");
+  return true;
+}
+
+long Frame::advertise() {
+  if (!Config::advertise) {
+    // do nothing but still idle
+    return TASK_DONE;
+  }
+
+  switch (Frame::state) {
+  case ADVERTISE_START:
     Serial.println("(>-<) Starting advertisment...");
     Serial.println(" ");
     Display::updateDisplay("(>-<)", "Starting advertisment...");
     Parasite::sendAdvertising();
-    delay(Config::shortDelay);
-    for (int i = 0; i < 150; ++i) {
-      if (Frame::send()) {
-        packets++;
-
-        // calculate packets per second
-        float pps = packets / (float)(millis() - startTime) * 1000;
-
-        // show pps
-        if (!isinf(pps)) {
-          Serial.print("(>-<) Packets per second: ");
-          Serial.print(pps);
-          Serial.print(" pkt/s (Channel: ");
-          Serial.print(Channel::getChannel());
-          Serial.println(")");
-          Display::updateDisplay(
-              "(>-<)", "Packets per second: " + (String)pps + " pkt/s" +
-                           " (Channel: " + (String)Channel::getChannel() + ")");
-        }
-      } else {
-        Serial.println("(X-X) Advertisment failed to send!");
+    Frame::sent = 0;
+    Frame::packets = 0;
+    portENTER_CRITICAL(&Frame::meterLock);
+    Frame::metered = 0;
+    Frame::failedAt = 0;
+    portEXIT_CRITICAL(&Frame::meterLock);
+    Frame::state = ADVERTISE_SENDING;
+    return Scheduler::interval();
+
+  case ADVERTISE_SENDING: {
+    // one beacon per step until we run out of beacons or time
+    if (Frame::sent >= Config::beaconCount || Scheduler::expired()) {
+      return Frame::finish();
+    }
+
+    // the last one's still with the driver, pacing goes by when it's done
+    if (Frame::inFlight && Hal::txPending() > 0) {
+      return 1;
+    }
+
+    int64_t now = Stats::now();
+    int64_t due = Frame::due();
+    if (due > now) {
+      unsigned long wait = (due - now + 999) / 1000;
+
+      // we'd be off this channel before it goes out
+      if (Scheduler::elapsed() + wait >= (unsigned long)Scheduler::budget()) {
+        return Frame::finish();
       }
+      return wait;
     }
 
-    Serial.println(" ");
-    Serial.println("(^-^) Advertisment finished!");
-    Serial.println(" ");
-    Display::updateDisplay("(^-^)", "Advertisment finished!");
-  } else {
-    // do nothing but still idle
+    hal_tx_result_t result = Frame::send();
+    if (result == HAL_TX_BUSY) {
+      // the driver's backed up, give it a moment
+      return 1;
+    }
+
+    Frame::sent++;
+    if (result == HAL_TX_QUEUED) {
+      Frame::packets++;
+
+      // calculate packets per second
+      float pps = Frame::pps();
+
+      // show pps
+      if (pps > 0) {
+        Serial.print("(>-<) Packets per second: ");
+        Serial.print(pps);
+        Serial.print(" pkt/s (Channel: ");
+        Serial.print(Channel::getChannel());
+        Serial.println(")");
+        Display::updateDisplay(
+            "(>-<)", "Packets per second: " + (String)pps + " pkt/s" +
+                         " (Channel: " + (String)Channel::getChannel() + ")");
+      }
+    } else {
+      Serial.println("(X-X) Advertisment failed to send!");
+
+      // nothing went out, so back off a whole interval before trying again
+      return max(1L, (long)(Frame::gap() / 1000));
+    }
+    return 0;
+  }
+  }
+
+  return TASK_DONE;
+}
+
+long Frame::finish() {
+  Frame::state = ADVERTISE_START;
+  Serial.println(" ");
+  Serial.println("(^-^) Advertisment finished!");
+  if (Frame::deflated) {
+    Serial.printf("(^-^) Compression saved %u us of airtime\n",
+                  (unsigned)((Frame::rawLength - Frame::frameLength) * 8 *
+                             Frame::packets));
   }
+  Serial.println(" ");
+  Display::updateDisplay("(^-^)", "Advertisment finished!");
+  return TASK_DONE;
 }
@@ -23,20 +23,89 @@
 #ifndef FRAME_H
 #define FRAME_H
 
+#include "channel.h"
+#include "commands.h"
 #include "config.h"
+#include "deflate.h"
 #include "display.h"
+#include "hal.h"
+#include "identity.h"
 #include "parasite.h"
+#include "scheduler.h"
 #include <ArduinoJson.h>
-#include <esp_wifi.h>
 #include <sstream>
 #include <string>
 #include <vector>
 
+// longest json we'll advertise, pwngrid splits it into 255 byte chunks
+#define FRAME_PAYLOAD_MAX 1024
+
+// beacon header, see Frame::header
+#define FRAME_HEADER_LENGTH 36
+
+// biggest frame esp_wifi_80211_tx() will take
+#define FRAME_TX_MAX 1500
+
+// data split into 255 byte elements, an id and a length byte for every chunk
+#define FRAME_CHUNKED(length) ((length) + 2 * (((length) + 254) / 255))
+
+// header + chunked payload
+#define FRAME_LENGTH(payload) (FRAME_HEADER_LENGTH + FRAME_CHUNKED(payload))
+
+// identity and signature elements in front of a signed payload
+#define FRAME_SIGNED_LENGTH                                                    \
+  (2 + IDENTITY_FINGERPRINT_LENGTH + FRAME_CHUNKED(IDENTITY_SIGNATURE_LENGTH))
+
+// biggest beacon we build, signed and with the compression element
+#define FRAME_BUFFER_LENGTH                                                    \
+  (FRAME_LENGTH(FRAME_PAYLOAD_MAX) + FRAME_SIGNED_LENGTH + 3)
+
+typedef enum {
+  ADVERTISE_START = 0,
+  ADVERTISE_SENDING = 1,
+} advertise_state_t;
+
+// how many beacons the rate meter averages over, see Frame::due()
+#define FRAME_METER_WINDOW 8
+
+// fixed width slots in the json template, see Frame::compile()
+#define FRAME_SLOT_NUMBER 11 // "-2147483648"
+#define FRAME_SLOT_FACE 32   // without the quotes
+
+typedef enum {
+  SLOT_EPOCH = 0,
+  SLOT_FACE = 1,
+  SLOT_PWND_RUN = 2,
+  SLOT_PWND_TOT = 3,
+  SLOT_UPTIME = 4,
+  SLOT_COUNT = 5
+} beacon_slot_id_t;
+
+typedef struct {
+  const char *key;
+  size_t offset;
+  size_t width;
+} beacon_slot_t;
+
+// the parts of the beacon that change while we're running, see Frame::dirty()
+typedef struct {
+  int epoch;
+  std::string face;
+  int pwnd_run;
+  int pwnd_tot;
+  int uptime;
+} beacon_fields_t;
+
 class Frame {
 public:
   static uint8_t *pack();
-  static bool send();
-  static void advertise();
+  static hal_tx_result_t send();
+  static long advertise();
+  static bool command(const String &line);
+  static bool dirty();
+  static void invalidate();
+  static bool benchmark();
+  static void benchmarkSign();
   static const uint8_t header[];
   static const uint8_t IDWhisperPayload;
   static const uint8_t IDWhisperCompression;
@@ -47,15 +116,50 @@ public:
   static const uint8_t BroadcastAddr[];
   static const uint16_t wpaFlags;
 
-  static uint8_t *beaconFrame;
+  static uint8_t beaconFrame[FRAME_BUFFER_LENGTH];
+  static size_t frameLength;
   static const int pwngridHeaderLength;
   static size_t essidLength;
   static uint8_t headerLength;
 
-  static size_t payloadSize;
   static const size_t chunkSize;
 
 private:
+  static advertise_state_t state;
+  static int sent;
+  static int packets;
+  static int64_t completions[FRAME_METER_WINDOW];
+  static int metered;
+  static int64_t failedAt;
+  static int64_t gap();
+  static void meter(int64_t at);
+  static float pps();
+  static int64_t due();
+  static long finish();
+  static void done(bool sent, int64_t at);
+  static volatile bool inFlight;
+  static portMUX_TYPE meterLock;
+  static void build(JsonDocument &doc);
+  static bool compose();
+  static bool composeJson();
+  static bool compile();
+  static void layout(const uint8_t *data, size_t length, bool deflated);
+  static void squeeze();
+  static void sign();
+  static void stamp();
+  static void report();
+  static void patch(beacon_slot_id_t id, const char *text);
+  static bool matches(const char *json, const char *padded);
+  static char payload[FRAME_PAYLOAD_MAX + 1];
+  static uint8_t compressed[FRAME_PAYLOAD_MAX];
+  static bool deflated;
+  static size_t rawLength;
+  static uint8_t signature[IDENTITY_SIGNATURE_LENGTH];
+  static size_t signedLength;
+  static beacon_slot_t slots[SLOT_COUNT];
+  static bool compiled;
+  static beacon_fields_t packed;
+  static bool stale;
 };
 
 #endif // FRAME_H
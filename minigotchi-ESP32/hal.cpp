@@ -0,0 +1,435 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * hal.cpp: the only place that talks to esp_wifi and the serial link directly
+ */
+
+#include "hal.h"
+#include "stats.h"
+#include <WiFi.h>
+#include <esp_timer.h>
+#include <esp_private/wifi.h>
+#include <esp_wifi.h>
+#include <esp_wifi_types.h>
+
+/** developer note:
+ *
+ * Channel, Frame, Deauth, Pwnagotchi and Parasite go through here instead of
+ * calling esp_wifi_*, WiFi and the serial link themselves, and nothing in
+ * hal.h is an esp type. that way the rest of the code doesn't care what it's
+ * running on, test/fakes/hal.cpp stands in for this file in the host build
+ * (see test/CMakeLists.txt) and the core logic gets built and poked at
+ * without a board.
+ *
+ */
+
+volatile hal_rx_callback_t Hal::rxCallback = nullptr;
+volatile uint32_t Hal::rxFirst = 0;
+volatile uint32_t Hal::rxFrames = 0;
+uint32_t Hal::rxFilter = HAL_FILTER_MGMT;
+bool Hal::promiscuous = false;
+
+// partial serial line, see readLine()
+String Hal::rxLine = "";
+
+// frames the driver is holding, see submit()
+hal_tx_slot_t Hal::txRing[HAL_TX_RING];
+volatile uint32_t Hal::txHead = 0;
+volatile uint32_t Hal::txTail = 0;
+hal_tx_counters_t Hal::counters = {};
+portMUX_TYPE Hal::txLock = portMUX_INITIALIZER_UNLOCKED;
+bool Hal::txHooked = false;
+bool Hal::txAsync = false;
+
+// monitor mode on/off, see Minigotchi::monStart() and Minigotchi::monStop()
+void Hal::monitor(bool enable) {
+  // already listening, don't bother the driver
+  if (enable && Hal::promiscuous) {
+    return;
+  }
+
+  if (enable) {
+    // disconnect from WiFi if we were at all
+    WiFi.disconnect();
+
+    // revert to station mode
+    WiFi.mode(WIFI_STA);
+    esp_wifi_set_promiscuous_rx_cb(
+        [](void *buf, wifi_promiscuous_pkt_type_t type) {
+          Hal::dispatch(buf, type);
+        });
+    Hal::applyFilter();
+    esp_wifi_set_promiscuous(true);
+  } else {
+    esp_wifi_set_promiscuous(false);
+
+    // revert to station mode
+    WiFi.mode(WIFI_STA);
+  }
+
+  Hal::promiscuous = enable;
+}
+
+bool Hal::monitoring() { return Hal::promiscuous; }
+
+bool Hal::setChannel(int channel) {
+  return esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE) == ESP_OK;
+}
+
+// which channels the driver lets us tune to, channel 14 needs "JP"
+bool Hal::setCountry(const char *country, int first, int count) {
+  wifi_country_t config = {};
+  strncpy(config.cc, country, sizeof(config.cc) - 1);
+  config.schan = first;
+  config.nchan = count;
+  config.max_tx_power = 20;
+  config.policy = WIFI_COUNTRY_POLICY_MANUAL;
+  return esp_wifi_set_country(&config) == ESP_OK;
+}
+
+int Hal::getChannel() {
+  uint8_t primary;
+  wifi_second_chan_t second;
+  esp_wifi_get_channel(&primary, &second);
+  return primary;
+}
+
+/** developer note:
+ *
+ * the driver only ever sees Hal::dispatch() as its promiscuous callback,
+ * setRxCallback() just swaps out who dispatch() hands frames to. besides not
+ * re-registering with the driver all the time, this lets us timestamp the first
+ * frame after a channel switch no matter who's listening (see
+ * Channel::switchChannel()). dispatch() also unwraps the driver's packet into
+ * a hal_rx_frame_t, with the FCS the driver leaves on the end cut off.
+ *
+ */
+
+void Hal::setRxCallback(hal_rx_callback_t callback) {
+  Hal::rxCallback = callback;
+}
+
+hal_rx_callback_t Hal::getRxCallback() { return Hal::rxCallback; }
+
+/** developer note:
+ *
+ * with no filter the driver hands us every data and control frame on the
+ * channel too, and on a busy channel that's most of them. the filter is a
+ * HAL_FILTER_* mask, the scheduler sets one per phase(see
+ * Config::phaseFilter) and it's kept across monitor mode restarts. control
+ * frames have a second filter of their own, they're all or nothing here.
+ *
+ */
+
+void Hal::setFilter(uint32_t mask) {
+  if (mask == Hal::rxFilter) {
+    return;
+  }
+
+  Hal::rxFilter = mask;
+  if (Hal::promiscuous) {
+    Hal::applyFilter();
+  }
+}
+
+uint32_t Hal::filter() { return Hal::rxFilter; }
+
+// how many frames the driver has handed us, filtered or not
+uint32_t Hal::rxCount() { return Hal::rxFrames; }
+
+void Hal::applyFilter() {
+  wifi_promiscuous_filter_t filter = {};
+  if (Hal::rxFilter & HAL_FILTER_MGMT) {
+    filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_MGMT;
+  }
+  if (Hal::rxFilter & HAL_FILTER_CTRL) {
+    filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_CTRL;
+  }
+  if (Hal::rxFilter & HAL_FILTER_DATA) {
+    filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_DATA;
+  }
+  if (Hal::rxFilter & HAL_FILTER_MISC) {
+    filter.filter_mask |= WIFI_PROMIS_FILTER_MASK_MISC;
+  }
+  esp_wifi_set_promiscuous_filter(&filter);
+
+  if (Hal::rxFilter & HAL_FILTER_CTRL) {
+    wifi_promiscuous_filter_t ctrl = {};
+    ctrl.filter_mask = WIFI_PROMIS_CTRL_FILTER_MASK_ALL;
+    esp_wifi_set_promiscuous_ctrl_filter(&ctrl);
+  }
+}
+
+// timestamp(us) the next frame we get, 0 until one shows up
+void Hal::armFirstFrame() { Hal::rxFirst = 0; }
+
+uint32_t Hal::firstFrame() { return Hal::rxFirst; }
+
+void Hal::dispatch(void *buf, int type) {
+  Hal::rxFrames = Hal::rxFrames + 1;
+  if (Hal::rxFirst == 0) {
+    Hal::rxFirst = (uint32_t)esp_timer_get_time() | 1;
+  }
+
+  hal_rx_callback_t callback = Hal::rxCallback;
+  if (callback == nullptr) {
+    return;
+  }
+
+  const wifi_promiscuous_pkt_t *packet = (wifi_promiscuous_pkt_t *)buf;
+  hal_rx_frame_t frame;
+  frame.data = packet->payload;
+  frame.len = max((int)packet->rx_ctrl.sig_len - 4, 0);
+  frame.rssi = packet->rx_ctrl.rssi;
+  frame.channel = packet->rx_ctrl.channel;
+  switch (type) {
+  case WIFI_PKT_MGMT:
+    frame.type = HAL_FRAME_MGMT;
+    break;
+  case WIFI_PKT_CTRL:
+    frame.type = HAL_FRAME_CTRL;
+    break;
+  case WIFI_PKT_DATA:
+    frame.type = HAL_FRAME_DATA;
+    break;
+  default:
+    frame.type = HAL_FRAME_MISC;
+    break;
+  }
+  callback(frame);
+}
+
+/** developer note:
+ *
+ * esp_wifi_80211_tx() returning ESP_OK only means the frame got queued, not
+ * that it went out. so every frame we hand over gets a slot in a small ring,
+ * and the driver's tx done callback tells us how it went, oldest first. that
+ * gives us real sent/failed counts and how long frames sit in the queue(the
+ * "tx" stat), and once HAL_TX_RING frames are waiting submit() says
+ * HAL_TX_BUSY instead of piling more on.
+ *
+ * the driver reports on its own frames too(probe requests while scanning for
+ * example), so a report only counts if it matches the oldest slot. if the tx
+ * done callback can't be set, or it never reports any of our frames, we go
+ * back to treating ESP_OK as sent.
+ *
+ */
+
+// we dont use raw80211 since it sends a header(which we don't need)
+bool Hal::tx(const uint8_t *buf, size_t len, bool sysSeq) {
+  return Hal::submit(buf, len, sysSeq, nullptr) == HAL_TX_QUEUED;
+}
+
+hal_tx_result_t Hal::submit(const uint8_t *buf, size_t len, bool sysSeq,
+                            hal_tx_done_t done) {
+  if (!Hal::txHooked) {
+    Hal::txHooked = true;
+    Hal::txAsync = esp_wifi_set_tx_done_cb(Hal::txDone) == ESP_OK;
+  }
+
+  int64_t now = Stats::now();
+  Hal::reap(now);
+
+  portENTER_CRITICAL(&Hal::txLock);
+  if (Hal::txHead - Hal::txTail >= HAL_TX_RING) {
+    Hal::counters.busy++;
+    portEXIT_CRITICAL(&Hal::txLock);
+    return HAL_TX_BUSY;
+  }
+
+  // take the slot before handing the frame over, the driver can be done with
+  // it before esp_wifi_80211_tx() even returns
+  hal_tx_slot_t &slot = Hal::txRing[Hal::txHead % HAL_TX_RING];
+  slot.queuedAt = now;
+  slot.done = done;
+  slot.len = len;
+  memcpy(slot.addr, buf + 10, sizeof(slot.addr));
+  Hal::txHead++;
+  portEXIT_CRITICAL(&Hal::txLock);
+
+  if (esp_wifi_80211_tx(WIFI_IF_STA, buf, len, sysSeq) != ESP_OK) {
+    // never made it to the driver, give the slot back
+    portENTER_CRITICAL(&Hal::txLock);
+    Hal::txHead--;
+    Hal::counters.failed++;
+    portEXIT_CRITICAL(&Hal::txLock);
+    Stats::record(STAT_TX_FAIL, 0);
+    return HAL_TX_FAILED;
+  }
+
+  Hal::counters.queued++;
+  if (!Hal::txAsync) {
+    Hal::complete(Stats::now(), true, false, nullptr, 0);
+  }
+  return HAL_TX_QUEUED;
+}
+
+// from the wifi task, keep it short
+void Hal::txDone(uint8_t ifidx, uint8_t *data, uint16_t *len, bool txStatus) {
+  if (!Hal::txAsync || data == nullptr || len == nullptr) {
+    return;
+  }
+
+  Hal::complete(Stats::now(), txStatus, false, data, *len);
+}
+
+/** developer note:
+ *
+ * the oldest frame is done with, one way or another. whatever decides which
+ * frame that is(the driver's report matching it, or it being too old) has to
+ * be checked under the same lock as the pop, otherwise reap() or another
+ * report can move the tail in between and we'd retire the wrong frame.
+ *
+ * data is what the driver handed back(nullptr means the oldest, whatever it
+ * is), lost only takes the oldest if it's been waiting longer than
+ * HAL_TX_TIMEOUT. says if anything was retired.
+ *
+ */
+
+bool Hal::complete(int64_t now, bool sent, bool lost, const uint8_t *data,
+                   uint16_t len) {
+  portENTER_CRITICAL(&Hal::txLock);
+  if (Hal::txHead == Hal::txTail) {
+    portEXIT_CRITICAL(&Hal::txLock);
+    return false;
+  }
+
+  hal_tx_slot_t slot = Hal::txRing[Hal::txTail % HAL_TX_RING];
+  bool ours = data == nullptr || (len == slot.len &&
+                                  memcmp(data + 10, slot.addr,
+                                         sizeof(slot.addr)) == 0);
+  bool expired = now - slot.queuedAt > HAL_TX_TIMEOUT;
+  if (!ours || (lost && !expired)) {
+    // not one of ours, or not late yet
+    portEXIT_CRITICAL(&Hal::txLock);
+    return false;
+  }
+
+  Hal::txTail++;
+  if (lost) {
+    Hal::counters.lost++;
+  } else if (sent) {
+    Hal::counters.sent++;
+  } else {
+    Hal::counters.failed++;
+  }
+  portEXIT_CRITICAL(&Hal::txLock);
+
+  if (!lost) {
+    Stats::record(sent ? STAT_TX : STAT_TX_FAIL,
+                  (uint32_t)(now - slot.queuedAt));
+  }
+  if (slot.done != nullptr) {
+    slot.done(sent && !lost, now);
+  }
+  return true;
+}
+
+// write off frames the driver never reported back on
+void Hal::reap(int64_t now) {
+  while (Hal::complete(now, false, true, nullptr, 0)) {
+  }
+
+  // it's never reported a single one of ours, stop waiting on it
+  if (Hal::txAsync && Hal::counters.sent == 0 &&
+      Hal::counters.lost >= HAL_TX_RING) {
+    Hal::txAsync = false;
+  }
+}
+
+// how many frames the driver is still holding
+int Hal::txPending() {
+  Hal::reap(Stats::now());
+  return Hal::txHead - Hal::txTail;
+}
+
+hal_tx_counters_t Hal::txCounters() {
+  portENTER_CRITICAL(&Hal::txLock);
+  hal_tx_counters_t copy = Hal::counters;
+  portEXIT_CRITICAL(&Hal::txLock);
+  return copy;
+}
+
+// in the background, scanResult() says when it's done. channel 0 is all of
+// them
+void Hal::scanStart(int channel) {
+  if (channel > 0) {
+    WiFi.scanNetworks(true, false, false, 300, channel);
+  } else {
+    WiFi.scanNetworks(true);
+  }
+}
+
+// how many access points the scan found, or HAL_SCAN_RUNNING/HAL_SCAN_FAILED
+int Hal::scanResult() {
+  int found = WiFi.scanComplete();
+  if (found == WIFI_SCAN_RUNNING) {
+    return HAL_SCAN_RUNNING;
+  }
+  return found < 0 ? HAL_SCAN_FAILED : found;
+}
+
+// scanDelete() only frees the results, a scan that's still going has to be
+// told to stop or it keeps the radio off our channel
+void Hal::scanEnd() {
+  esp_wifi_scan_stop();
+  WiFi.scanDelete();
+}
+
+bool Hal::scanAp(int index, hal_ap_t &ap) {
+  if (index < 0 || index >= WiFi.scanComplete()) {
+    return false;
+  }
+
+  strncpy(ap.ssid, WiFi.SSID(index).c_str(), sizeof(ap.ssid) - 1);
+  ap.ssid[sizeof(ap.ssid) - 1] = '\0';
+  memcpy(ap.bssid, WiFi.BSSID(index), sizeof(ap.bssid));
+  ap.rssi = WiFi.RSSI(index);
+  ap.channel = WiFi.channel(index);
+  ap.encryption = WiFi.encryptionType(index);
+  return true;
+}
+
+void Hal::macAddress(uint8_t *mac) { WiFi.macAddress(mac); }
+
+int Hal::stationCount() { return WiFi.softAPgetStationNum(); }
+
+// never blocks, collects whatever has arrived until we have a whole line
+bool Hal::readLine(String &line) {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\n') {
+      line = Hal::rxLine;
+      Hal::rxLine = "";
+      return true;
+    }
+
+    if (Hal::rxLine.length() < HAL_LINE_MAX) {
+      Hal::rxLine += c;
+    }
+  }
+
+  return false;
+}
+
+void Hal::writeLine(const char *line) {
+  int64_t started = Stats::now();
+  Serial.println(line);
+  Stats::since(STAT_SERIAL, started);
+}
@@ -0,0 +1,160 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * hal.h: header files for hal.cpp
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+// longest serial line we'll hold on to
+#define HAL_LINE_MAX 256
+
+// frames we let the driver hold at once, past that submit() pushes back
+#define HAL_TX_RING 8
+
+// a frame the driver never told us about is written off after this(us)
+#define HAL_TX_TIMEOUT 100000
+
+// which kinds of frame the radio passes up, see Hal::setFilter()
+#define HAL_FILTER_MGMT (1 << 0)
+#define HAL_FILTER_CTRL (1 << 1)
+#define HAL_FILTER_DATA (1 << 2)
+#define HAL_FILTER_MISC (1 << 3)
+
+// what scanResult() says while there's nothing to read yet
+#define HAL_SCAN_RUNNING -1
+#define HAL_SCAN_FAILED -2
+
+// longest ssid an access point can have
+#define HAL_SSID_MAX 32
+
+typedef enum {
+  HAL_TX_QUEUED = 0,
+  HAL_TX_BUSY = 1,
+  HAL_TX_FAILED = 2
+} hal_tx_result_t;
+
+typedef enum {
+  HAL_FRAME_MGMT = 0,
+  HAL_FRAME_CTRL = 1,
+  HAL_FRAME_DATA = 2,
+  HAL_FRAME_MISC = 3,
+} hal_frame_type_t;
+
+// a frame off the air, without its FCS
+typedef struct {
+  const uint8_t *data;
+  int len;
+  int rssi;
+  int channel;
+  hal_frame_type_t type;
+} hal_rx_frame_t;
+
+// gets every frame the filter lets through, from the wifi task
+typedef void (*hal_rx_callback_t)(const hal_rx_frame_t &frame);
+
+// called once the driver is done with a frame, from the wifi task
+typedef void (*hal_tx_done_t)(bool sent, int64_t at);
+
+// one frame the driver is holding on to
+typedef struct {
+  int64_t queuedAt;
+  hal_tx_done_t done;
+  uint16_t len;
+  uint8_t addr[6];
+} hal_tx_slot_t;
+
+typedef struct {
+  uint32_t queued;
+  uint32_t sent;
+  uint32_t failed;
+  uint32_t busy;
+  uint32_t lost;
+} hal_tx_counters_t;
+
+// one access point out of the last scan
+typedef struct {
+  char ssid[HAL_SSID_MAX + 1];
+  uint8_t bssid[6];
+  int rssi;
+  int channel;
+  uint8_t encryption;
+} hal_ap_t;
+
+class Hal {
+public:
+  // radio
+  static void monitor(bool enable);
+  static bool monitoring();
+  static bool setChannel(int channel);
+  static bool setCountry(const char *country, int first, int count);
+  static int getChannel();
+  static void setRxCallback(hal_rx_callback_t callback);
+  static hal_rx_callback_t getRxCallback();
+  static void setFilter(uint32_t mask);
+  static uint32_t filter();
+  static uint32_t rxCount();
+  static void armFirstFrame();
+  static uint32_t firstFrame();
+  static bool tx(const uint8_t *buf, size_t len, bool sysSeq);
+  static hal_tx_result_t submit(const uint8_t *buf, size_t len, bool sysSeq,
+                                hal_tx_done_t done);
+  static int txPending();
+  static hal_tx_counters_t txCounters();
+
+  // access point scan
+  static void scanStart(int channel);
+  static int scanResult();
+  static void scanEnd();
+  static bool scanAp(int index, hal_ap_t &ap);
+  static void macAddress(uint8_t *mac);
+  static int stationCount();
+
+  // serial link
+  static bool readLine(String &line);
+  static void writeLine(const char *line);
+
+private:
+  static void dispatch(void *buf, int type);
+  static volatile hal_rx_callback_t rxCallback;
+  static volatile uint32_t rxFirst;
+  static volatile uint32_t rxFrames;
+  static uint32_t rxFilter;
+  static void applyFilter();
+  static bool promiscuous;
+  static String rxLine;
+  static void txDone(uint8_t ifidx, uint8_t *data, uint16_t *len,
+                     bool txStatus);
+  static bool complete(int64_t now, bool sent, bool lost, const uint8_t *data,
+                       uint16_t len);
+  static void reap(int64_t now);
+  static hal_tx_slot_t txRing[HAL_TX_RING];
+  static volatile uint32_t txHead;
+  static volatile uint32_t txTail;
+  static hal_tx_counters_t counters;
+  static portMUX_TYPE txLock;
+  static bool txHooked;
+  static bool txAsync;
+};
+
+#endif // HAL_H
@@ -0,0 +1,227 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * identity.cpp: our pwngrid keypair, and signing advertisments with it
+ */
+
+#include "identity.h"
+
+/** developer note:
+ *
+ * a pwnagotchi's identity is the sha256 of its rsa public key(PKCS#1, PEM
+ * encoded, exactly how go's pem package writes it) and it signs what it
+ * advertises with RSA-PSS over the sha256 of the json. we do the same with
+ * mbedtls, which is already in the core and uses the hardware bignum unit.
+ *
+ * the key gets generated on the first boot and stored in nvs, that takes a
+ * while(tens of seconds on a plain ESP32) so it only ever happens once. the
+ * fingerprint replaces Config::identity, so whatever is in config.cpp is only
+ * used when signing is turned off or the key couldn't be set up.
+ *
+ * mbedtls gets its entropy from esp_random(), which is only really random
+ * once the radio is running. so this has to be called after Channel::init()
+ * has started WiFi, before that the key would come out of a pseudo random
+ * sequence.
+ *
+ */
+
+mbedtls_pk_context Identity::key;
+mbedtls_entropy_context Identity::entropy;
+mbedtls_ctr_drbg_context Identity::drbg;
+uint8_t Identity::digest[IDENTITY_FINGERPRINT_LENGTH];
+bool Identity::loaded = false;
+
+bool Identity::begin() {
+  const char *personal = "minigotchi";
+
+  mbedtls_pk_init(&Identity::key);
+  mbedtls_entropy_init(&Identity::entropy);
+  mbedtls_ctr_drbg_init(&Identity::drbg);
+  if (mbedtls_ctr_drbg_seed(&Identity::drbg, mbedtls_entropy_func,
+                            &Identity::entropy, (const uint8_t *)personal,
+                            strlen(personal)) != 0) {
+    Serial.println("(X-X) Couldn't seed the random number generator!");
+    return false;
+  }
+
+  if (!Identity::load()) {
+    Serial.println("(>-<) Generating keys, this takes a while...");
+    Display::updateDisplay("(>-<)", "Generating keys...");
+    int64_t started = Stats::now();
+    if (!Identity::generate()) {
+      Serial.println("(X-X) Couldn't generate keys!");
+      Display::updateDisplay("(X-X)", "Couldn't generate keys!");
+      return false;
+    }
+    Serial.printf("('-') Generated a %d bit key in %u ms\n", IDENTITY_KEY_BITS,
+                  (unsigned)((Stats::now() - started) / 1000));
+
+    if (!Identity::save()) {
+      Serial.println("(X-X) Couldn't save keys, they won't survive a reboot!");
+    }
+  }
+
+  if (!Identity::hash()) {
+    return false;
+  }
+
+  // everything we advertise goes by the fingerprint from now on
+  char hex[IDENTITY_FINGERPRINT_LENGTH * 2 + 1];
+  for (int i = 0; i < IDENTITY_FINGERPRINT_LENGTH; i++) {
+    snprintf(hex + i * 2, 3, "%02x", Identity::digest[i]);
+  }
+  Config::identity = hex;
+  Identity::loaded = true;
+
+  Serial.print("('-') Identity: ");
+  Serial.println(hex);
+  Serial.println(" ");
+  return true;
+}
+
+bool Identity::ready() { return Identity::loaded; }
+
+const uint8_t *Identity::fingerprint() { return Identity::digest; }
+
+// read the private key back out of nvs
+bool Identity::load() {
+  static uint8_t der[IDENTITY_PRIVATE_MAX];
+  Preferences prefs;
+  if (!prefs.begin(IDENTITY_NAMESPACE, true)) {
+    return false;
+  }
+
+  size_t length = prefs.getBytesLength(IDENTITY_KEY);
+  if (length == 0 || length > sizeof(der)) {
+    prefs.end();
+    return false;
+  }
+  length = prefs.getBytes(IDENTITY_KEY, der, sizeof(der));
+  prefs.end();
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+  int result = mbedtls_pk_parse_key(&Identity::key, der, length, nullptr, 0,
+                                    mbedtls_ctr_drbg_random, &Identity::drbg);
+#else
+  int result = mbedtls_pk_parse_key(&Identity::key, der, length, nullptr, 0);
+#endif
+  memset(der, 0, sizeof(der));
+
+  if (result != 0 || !mbedtls_pk_can_do(&Identity::key, MBEDTLS_PK_RSA)) {
+    mbedtls_pk_free(&Identity::key);
+    mbedtls_pk_init(&Identity::key);
+    return false;
+  }
+  return true;
+}
+
+bool Identity::generate() {
+  if (mbedtls_pk_setup(&Identity::key,
+                       mbedtls_pk_info_from_type(MBEDTLS_PK_RSA)) != 0) {
+    return false;
+  }
+  return mbedtls_rsa_gen_key(mbedtls_pk_rsa(Identity::key),
+                             mbedtls_ctr_drbg_random, &Identity::drbg,
+                             IDENTITY_KEY_BITS, 65537) == 0;
+}
+
+bool Identity::save() {
+  static uint8_t der[IDENTITY_PRIVATE_MAX];
+
+  // mbedtls writes der from the end of the buffer backwards
+  int length = mbedtls_pk_write_key_der(&Identity::key, der, sizeof(der));
+  if (length <= 0) {
+    return false;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(IDENTITY_NAMESPACE, false)) {
+    return false;
+  }
+  size_t written =
+      prefs.putBytes(IDENTITY_KEY, der + sizeof(der) - length, length);
+  prefs.end();
+  memset(der, 0, sizeof(der));
+  return written == (size_t)length;
+}
+
+// sha256 of the public key, the way pwngrid works it out
+bool Identity::hash() {
+  uint8_t der[IDENTITY_PUBLIC_MAX];
+  uint8_t *start = der + sizeof(der);
+  int length = mbedtls_pk_write_pubkey(&start, der, &Identity::key);
+  if (length <= 0) {
+    return false;
+  }
+
+  uint8_t encoded[(IDENTITY_PUBLIC_MAX + 2) / 3 * 4 + 1];
+  size_t encodedLength = 0;
+  if (mbedtls_base64_encode(encoded, sizeof(encoded), &encodedLength, start,
+                            length) != 0) {
+    return false;
+  }
+
+  // pem, 64 characters a line
+  static const char begin[] = "-----BEGIN RSA PUBLIC KEY-----\n";
+  static const char end[] = "-----END RSA PUBLIC KEY-----\n";
+  char pem[sizeof(begin) + sizeof(encoded) + sizeof(encoded) / 64 + 1 +
+           sizeof(end)];
+  size_t at = strlen(begin);
+  memcpy(pem, begin, at);
+  for (size_t i = 0; i < encodedLength; i += 64) {
+    size_t line = min(encodedLength - i, (size_t)64);
+    memcpy(pem + at, encoded + i, line);
+    at += line;
+    pem[at++] = '\n';
+  }
+  memcpy(pem + at, end, strlen(end));
+  at += strlen(end);
+
+  return mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                    (const uint8_t *)pem, at, Identity::digest) == 0;
+}
+
+// RSA-PSS over the sha256 of data, signature has to hold
+// IDENTITY_SIGNATURE_LENGTH bytes
+bool Identity::sign(const uint8_t *data, size_t length, uint8_t *signature) {
+  if (!Identity::loaded) {
+    return false;
+  }
+
+  int64_t started = Stats::now();
+  uint8_t hash[32];
+  if (mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), data, length,
+                 hash) != 0) {
+    return false;
+  }
+
+  mbedtls_rsa_context *rsa = mbedtls_pk_rsa(Identity::key);
+  mbedtls_rsa_set_padding(rsa, MBEDTLS_RSA_PKCS_V21, MBEDTLS_MD_SHA256);
+#if MBEDTLS_VERSION_MAJOR >= 3
+  int result = mbedtls_rsa_rsassa_pss_sign(rsa, mbedtls_ctr_drbg_random,
+                                           &Identity::drbg, MBEDTLS_MD_SHA256,
+                                           sizeof(hash), hash, signature);
+#else
+  int result = mbedtls_rsa_rsassa_pss_sign(
+      rsa, mbedtls_ctr_drbg_random, &Identity::drbg, MBEDTLS_RSA_PRIVATE,
+      MBEDTLS_MD_SHA256, sizeof(hash), hash, signature);
+#endif
+  Stats::since(STAT_SIGN, started);
+  return result == 0;
+}
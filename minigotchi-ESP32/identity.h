@@ -0,0 +1,73 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * identity.h: header files for identity.cpp
+ */
+
+#ifndef IDENTITY_H
+#define IDENTITY_H
+
+#include "config.h"
+#include "display.h"
+#include "stats.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <mbedtls/base64.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/md.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/rsa.h>
+#include <mbedtls/version.h>
+
+// rsa key size, a signature is this many bits long
+#define IDENTITY_KEY_BITS 2048
+#define IDENTITY_SIGNATURE_LENGTH (IDENTITY_KEY_BITS / 8)
+
+// sha256 of the public key
+#define IDENTITY_FINGERPRINT_LENGTH 32
+
+// der encoded keys, with room to spare
+#define IDENTITY_PRIVATE_MAX 1600
+#define IDENTITY_PUBLIC_MAX 300
+
+// where the private key lives in nvs
+#define IDENTITY_NAMESPACE "minigotchi"
+#define IDENTITY_KEY "id_rsa"
+
+class Identity {
+public:
+  static bool begin();
+  static bool ready();
+  static bool sign(const uint8_t *data, size_t length, uint8_t *signature);
+  static const uint8_t *fingerprint();
+
+private:
+  static bool load();
+  static bool generate();
+  static bool save();
+  static bool hash();
+  static mbedtls_pk_context key;
+  static mbedtls_entropy_context entropy;
+  static mbedtls_ctr_drbg_context drbg;
+  static uint8_t digest[IDENTITY_FINGERPRINT_LENGTH];
+  static bool loaded;
+};
+
+#endif // IDENTITY_H
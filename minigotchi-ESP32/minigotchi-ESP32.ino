@@ -27,6 +27,8 @@ Config config;
 Minigotchi minigotchi;
 
 void setup() {
+    // buffer serial output so printing never stalls the radio task
+    Serial.setTxBufferSize(1024);
     Serial.begin(config.baud);
     minigotchi.boot();
 }
@@ -39,20 +41,6 @@ void setup() {
 */
 
 void loop() {
-    // cycle channels at start of loop
-    minigotchi.cycle();
-    delay(250);
-
-    // the longer we are on this channel, the more likely we're gonna see a pwnagotchi on this channel
-    // get local payload from local pwnagotchi, send raw frame if one is found
-    minigotchi.detect();
-    delay(250);
-
-    // advertise our presence with the help of pwngrid compatible beacon frames (probably the most confusing part lmao)
-    minigotchi.advertise();
-    delay(250);
-
-    // deauth random access point
-    minigotchi.deauth();
-    delay(250);
+    // everything runs in the radio and ui tasks now, see scheduler.cpp and display.cpp
+    vTaskDelete(NULL);
 }
@@ -44,9 +44,13 @@ int Minigotchi::addEpoch() {
 
 void Minigotchi::epoch() {
   Minigotchi::addEpoch();
-  Parasite::readData();
+  Epoch::next();
   Serial.print("('-') Current Epoch: ");
   Serial.println(Minigotchi::currentEpoch);
+  if (Config::statsInterval > 0 &&
+      Minigotchi::currentEpoch % Config::statsInterval == 0) {
+    Stats::summary();
+  }
   Serial.println(" ");
 }
 
@@ -84,9 +88,16 @@ void Minigotchi::boot() {
   Serial.println(" ");
   Deauth::list();
   Channel::init(Config::channel);
+  // the radio has to be up first, it's where esp_random() gets its entropy
+  if (Config::sign) {
+    Identity::begin();
+  }
   Minigotchi::info();
   Parasite::sendName();
+  Pwnagotchi::begin();
+  Capture::begin();
   Minigotchi::finish();
+  Scheduler::begin();
 }
 
 void Minigotchi::info() {
@@ -155,19 +166,15 @@ void Minigotchi::cpu() {
  */
 
 void Minigotchi::monStart() {
-  // disconnect from WiFi if we were at all
-  WiFi.disconnect();
-
-  // revert to station mode
-  WiFi.mode(WIFI_STA);
-  esp_wifi_set_promiscuous(true);
+  int64_t started = Stats::now();
+  Hal::monitor(true);
+  Stats::since(STAT_MON_START, started);
 }
 
 void Minigotchi::monStop() {
-  esp_wifi_set_promiscuous(false);
-
-  // revert to station mode
-  WiFi.mode(WIFI_STA);
+  int64_t started = Stats::now();
+  Hal::monitor(false);
+  Stats::since(STAT_MON_STOP, started);
 }
 
 /** developer note:
@@ -189,26 +196,29 @@ void Minigotchi::monStop() {
  *
  */
 
+/** developer note:
+ *
+ * these are the steps the scheduler calls, each one returns how long(ms) until
+ * it wants to be called again or TASK_DONE when that phase is over
+ *
+ */
+
 // channel cycling
-void Minigotchi::cycle() {
-  Parasite::readData();
-  Channel::cycle();
+long Minigotchi::cycle() {
+  return Channel::cycle();
 }
 
 // pwnagotchi detection
-void Minigotchi::detect() {
-  Parasite::readData();
-  Pwnagotchi::detect();
+long Minigotchi::detect() {
+  return Pwnagotchi::detect();
 }
 
 // deauthing
-void Minigotchi::deauth() {
-  Parasite::readData();
-  Deauth::deauth();
+long Minigotchi::deauth() {
+  return Deauth::deauth();
 }
 
 // advertising
-void Minigotchi::advertise() {
-  Parasite::readData();
-  Frame::advertise();
+long Minigotchi::advertise() {
+  return Frame::advertise();
 }
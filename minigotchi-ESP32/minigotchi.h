@@ -23,16 +23,20 @@
 #ifndef MINIGOTCHI_H
 #define MINIGOTCHI_H
 
+#include "capture.h"
 #include "channel.h"
 #include "config.h"
 #include "deauth.h"
+#include "epoch.h"
 #include "display.h"
 #include "frame.h"
+#include "hal.h"
+#include "identity.h"
 #include "parasite.h"
 #include "pwnagotchi.h"
+#include "scheduler.h"
+#include "stats.h"
 #include <Arduino.h>
-#include <WiFi.h>
-#include <esp_wifi.h>
 
 class Minigotchi {
 public:
@@ -44,10 +48,10 @@ public:
   static void cpu();
   static void monStart();
   static void monStop();
-  static void cycle();
-  static void detect();
-  static void deauth();
-  static void advertise();
+  static long cycle();
+  static long detect();
+  static long deauth();
+  static long advertise();
   static void epoch();
   static int addEpoch();
   static int currentEpoch;
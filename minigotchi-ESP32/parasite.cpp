@@ -24,23 +24,40 @@
 
 int Parasite::channel = 0;
 
+/** developer note:
+ *
+ * this is the only place reading serial, so besides the parasite commands it
+ * also hands everything else to whichever module it's for(see commands.cpp),
+ * those work with or without parasite mode.
+ *
+ */
+
 void Parasite::readData() {
-  if (Config::parasite) {
-    int curChan = Parasite::channel;
-    while (Serial.available() > 0) {
-      String line = Serial.readStringUntil('\n');
-      if (line.startsWith("chn:::")) {
-        int chn = atoi(line.substring(6).c_str());
-        if (Channel::isValidChannel(chn)) {
-          Parasite::channel = chn;
-        } else {
-          Parasite::channel = 0;
-        }
-      } else if (line.startsWith("nme:::")) {
-        Parasite::sendName();
+  int curChan = Parasite::channel;
+  String line;
+  while (Hal::readLine(line)) {
+    line.trim();
+    if (Config::parasite && line.startsWith("chn:::")) {
+      int64_t received = Stats::now();
+      int chn = atoi(line.substring(6).c_str());
+      if (Channel::isValidChannel(chn)) {
+        Parasite::channel = chn;
+      } else {
+        Parasite::channel = 0;
       }
+
+      if (Parasite::channel > 0 &&
+          Parasite::channel != Channel::getChannel()) {
+        Parasite::follow(received);
+      }
+    } else if (Config::parasite && line.startsWith("nme:::")) {
+      Parasite::sendName();
+    } else {
+      Commands::dispatch(line);
     }
+  }
 
+  if (Config::parasite) {
     // If parasite channel is set and is different than what was there before,
     // notify that we're synced Otherwise if parasite channel is not set but was
     // before, notify we've unsynced
@@ -52,6 +69,34 @@ void Parasite::readData() {
   }
 }
 
+/** developer note:
+ *
+ * the host tells us every time it hops, so we hop with it straight away(fast
+ * switch if we can) and stop whatever we were doing on the old channel. both
+ * of us end up on the same channel instead of scanning two different ones, and
+ * the host gets told how long it took us to catch up, in us.
+ *
+ */
+
+void Parasite::follow(int64_t received) {
+  Scheduler::preempt();
+  Channel::switchChannel(Parasite::channel);
+  uint32_t latency = (uint32_t)(Stats::now() - received);
+  Stats::record(STAT_FOLLOW, latency);
+
+  JsonDocument doc;
+  char chnBuf[4];
+  char usBuf[11];
+  char buf[64];
+
+  snprintf(chnBuf, sizeof(chnBuf), "%d", Channel::getChannel());
+  snprintf(usBuf, sizeof(usBuf), "%u", (unsigned)latency);
+  doc["channel"] = chnBuf;
+  doc["us"] = usBuf;
+  serializeJson(doc, buf);
+  Parasite::sendData("chn", static_cast<uint8_t>(FOLLOWED_CHANNEL), buf);
+}
+
 void Parasite::sendChannelStatus(parasite_channel_status_type_t status) {
   if (Config::parasite) {
     char chnBuf[4];
@@ -147,7 +192,7 @@ void Parasite::sendData(const char *command, uint8_t status, const char *data) {
   strncat(fullCmd, command, sizeof(fullCmd) - 1);
   strncat(fullCmd, ":::", sizeof(fullCmd) - strlen(fullCmd) - 1);
   strncat(fullCmd, buf, sizeof(fullCmd) - strlen(fullCmd) - 1);
-  Serial.println(fullCmd);
+  Hal::writeLine(fullCmd);
 }
 
 void Parasite::formatData(char *buf, const char *data, size_t bufSize) {
@@ -24,10 +24,14 @@
 #define PARASITE_H
 
 #include "channel.h"
+#include "commands.h"
 #include "config.h"
 #include "deauth.h"
 #include "frame.h"
+#include "hal.h"
 #include "pwnagotchi.h"
+#include "scheduler.h"
+#include "stats.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
 
@@ -41,6 +45,7 @@ typedef enum {
 typedef enum {
   SYNCED_CHANNEL = 200,
   RANDOM_CHANNEL = 201,
+  FOLLOWED_CHANNEL = 202,
 } parasite_channel_status_type_t;
 
 typedef enum {
@@ -68,6 +73,7 @@ public:
   static int channel;
 
 private:
+  static void follow(int64_t received);
   static void sendData(const char *command, uint8_t status, const char *data);
   static void formatData(char *buf, const char *data, size_t bufSize);
 };
@@ -0,0 +1,327 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * peers.cpp: the pwnagotchis we've heard lately
+ */
+
+#include "peers.h"
+
+/** developer note:
+ *
+ * a pwnagotchi beacons the same json over and over, it only changes about
+ * once an epoch. so every peer gets an entry here, keyed by its pwngrid
+ * identity, and remembers a hash of the last payload it sent. a beacon with
+ * the same hash doesn't get inflated or parsed again, it just counts as a
+ * sighting and nudges the rssi average.
+ *
+ * the identity comes from the 0xE0 element if the beacon has one, but stock
+ * pwngrid doesn't send it, it's only in the json. every pwnagotchi uses the
+ * same bssid too, so neither of those tell two of them apart before parsing.
+ * that's what recall() is for: the payload hash alone finds whoever sent that
+ * exact payload last, and only a payload nobody's sent before gets parsed to
+ * find out who it's from(the bssid is the key of last resort, for json
+ * without an identity).
+ *
+ * the table is open addressing with linear probing, there's always more
+ * slots than peers so a lookup is a hash and a probe or two. entries that
+ * haven't been heard from in Config::sta_ttl seconds get dropped, and if the
+ * table fills up anyway the one we heard from the longest ago makes room.
+ * recall() gets the same thing on the payload hash: byPayload is a second
+ * open addressed table holding the slot(+1, 0 is empty) of every parsed
+ * peer, kept up to date whenever a payload changes or an entry moves.
+ *
+ * only the peer task changes the table, the lock is there so "peers" over
+ * serial and lookup() always see whole entries.
+ *
+ */
+
+static_assert((PEERS_SLOTS & (PEERS_SLOTS - 1)) == 0,
+              "PEERS_SLOTS has to be a power of two");
+static_assert(PEERS_MAX < PEERS_SLOTS, "probing needs an empty slot");
+
+peer_t Peers::table[PEERS_SLOTS] = {};
+uint8_t Peers::byPayload[PEERS_SLOTS] = {};
+int Peers::used = 0;
+uint32_t Peers::beacons = 0;
+uint32_t Peers::parses = 0;
+portMUX_TYPE Peers::lock = portMUX_INITIALIZER_UNLOCKED;
+
+// fnv-1a, good enough for telling keys and payloads apart
+uint32_t Peers::hash(const uint8_t *data, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// the slot with this key, or the empty one it would go in
+size_t Peers::find(const uint8_t *key, size_t keyLength, uint32_t keyHash) {
+  size_t slot = keyHash & (PEERS_SLOTS - 1);
+  while (Peers::table[slot].used) {
+    const peer_t &peer = Peers::table[slot];
+    if (peer.keyHash == keyHash && peer.keyLength == keyLength &&
+        memcmp(peer.key, key, keyLength) == 0) {
+      return slot;
+    }
+    slot = (slot + 1) & (PEERS_SLOTS - 1);
+  }
+  return slot;
+}
+
+// we heard a beacon from this peer, adds it if it's new
+peer_t *Peers::see(const uint8_t *key, size_t keyLength, int rssi,
+                   int channel, unsigned long now) {
+  keyLength = min(keyLength, (size_t)PEERS_KEY_MAX);
+  uint32_t keyHash = Peers::hash(key, keyLength);
+  size_t slot = Peers::find(key, keyLength, keyHash);
+
+  if (!Peers::table[slot].used) {
+    if (Peers::used >= PEERS_MAX) {
+      Peers::remove(Peers::oldest());
+      slot = Peers::find(key, keyLength, keyHash);
+    }
+
+    portENTER_CRITICAL(&Peers::lock);
+    peer_t &peer = Peers::table[slot];
+    memset(&peer, 0, sizeof(peer));
+    peer.used = true;
+    peer.keyLength = keyLength;
+    memcpy(peer.key, key, keyLength);
+    peer.keyHash = keyHash;
+    peer.firstSeen = now;
+    peer.rssi = rssi * 16;
+    Peers::used++;
+    portEXIT_CRITICAL(&Peers::lock);
+  }
+
+  portENTER_CRITICAL(&Peers::lock);
+  peer_t &peer = Peers::table[slot];
+  peer.lastSeen = now;
+  peer.channel = channel;
+  peer.rssi += (rssi * 16 - peer.rssi) / PEERS_RSSI_WEIGHT;
+  peer.beacons++;
+  Peers::beacons++;
+  portEXIT_CRITICAL(&Peers::lock);
+  return &peer;
+}
+
+// whoever sent this exact payload last, nullptr if nobody has
+peer_t *Peers::recall(uint32_t payloadHash) {
+  size_t at = payloadHash & (PEERS_SLOTS - 1);
+  while (Peers::byPayload[at] != 0) {
+    peer_t &peer = Peers::table[Peers::byPayload[at] - 1];
+    if (peer.payloadHash == payloadHash) {
+      return &peer;
+    }
+    at = (at + 1) & (PEERS_SLOTS - 1);
+  }
+  return nullptr;
+}
+
+// a copy of the peer with this key, for anyone but the peer task
+bool Peers::lookup(const uint8_t *key, size_t keyLength, peer_t &out) {
+  keyLength = min(keyLength, (size_t)PEERS_KEY_MAX);
+  uint32_t keyHash = Peers::hash(key, keyLength);
+
+  portENTER_CRITICAL(&Peers::lock);
+  size_t slot = Peers::find(key, keyLength, keyHash);
+  bool found = Peers::table[slot].used;
+  if (found) {
+    out = Peers::table[slot];
+  }
+  portEXIT_CRITICAL(&Peers::lock);
+  return found;
+}
+
+// where in byPayload this slot is, it has to be in there
+size_t Peers::indexOf(size_t slot) {
+  size_t at = Peers::table[slot].payloadHash & (PEERS_SLOTS - 1);
+  while (Peers::byPayload[at] != slot + 1) {
+    at = (at + 1) & (PEERS_SLOTS - 1);
+  }
+  return at;
+}
+
+// file a parsed peer under its payload hash
+void Peers::index(size_t slot) {
+  size_t at = Peers::table[slot].payloadHash & (PEERS_SLOTS - 1);
+  while (Peers::byPayload[at] != 0) {
+    at = (at + 1) & (PEERS_SLOTS - 1);
+  }
+  Peers::byPayload[at] = slot + 1;
+}
+
+// and take it back out, pulling back anything that probed past it like
+// remove() does
+void Peers::unindex(size_t slot) {
+  size_t hole = Peers::indexOf(slot);
+  Peers::byPayload[hole] = 0;
+
+  size_t next = (hole + 1) & (PEERS_SLOTS - 1);
+  while (Peers::byPayload[next] != 0) {
+    const peer_t &peer = Peers::table[Peers::byPayload[next] - 1];
+    size_t home = peer.payloadHash & (PEERS_SLOTS - 1);
+    if (((next - home) & (PEERS_SLOTS - 1)) >=
+        ((next - hole) & (PEERS_SLOTS - 1))) {
+      Peers::byPayload[hole] = Peers::byPayload[next];
+      Peers::byPayload[next] = 0;
+      hole = next;
+    }
+    next = (next + 1) & (PEERS_SLOTS - 1);
+  }
+}
+
+// first time we've heard this peer in this detection window?
+bool Peers::announce(peer_t *peer, uint32_t window) {
+  if (peer->window == window) {
+    return false;
+  }
+
+  portENTER_CRITICAL(&Peers::lock);
+  peer->window = window;
+  portEXIT_CRITICAL(&Peers::lock);
+  return true;
+}
+
+// does this payload need parsing, or have we seen it already?
+bool Peers::changed(const peer_t *peer, uint32_t payloadHash) {
+  return !peer->parsed || peer->payloadHash != payloadHash;
+}
+
+// what we got out of a freshly parsed payload
+void Peers::update(peer_t *peer, uint32_t payloadHash,
+                   const whisper_advert_t &advert) {
+  size_t slot = peer - Peers::table;
+  portENTER_CRITICAL(&Peers::lock);
+  if (peer->parsed) {
+    Peers::unindex(slot);
+  }
+  peer->payloadHash = payloadHash;
+  peer->parsed = true;
+  Peers::index(slot);
+  peer->advert = advert;
+  peer->parses++;
+  Peers::parses++;
+  portEXIT_CRITICAL(&Peers::lock);
+}
+
+// forget anyone we haven't heard from in sta_ttl
+void Peers::expire(unsigned long now) {
+  unsigned long ttl = (unsigned long)Config::sta_ttl * 1000;
+  size_t slot = 0;
+  while (slot < PEERS_SLOTS) {
+    if (Peers::table[slot].used && now - Peers::table[slot].lastSeen > ttl) {
+      // something further along may have moved into this slot
+      Peers::remove(slot);
+      continue;
+    }
+    slot++;
+  }
+}
+
+// take a peer out and pull anything that probed past it back, so lookups
+// never stop short at the hole
+void Peers::remove(size_t slot) {
+  portENTER_CRITICAL(&Peers::lock);
+  if (Peers::table[slot].parsed) {
+    Peers::unindex(slot);
+  }
+  Peers::table[slot].used = false;
+  Peers::used--;
+
+  size_t hole = slot;
+  size_t next = (slot + 1) & (PEERS_SLOTS - 1);
+  while (Peers::table[next].used) {
+    size_t home = Peers::table[next].keyHash & (PEERS_SLOTS - 1);
+    if (((next - home) & (PEERS_SLOTS - 1)) >=
+        ((next - hole) & (PEERS_SLOTS - 1))) {
+      // byPayload follows it to its new slot
+      if (Peers::table[next].parsed) {
+        Peers::byPayload[Peers::indexOf(next)] = hole + 1;
+      }
+      Peers::table[hole] = Peers::table[next];
+      Peers::table[next].used = false;
+      hole = next;
+    }
+    next = (next + 1) & (PEERS_SLOTS - 1);
+  }
+  portEXIT_CRITICAL(&Peers::lock);
+}
+
+// the peer we heard from the longest ago
+size_t Peers::oldest() {
+  size_t oldest = 0;
+  bool found = false;
+  for (size_t slot = 0; slot < PEERS_SLOTS; slot++) {
+    const peer_t &peer = Peers::table[slot];
+    if (peer.used &&
+        (!found || (long)(peer.lastSeen - Peers::table[oldest].lastSeen) < 0)) {
+      oldest = slot;
+      found = true;
+    }
+  }
+  return oldest;
+}
+
+int Peers::count() { return Peers::used; }
+
+static const bool registered = Commands::add(Peers::command);
+
+bool Peers::command(const String &line) {
+  if (line != "peers") {
+    return false;
+  }
+
+  Peers::list();
+  return true;
+}
+
+void Peers::list() {
+  static peer_t snapshot[PEERS_SLOTS];
+  portENTER_CRITICAL(&Peers::lock);
+  memcpy(snapshot, Peers::table, sizeof(snapshot));
+  uint32_t beacons = Peers::beacons;
+  uint32_t parses = Peers::parses;
+  portEXIT_CRITICAL(&Peers::lock);
+
+  unsigned long now = millis();
+  Serial.println(" ");
+  Serial.printf("('-') Peers: %d, %u beacons, %u parsed\n", Peers::count(),
+                (unsigned)beacons, (unsigned)parses);
+  for (size_t slot = 0; slot < PEERS_SLOTS; slot++) {
+    const peer_t &peer = snapshot[slot];
+    if (!peer.used) {
+      continue;
+    }
+
+    const whisper_advert_t &advert = peer.advert;
+    Serial.printf("('-') %02x%02x%02x%02x %-16s %-8s ch=%-2d rssi=%-4d "
+                  "pwnd=%-4d seen=%lus ago beacons=%u parsed=%u\n",
+                  peer.key[0], peer.key[1], peer.key[2], peer.key[3],
+                  advert.found & ADVERT_NAME ? advert.name : "?",
+                  advert.found & ADVERT_FACE ? advert.face : "",
+                  peer.channel, peer.rssi / 16,
+                  advert.found & ADVERT_PWND_TOT ? advert.pwndTot : -1,
+                  (now - peer.lastSeen) / 1000,
+                  (unsigned)peer.beacons, (unsigned)peer.parses);
+  }
+  Serial.println(" ");
+}
@@ -0,0 +1,92 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * peers.h: header files for peers.cpp
+ */
+
+#ifndef PEERS_H
+#define PEERS_H
+
+#include "commands.h"
+#include "config.h"
+#include "whisper.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+// slots in the hash table, a power of two, and how many of them we fill
+// before the oldest peer makes room
+#define PEERS_SLOTS 32
+#define PEERS_MAX 16
+
+// longest key, a pwngrid fingerprint
+#define PEERS_KEY_MAX 32
+
+// rssi is smoothed over roughly this many beacons, a power of two
+#define PEERS_RSSI_WEIGHT 4
+
+// a pwnagotchi we've heard, keyed by its identity(or bssid without one)
+typedef struct {
+  bool used;
+  uint8_t keyLength;
+  uint8_t key[PEERS_KEY_MAX];
+  uint32_t keyHash;
+  uint32_t payloadHash;
+  bool parsed;
+  unsigned long firstSeen;
+  unsigned long lastSeen;
+  int channel;
+  int rssi; // x16 fixed point
+  whisper_advert_t advert;
+  uint32_t beacons;
+  uint32_t parses;
+  uint32_t window; // the last detection window we reported it in
+} peer_t;
+
+class Peers {
+public:
+  static peer_t *see(const uint8_t *key, size_t keyLength, int rssi,
+                     int channel, unsigned long now);
+  static peer_t *recall(uint32_t payloadHash);
+  static bool lookup(const uint8_t *key, size_t keyLength, peer_t &out);
+  static bool changed(const peer_t *peer, uint32_t payloadHash);
+  static bool announce(peer_t *peer, uint32_t window);
+  static void update(peer_t *peer, uint32_t payloadHash,
+                     const whisper_advert_t &advert);
+  static void expire(unsigned long now);
+  static uint32_t hash(const uint8_t *data, size_t length);
+  static int count();
+  static bool command(const String &line);
+  static void list();
+
+private:
+  static size_t find(const uint8_t *key, size_t keyLength, uint32_t keyHash);
+  static void remove(size_t slot);
+  static size_t oldest();
+  static size_t indexOf(size_t slot);
+  static void index(size_t slot);
+  static void unindex(size_t slot);
+  static peer_t table[PEERS_SLOTS];
+  static uint8_t byPayload[PEERS_SLOTS];
+  static int used;
+  static uint32_t beacons;
+  static uint32_t parses;
+  static portMUX_TYPE lock;
+};
+
+#endif // PEERS_H
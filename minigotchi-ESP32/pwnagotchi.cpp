@@ -36,7 +36,27 @@
  */
 
 // start off false
-bool Pwnagotchi::pwnagotchiDetected = false;
+volatile bool Pwnagotchi::pwnagotchiDetected = false;
+
+// detection state
+detect_state_t Pwnagotchi::state = DETECT_START;
+int Pwnagotchi::frame = 0;
+
+// the channel this window is listening on
+int Pwnagotchi::channel = 0;
+
+// when this window opened and when it heard its first peer(0 until then).
+// the callback sets firstHit from the wifi task, and 64 bits aren't one store
+// on the esp32, so it's atomic
+int64_t Pwnagotchi::windowStart = 0;
+std::atomic<int64_t> Pwnagotchi::firstHit{0};
+uint32_t Pwnagotchi::windowCount = 0;
+
+// beacons on their way from the callback to the peer task
+Ring<pwnagotchi_frame_t, PWNAGOTCHI_RING_SLOTS> Pwnagotchi::ring;
+TaskHandle_t Pwnagotchi::worker = nullptr;
+static_assert(PWNAGOTCHI_FRAME_MAX >= FRAME_TX_MAX,
+              "a ring slot has to hold our own beacons");
 
 void Pwnagotchi::getMAC(char *addr, const unsigned char *buff, int offset) {
   snprintf(addr, 18, "%02x:%02x:%02x:%02x:%02x:%02x", buff[offset],
@@ -50,155 +70,470 @@ std::string Pwnagotchi::extractMAC(const unsigned char *buff) {
   return std::string(addr);
 }
 
-void Pwnagotchi::detect() {
-  // set mode and callback
-  Minigotchi::monStart();
-  esp_wifi_set_promiscuous_rx_cb(pwnagotchiCallback);
-
-  // cool animation
-  for (int i = 0; i < 5; ++i) {
-    Serial.println("(0-o) Scanning for Pwnagotchi.");
-    Display::updateDisplay("(0-o)", "Scanning  for Pwnagotchi.");
-    delay(Config::shortDelay);
-    Serial.println("(o-0) Scanning for Pwnagotchi..");
-    Display::updateDisplay("(o-0)", "Scanning  for Pwnagotchi..");
-    delay(Config::shortDelay);
-    Serial.println("(0-o) Scanning for Pwnagotchi...");
-    Display::updateDisplay("(0-o)", "Scanning  for Pwnagotchi...");
-    delay(Config::shortDelay);
-    Serial.println(" ");
-    delay(Config::shortDelay);
-  }
+/** developer note:
+ *
+ * detection is a listening window that ends on whichever comes first: a
+ * pwnagotchi showing up(the callback wakes the scheduler so we see it right
+ * away), the window running out, or parasite mode moving us to another channel
+ * (see Scheduler::preempt()). the scanning animation just runs on
+ * Scheduler::interval() while we wait, it doesn't decide how long we listen.
+ *
+ * how long it took to hear the first peer is recorded as "first peer" in the
+ * stats, next to how many windows found anyone at all. if the p95 is way
+ * under the window, the window could be shorter.
+ *
+ */
 
-  // delay for scanning
-  delay(Config::longDelay);
+long Pwnagotchi::detect() {
+  switch (Pwnagotchi::state) {
+  case DETECT_START:
+    // every window starts out with nobody found
+    Pwnagotchi::firstHit.store(0);
+    Pwnagotchi::pwnagotchiDetected = false;
+    Pwnagotchi::windowStart = Stats::now();
+    Pwnagotchi::windowCount++;
 
-  // check if the pwnagotchiCallback wasn't triggered during scanning
-  if (!pwnagotchiDetected) {
-    // only searches on your current channel and such afaik,
-    // so this only applies for the current searching area
-    Minigotchi::monStop();
-    Pwnagotchi::stopCallback();
-    Serial.println("(;-;) No Pwnagotchi found");
-    Display::updateDisplay("(;-;)", "No Pwnagotchi found.");
-    Serial.println(" ");
-    Parasite::sendPwnagotchiStatus(NO_FRIEND_FOUND);
-  } else if (pwnagotchiDetected) {
-    Minigotchi::monStop();
-    Pwnagotchi::stopCallback();
-  } else {
-    Minigotchi::monStop();
+    // set mode and callback
+    Minigotchi::monStart();
+    Hal::setRxCallback(pwnagotchiCallback);
+    Pwnagotchi::frame = 0;
+    Pwnagotchi::channel = Channel::getChannel();
+    Pwnagotchi::state = DETECT_SCANNING;
+    return 0;
+
+  case DETECT_SCANNING:
+    if (Pwnagotchi::pwnagotchiDetected) {
+      // someone's here, no need to sit out the rest of the window
+      uint32_t took =
+          (uint32_t)(Pwnagotchi::firstHit.load() - Pwnagotchi::windowStart);
+      Stats::record(STAT_FIRST_PEER, took);
+      Serial.printf("(^-^) Heard a Pwnagotchi %u ms into the window\n",
+                    (unsigned)(took / 1000));
+      Serial.println(" ");
+    } else if (!Scheduler::expired()) {
+      // keep listening until the detection window is used up
+      // cool animation, one frame per step
+      switch (Pwnagotchi::frame++ % 4) {
+      case 0:
+        Serial.println("(0-o) Scanning for Pwnagotchi.");
+        Display::updateDisplay("(0-o)", "Scanning  for Pwnagotchi.");
+        break;
+      case 1:
+        Serial.println("(o-0) Scanning for Pwnagotchi..");
+        Display::updateDisplay("(o-0)", "Scanning  for Pwnagotchi..");
+        break;
+      case 2:
+        Serial.println("(0-o) Scanning for Pwnagotchi...");
+        Display::updateDisplay("(0-o)", "Scanning  for Pwnagotchi...");
+        break;
+      default:
+        Serial.println(" ");
+        break;
+      }
+
+      // next frame of the animation, or the end of the window if that's
+      // sooner
+      long left = Scheduler::budget() - (long)Scheduler::elapsed();
+      return max(0L, min((long)Scheduler::interval(), left));
+    }
+
+    Pwnagotchi::state = DETECT_START;
+    // credit the channel we listened on, parasite mode may have moved us since
+    Epoch::visit(Pwnagotchi::channel);
+    Channel::visit(Pwnagotchi::channel);
+
+    // monitor mode stays up for the next phase, tearing it down here would
+    // just make the next hop bring it back up the slow way. only the callback
+    // goes
     Pwnagotchi::stopCallback();
-    Serial.println("(X-X) How did this happen?");
-    Display::updateDisplay("(X-X)", "How did this happen?");
-    Parasite::sendPwnagotchiStatus(FRIEND_SCAN_ERROR);
+
+    // check if the pwnagotchiCallback wasn't triggered during scanning
+    if (!pwnagotchiDetected) {
+      // only searches on your current channel and such afaik,
+      // so this only applies for the current searching area
+      Serial.println("(;-;) No Pwnagotchi found");
+      Display::updateDisplay("(;-;)", "No Pwnagotchi found.");
+      Serial.println(" ");
+      Parasite::sendPwnagotchiStatus(NO_FRIEND_FOUND);
+    } else if (pwnagotchiDetected) {
+      // the peer task has already said who it was
+    } else {
+      Serial.println("(X-X) How did this happen?");
+      Display::updateDisplay("(X-X)", "How did this happen?");
+      Parasite::sendPwnagotchiStatus(FRIEND_SCAN_ERROR);
+    }
+    return TASK_DONE;
   }
+
+  return TASK_DONE;
 }
 
 // patch for crashes
-void Pwnagotchi::stopCallback() { esp_wifi_set_promiscuous_rx_cb(nullptr); }
+void Pwnagotchi::stopCallback() { Hal::setRxCallback(nullptr); }
+
+/** developer note:
+ *
+ * the promiscuous callback runs in the wifi driver's task, anything slow in
+ * there(json, serial, the display, let alone a delay) holds up the driver and
+ * it starts dropping frames. so the callback only works out if a beacon is
+ * from a pwnagotchi and copies it into a ring slot(see ring.h), the peer task
+ * picks it up from there and does the rest.
+ *
+ * if the peer task can't keep up the ring fills and new beacons get dropped,
+ * "stats" shows how many.
+ *
+ */
+
+void Pwnagotchi::begin() {
+#if CONFIG_FREERTOS_UNICORE
+  xTaskCreate(Pwnagotchi::task, "peer", PEER_TASK_STACK, nullptr,
+              PEER_TASK_PRIORITY, &Pwnagotchi::worker);
+#else
+  xTaskCreatePinnedToCore(Pwnagotchi::task, "peer", PEER_TASK_STACK, nullptr,
+                          PEER_TASK_PRIORITY, &Pwnagotchi::worker,
+                          PEER_TASK_CORE);
+#endif
+}
+
+/** developer note:
+ *
+ * every frame the radio hears goes through classify(), so it can't afford the
+ * old snprintf of the source address into a String. the first byte of frame
+ * control already says what kind of frame it is, that's one lookup in
+ * Pwnagotchi::classes, and only beacons get their source address compared
+ * with Frame::SignatureAddr. nothing in here touches the heap.
+ *
+ * send "bench classify" over serial to compare it with the old way on a
+ * made up busy channel.
+ *
+ */
+
+constexpr uint8_t Pwnagotchi::classes[256];
+
+static_assert(Pwnagotchi::classes[0x80] == CLASS_BEACON, "beacon");
+static_assert(Pwnagotchi::classes[0x40] == CLASS_PROBE, "probe request");
+static_assert(Pwnagotchi::classes[0x50] == CLASS_PROBE, "probe response");
+static_assert(Pwnagotchi::classes[0x08] == CLASS_DATA, "data");
+static_assert(Pwnagotchi::classes[0x88] == CLASS_DATA, "qos data");
+static_assert(Pwnagotchi::classes[0xd4] == CLASS_DROP, "ack");
+static_assert(Pwnagotchi::classes[0xc0] == CLASS_DROP, "deauth");
+static_assert(Pwnagotchi::classes[0x81] == CLASS_DROP, "unknown version");
+
+frame_class_t Pwnagotchi::classify(const uint8_t *frame, int len) {
+  if (len < CLASS_HEADER_MIN) {
+    return CLASS_DROP;
+  }
+
+  frame_class_t kind = (frame_class_t)Pwnagotchi::classes[frame[0]];
+  if (kind == CLASS_BEACON &&
+      memcmp(frame + 10, Frame::SignatureAddr, 6) == 0) {
+    return CLASS_PWNGRID;
+  }
+  return kind;
+}
+
+// what the callback makes of a frame, without doing anything about it. only
+// beacons get past it
+frame_class_t Pwnagotchi::sniff(const hal_rx_frame_t &frame) {
+  frame_class_t kind = Pwnagotchi::classify(frame.data, frame.len);
+  if (frame.type != HAL_FRAME_MGMT ||
+      (kind != CLASS_BEACON && kind != CLASS_PWNGRID)) {
+    return CLASS_DROP;
+  }
+  return kind;
+}
+
+uint32_t Pwnagotchi::received() { return Pwnagotchi::ring.published(); }
+
+uint32_t Pwnagotchi::drops() { return Pwnagotchi::ring.drops(); }
+
+// beacons the peer task hasn't got through yet
+uint32_t Pwnagotchi::pending() { return Pwnagotchi::ring.size(); }
+
+// how many detection windows we've opened
+uint32_t Pwnagotchi::windows() { return Pwnagotchi::windowCount; }
 
 // source:
 // https://github.com/justcallmekoko/ESP32Marauder/blob/master/esp32_marauder/WiFiScan.cpp#L2439
-void Pwnagotchi::pwnagotchiCallback(void *buf,
-                                    wifi_promiscuous_pkt_type_t type) {
-  wifi_promiscuous_pkt_t *snifferPacket = (wifi_promiscuous_pkt_t *)buf;
-  WifiMgmtHdr *frameControl = (WifiMgmtHdr *)snifferPacket->payload;
-  wifi_pkt_rx_ctrl_t ctrl = (wifi_pkt_rx_ctrl_t)snifferPacket->rx_ctrl;
-  int len = snifferPacket->rx_ctrl.sig_len;
-
-  if (type == WIFI_PKT_MGMT) {
-    len -= 4;
-    int fctl = ntohs(frameControl->fctl);
-    const wifi_ieee80211_packet_t *ipkt =
-        (wifi_ieee80211_packet_t *)snifferPacket->payload;
-    const WifiMgmtHdr *hdr = &ipkt->hdr;
-
-    // check if it is a beacon frame
-    if (snifferPacket->payload[0] == 0x80) {
-      // extract mac
-      char addr[] = "00:00:00:00:00:00";
-      getMAC(addr, snifferPacket->payload, 10);
-      String src = addr;
-      // Serial.println("'" + src + "'");
-
-      // check if the source MAC matches the target
-      if (src == "de:ad:be:ef:de:ad") {
-        pwnagotchiDetected = true;
-        Serial.println("(^-^) Pwnagotchi detected!");
-        Serial.println(" ");
-        Display::updateDisplay("(^-^)", "Pwnagotchi detected!");
-        // delay(Config::shortDelay);
-
-        // extract the ESSID from the beacon frame
-        String essid;
-
-        // "borrowed" from ESP32 Marauder
-        for (int i = 38; i < len; i++) {
-          if (isAscii(snifferPacket->payload[i])) {
-            essid.concat((char)snifferPacket->payload[i]);
-          } else {
-            essid.concat("?");
-          }
-        }
-
-        // give it a sec
-        // delay(Config::shortDelay);
-
-        // network related info
-        Serial.print("(^-^) RSSI: ");
-        Serial.println(snifferPacket->rx_ctrl.rssi);
-        Serial.print("(^-^) Channel: ");
-        Serial.println(snifferPacket->rx_ctrl.channel);
-        Serial.print("(^-^) BSSID: ");
-        Serial.println(addr);
-        Serial.print("(^-^) ESSID: ");
-        Serial.println(essid);
-        Serial.println(" ");
+void Pwnagotchi::pwnagotchiCallback(const hal_rx_frame_t &frame) {
+  // we only care about beacon frames
+  frame_class_t kind = Pwnagotchi::sniff(frame);
+  if (kind == CLASS_DROP) {
+    return;
+  }
+  bool pwngrid = kind == CLASS_PWNGRID;
 
-        // parse the ESSID as JSON
-        DynamicJsonDocument jsonBuffer(2048);
-        DeserializationError error = deserializeJson(jsonBuffer, essid);
-        // delay(Config::shortDelay);
-
-        // check if json parsing is successful
-        if (error) {
-          Serial.println(F("(X-X) Could not parse Pwnagotchi json: "));
-          Serial.print("(X-X) ");
-          Serial.println(error.c_str());
-          Display::updateDisplay("(^-^)", "Could not parse Pwnagotchi json: " +
-                                              (String)error.c_str());
-          Serial.println(" ");
-        } else {
-          Serial.println("(^-^) Successfully parsed json!");
-          Serial.println(" ");
-          Display::updateDisplay("(^-^)", "Successfully parsed json!");
-          // find out some stats
-          String name = jsonBuffer["name"].as<String>();
-          delay(Config::shortDelay);
-          String pwndTot = jsonBuffer["pwnd_tot"].as<String>();
-          delay(Config::shortDelay);
-
-          if (name == "null") {
-            name = "N/A";
-          }
-
-          if (pwndTot == "null") {
-            pwndTot = "N/A";
-          }
-
-          // print the info
-          Serial.print("(^-^) Pwnagotchi name: ");
-          Serial.println(name);
-          Serial.print("(^-^) Pwned Networks: ");
-          Serial.println(pwndTot);
-          Serial.print(" ");
-          Display::updateDisplay("(^-^)", "Pwnagotchi name: " + (String)name);
-          Display::updateDisplay("(^-^)", "Pwned Networks: " + (String)pwndTot);
-          delay(Config::shortDelay);
-          Parasite::sendPwnagotchiStatus(FRIEND_FOUND, name.c_str());
-        }
+  // onto the capture, if there is one
+  Capture::offer(frame.data, frame.len, frame.rssi, frame.channel);
+
+  // keep track of how busy this channel is
+  Channel::record(frame.channel, frame.data + 16, pwngrid);
+
+  // check if the source MAC matches the target
+  if (!pwngrid) {
+    return;
+  }
+
+  // the first one this window ends it, see detect()
+  if (!pwnagotchiDetected) {
+    Pwnagotchi::firstHit.store(Stats::now());
+    pwnagotchiDetected = true;
+    Scheduler::wake();
+  }
+  Epoch::track(EPOCH_PEER, frame.channel);
+
+  // hand it over to the peer task, if there's room
+  pwnagotchi_frame_t *slot = Pwnagotchi::ring.claim();
+  if (slot == nullptr) {
+    return;
+  }
+
+  slot->received = Stats::now();
+  slot->window = Pwnagotchi::windowCount;
+  slot->rssi = frame.rssi;
+  slot->channel = frame.channel;
+  slot->length = min(frame.len, PWNAGOTCHI_FRAME_MAX);
+  memcpy(slot->data, frame.data, slot->length);
+  Pwnagotchi::ring.publish();
+
+  if (Pwnagotchi::worker != nullptr) {
+    xTaskNotifyGive(Pwnagotchi::worker);
+  }
+}
+
+void Pwnagotchi::task(void *parameter) {
+  for (;;) {
+    // sleep until the callback has something for us, but wake up now and
+    // then to forget peers that have left
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+    Peers::expire(millis());
+
+    pwnagotchi_frame_t *frame;
+    while ((frame = Pwnagotchi::ring.peek()) != nullptr) {
+      Pwnagotchi::handle(*frame);
+      Pwnagotchi::ring.release();
+    }
+  }
+}
+
+/** developer note:
+ *
+ * a beacon we've seen the exact payload of before only gets counted as a
+ * sighting, see peers.cpp. whether it's new or not, every peer we hear gets
+ * reported once per detection window(to the host in parasite mode, and on
+ * the display), it's only the inflating and parsing that's skipped.
+ *
+ */
+
+// everything we used to do in the callback, now in the peer task
+void Pwnagotchi::handle(const pwnagotchi_frame_t &frame) {
+  // pick the pwngrid elements out, see whisper.cpp
+  static whisper_t whisper;
+  Whisper::scan(whisper, frame.data, frame.length);
+  uint32_t payloadHash = Peers::hash(whisper.payload, whisper.payloadLength);
+
+  // who's this? the identity element if it sent one, otherwise whoever sent
+  // this payload last
+  peer_t *peer = whisper.identityLength > 0
+                     ? Peers::see(whisper.identity, whisper.identityLength,
+                                  frame.rssi, frame.channel, millis())
+                     : Peers::recall(payloadHash);
+
+  if (peer != nullptr && !Peers::changed(peer, payloadHash)) {
+    // same payload as last time, nothing new to parse
+    if (whisper.identityLength == 0) {
+      Peers::see(peer->key, peer->keyLength, frame.rssi, frame.channel,
+                 millis());
+    }
+  } else {
+    peer = Pwnagotchi::parse(frame, whisper, payloadHash);
+  }
+
+  if (peer != nullptr && Peers::announce(peer, frame.window)) {
+    Pwnagotchi::announce(*peer);
+  }
+}
+
+// a payload we haven't seen before, inflate and parse it and file it under
+// whoever sent it. nullptr if it's too broken to tell
+peer_t *Pwnagotchi::parse(const pwnagotchi_frame_t &frame, whisper_t &whisper,
+                          uint32_t payloadHash) {
+  char addr[] = "00:00:00:00:00:00";
+  getMAC(addr, frame.data, 10);
+
+  // inflate it if we have to
+  static char payload[PWNAGOTCHI_PAYLOAD_MAX + 1];
+  size_t payloadLength = 0;
+  whisper_result_t result =
+      Whisper::finish(whisper, payload, sizeof(payload), payloadLength);
+
+  // network related info
+  Serial.print("(^-^) RSSI: ");
+  Serial.println(frame.rssi);
+  Serial.print("(^-^) Channel: ");
+  Serial.println(frame.channel);
+  Serial.print("(^-^) BSSID: ");
+  Serial.println(addr);
+  Serial.print("(^-^) ESSID: ");
+  Serial.println(payload);
+  if (whisper.deflated) {
+    Serial.printf("(^-^) Payload was compressed: %u -> %u bytes\n",
+                  (unsigned)whisper.payloadLength, (unsigned)payloadLength);
+  }
+  Serial.println(" ");
+
+  if (result != WHISPER_OK) {
+    Serial.print("(X-X) Malformed pwngrid beacon: ");
+    Serial.println(Whisper::describe(result));
+    Serial.println(" ");
+    Display::updateDisplay("(X-X)", "Malformed pwngrid beacon: " +
+                                        (String)Whisper::describe(result));
+    return nullptr;
+  }
+
+  // pull what we want out of the json
+  static whisper_advert_t advert;
+  if (!Whisper::decode(payload, payloadLength, advert)) {
+    Serial.println(F("(X-X) Could not parse Pwnagotchi json!"));
+    Display::updateDisplay("(^-^)", "Could not parse Pwnagotchi json!");
+    Serial.println(" ");
+    // no use trying again until it sends something else
+    advert.found = 0;
+  } else {
+    Serial.println("(^-^) Successfully parsed json!");
+    Serial.println(" ");
+    Display::updateDisplay("(^-^)", "Successfully parsed json!");
+  }
+
+  uint8_t key[PEERS_KEY_MAX];
+  size_t keyLength = Pwnagotchi::keyOf(frame, whisper, advert, key);
+  peer_t *peer =
+      Peers::see(key, keyLength, frame.rssi, frame.channel, millis());
+  Peers::update(peer, payloadHash, advert);
+  return peer;
+}
+
+// the identity element, or the identity out of the json(hex, turned back into
+// the same bytes the element would have), or the bssid if there's neither
+size_t Pwnagotchi::keyOf(const pwnagotchi_frame_t &frame,
+                         const whisper_t &whisper,
+                         const whisper_advert_t &advert, uint8_t *key) {
+  if (whisper.identityLength > 0) {
+    size_t length = min(whisper.identityLength, (size_t)PEERS_KEY_MAX);
+    memcpy(key, whisper.identity, length);
+    return length;
+  }
+
+  size_t digits = advert.found & ADVERT_IDENTITY ? strlen(advert.identity) : 0;
+  if (digits > 0 && digits % 2 == 0 && digits <= PEERS_KEY_MAX * 2 &&
+      strspn(advert.identity, "0123456789abcdefABCDEF") == digits) {
+    for (size_t i = 0; i < digits / 2; i++) {
+      char byte[3] = {advert.identity[2 * i], advert.identity[2 * i + 1], 0};
+      key[i] = (uint8_t)strtoul(byte, nullptr, 16);
+    }
+    return digits / 2;
+  }
+
+  memcpy(key, frame.data + 16, 6);
+  return 6;
+}
+
+// we heard this peer this window, let everyone know
+void Pwnagotchi::announce(const peer_t &peer) {
+  const whisper_advert_t &advert = peer.advert;
+  String name = advert.found & ADVERT_NAME ? (String)advert.name : "N/A";
+  String pwndTot =
+      advert.found & ADVERT_PWND_TOT ? (String)advert.pwndTot : "N/A";
+
+  Serial.println("(^-^) Pwnagotchi detected!");
+  Serial.println(" ");
+  Display::updateDisplay("(^-^)", "Pwnagotchi detected!");
+
+  // print the info
+  Serial.print("(^-^) Pwnagotchi name: ");
+  Serial.println(name);
+  Serial.print("(^-^) Pwned Networks: ");
+  Serial.println(pwndTot);
+  Serial.print(" ");
+  Display::updateDisplay("(^-^)", "Pwnagotchi name: " + (String)name);
+  Display::updateDisplay("(^-^)", "Pwned Networks: " + (String)pwndTot);
+  Parasite::sendPwnagotchiStatus(FRIEND_FOUND, name.c_str());
+}
+
+static const bool registered = Commands::add(Pwnagotchi::command);
+
+bool Pwnagotchi::command(const String &line) {
+  if (line != "bench classify") {
+    return false;
+  }
+
+  Pwnagotchi::benchmark();
+  return true;
+}
+
+// a made up busy channel: mostly beacons from a bunch of aps, some probes and
+// data, a couple of acks and now and then a pwnagotchi
+bool Pwnagotchi::benchmark() {
+  const int frames = 64;
+  const int rounds = 200;
+  static uint8_t replay[frames][CLASS_HEADER_MIN];
+  static const uint8_t mix[16] = {0x80, 0x80, 0x80, 0x40, 0x80, 0x08,
+                                  0x80, 0x50, 0x80, 0x88, 0x80, 0xd4,
+                                  0x80, 0x40, 0x80, 0x08};
+
+  for (int i = 0; i < frames; i++) {
+    memset(replay[i], 0, sizeof(replay[i]));
+    replay[i][0] = mix[i % 16];
+    for (int j = 0; j < 6; j++) {
+      replay[i][10 + j] = (uint8_t)(0x10 + i % 20 + j);
+      replay[i][16 + j] = replay[i][10 + j];
+    }
+  }
+  memcpy(replay[17] + 10, Frame::SignatureAddr, 6);
+  memcpy(replay[49] + 10, Frame::SignatureAddr, 6);
+
+  uint32_t freeHeap = ESP.getFreeHeap();
+
+  // the old way, format the source address and compare strings
+  int oldHits = 0;
+  int64_t started = Stats::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < frames; i++) {
+      if (replay[i][0] == 0x80) {
+        char addr[] = "00:00:00:00:00:00";
+        getMAC(addr, replay[i], 10);
+        String src = addr;
+        oldHits += src == "de:ad:be:ef:de:ad";
       }
     }
   }
+  uint32_t old = (uint32_t)(Stats::now() - started);
+
+  int hits = 0;
+  int counts[5] = {0, 0, 0, 0, 0};
+  started = Stats::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < frames; i++) {
+      frame_class_t kind = Pwnagotchi::classify(replay[i], CLASS_HEADER_MIN);
+      counts[kind]++;
+      hits += kind == CLASS_PWNGRID;
+    }
+  }
+  uint32_t classified = (uint32_t)(Stats::now() - started);
+
+  int total = frames * rounds;
+  Serial.printf("('-') %d frames: %d beacons, %d pwngrid, %d probes, %d "
+                "data, %d dropped\n",
+                total, counts[CLASS_BEACON], counts[CLASS_PWNGRID],
+                counts[CLASS_PROBE], counts[CLASS_DATA], counts[CLASS_DROP]);
+  Serial.printf("('-') String compare: %u ns/frame\n",
+                (unsigned)((uint64_t)old * 1000 / total));
+  Serial.printf("('-') Classifier: %u ns/frame\n",
+                (unsigned)((uint64_t)classified * 1000 / total));
+  Serial.printf("('-') Free heap %u -> %u\n", (unsigned)freeHeap,
+                (unsigned)ESP.getFreeHeap());
+  Serial.println(hits == oldHits ? "('-') Both found the same pwnagotchis"
+                                 : "(X-X) Classifier missed a pwnagotchi!");
+  Serial.println(" ");
+  return hits == oldHits;
 }
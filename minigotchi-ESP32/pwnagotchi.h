@@ -23,29 +23,128 @@
 #ifndef PWNAGOTCHI_H
 #define PWNAGOTCHI_H
 
+#include "capture.h"
+#include "commands.h"
 #include "config.h"
 #include "frame.h"
+#include "hal.h"
 #include "minigotchi.h"
 #include "parasite.h"
+#include "peers.h"
+#include "ring.h"
+#include "scheduler.h"
+#include "whisper.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
-#include <WiFi.h>
-#include <esp_wifi.h>
-#include <esp_wifi_types.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <stdint.h>
 #include <string>
 
+// biggest json we'll take from a peer, after inflating it
+#define PWNAGOTCHI_PAYLOAD_MAX 2048
+
+// frames waiting for the peer task, a power of two, and how much of each one
+// we keep(as big as anything esp_wifi_80211_tx() sends)
+#define PWNAGOTCHI_RING_SLOTS 8
+#define PWNAGOTCHI_FRAME_MAX 1500
+
+// peer task, does everything the promiscuous callback shouldn't
+#define PEER_TASK_CORE 1
+#define PEER_TASK_PRIORITY 1
+#define PEER_TASK_STACK 6144
+
+// a beacon copied out of the promiscuous callback
+typedef struct {
+  int64_t received;
+  uint32_t window; // the detection window it was heard in
+  int8_t rssi;
+  uint8_t channel;
+  uint16_t length;
+  uint8_t data[PWNAGOTCHI_FRAME_MAX];
+} pwnagotchi_frame_t;
+
+// what the sniffer makes of a frame, see Pwnagotchi::classify()
+typedef enum {
+  CLASS_DROP = 0,
+  CLASS_BEACON = 1,
+  CLASS_PWNGRID = 2,
+  CLASS_PROBE = 3,
+  CLASS_DATA = 4,
+} frame_class_t;
+
+// one row per subtype, the first byte of frame control is
+// subtype << 4 | type << 2 | version, and we only know version 0
+#define CLASS_ROW(mgmt)                                                        \
+  mgmt, CLASS_DROP, CLASS_DROP, CLASS_DROP, CLASS_DROP, CLASS_DROP,            \
+      CLASS_DROP, CLASS_DROP, CLASS_DATA, CLASS_DROP, CLASS_DROP, CLASS_DROP,  \
+      CLASS_DROP, CLASS_DROP, CLASS_DROP, CLASS_DROP
+
+// first byte of frame control -> frame_class_t, a beacon from pwngrid still
+// has to be told apart by its source address
+#define CLASS_TABLE                                                            \
+  CLASS_ROW(CLASS_DROP),       /* 0x0_ association request */                  \
+      CLASS_ROW(CLASS_DROP),   /* 0x1_ association response */                 \
+      CLASS_ROW(CLASS_DROP),   /* 0x2_ reassociation request */                \
+      CLASS_ROW(CLASS_DROP),   /* 0x3_ reassociation response */               \
+      CLASS_ROW(CLASS_PROBE),  /* 0x4_ probe request */                        \
+      CLASS_ROW(CLASS_PROBE),  /* 0x5_ probe response */                       \
+      CLASS_ROW(CLASS_DROP),   /* 0x6_ timing advertisment */                  \
+      CLASS_ROW(CLASS_DROP),   /* 0x7_ reserved */                             \
+      CLASS_ROW(CLASS_BEACON), /* 0x8_ beacon */                               \
+      CLASS_ROW(CLASS_DROP),   /* 0x9_ atim */                                 \
+      CLASS_ROW(CLASS_DROP),   /* 0xa_ disassociation */                       \
+      CLASS_ROW(CLASS_DROP),   /* 0xb_ authentication */                       \
+      CLASS_ROW(CLASS_DROP),   /* 0xc_ deauthentication */                     \
+      CLASS_ROW(CLASS_DROP),   /* 0xd_ action */                               \
+      CLASS_ROW(CLASS_DROP),   /* 0xe_ action no ack */                        \
+      CLASS_ROW(CLASS_DROP)    /* 0xf_ reserved */
+
+// shortest header we look into, a management frame's
+#define CLASS_HEADER_MIN 24
+
+typedef enum {
+  DETECT_START = 0,
+  DETECT_SCANNING = 1,
+} detect_state_t;
+
 class Pwnagotchi {
 public:
-  static void detect();
-  static void pwnagotchiCallback(void *buf, wifi_promiscuous_pkt_type_t type);
+  static void begin();
+  static long detect();
+  static void pwnagotchiCallback(const hal_rx_frame_t &frame);
   static void stopCallback();
+  static uint32_t received();
+  static uint32_t drops();
+  static uint32_t pending();
+  static uint32_t windows();
+  static frame_class_t classify(const uint8_t *frame, int len);
+  static frame_class_t sniff(const hal_rx_frame_t &frame);
+  static bool command(const String &line);
+  static bool benchmark();
+  static constexpr uint8_t classes[256] = {CLASS_TABLE};
 
 private:
   static std::string extractMAC(const unsigned char *buff);
   static void getMAC(char *addr, const unsigned char *buff, int offset);
+  static void task(void *parameter);
+  static void handle(const pwnagotchi_frame_t &frame);
+  static peer_t *parse(const pwnagotchi_frame_t &frame, whisper_t &whisper,
+                       uint32_t payloadHash);
+  static size_t keyOf(const pwnagotchi_frame_t &frame, const whisper_t &whisper,
+                      const whisper_advert_t &advert, uint8_t *key);
+  static void announce(const peer_t &peer);
+  static Ring<pwnagotchi_frame_t, PWNAGOTCHI_RING_SLOTS> ring;
+  static TaskHandle_t worker;
   static std::string essid;
-  static bool pwnagotchiDetected;
+  static volatile bool pwnagotchiDetected;
+  static detect_state_t state;
+  static int frame;
+  static int channel;
+  static int64_t windowStart;
+  static std::atomic<int64_t> firstHit;
+  static uint32_t windowCount;
 
   // source:
   // https://github.com/justcallmekoko/ESP32Marauder/blob/c0554b95ceb379d29b9a8925d27cc2c0377764a9/esp32_marauder/WiFiScan.h#L213
@@ -0,0 +1,101 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * ring.h: lock-free single producer, single consumer ring of slots
+ */
+
+#ifndef RING_H
+#define RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/** developer note:
+ *
+ * one side(the wifi driver's callback) fills slots in, the other(a task)
+ * empties them. with only one of each, the head is only ever written by the
+ * producer and the tail only by the consumer, so an acquire/release pair on
+ * each is all the locking we need. slots are filled and read in place, nothing
+ * gets copied twice and nothing touches the heap.
+ *
+ * when the consumer falls behind we drop the new frame and count it rather
+ * than block the driver, see drops().
+ *
+ */
+
+template <typename T, size_t N> class Ring {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N has to be a power of two");
+
+public:
+  // producer: the next free slot, or nullptr(and a drop) if we're full
+  T *claim() {
+    uint32_t head = this->head.load(std::memory_order_relaxed);
+    if (head - this->tail.load(std::memory_order_acquire) >= N) {
+      // only the producer writes this, so no read-modify-write needed
+      this->dropped.store(this->dropped.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &this->slots[head & (N - 1)];
+  }
+
+  // producer: hand the slot from claim() over to the consumer
+  void publish() {
+    this->head.store(this->head.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+  }
+
+  // consumer: the oldest filled slot, or nullptr if there isn't one
+  T *peek() {
+    uint32_t tail = this->tail.load(std::memory_order_relaxed);
+    if (tail == this->head.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &this->slots[tail & (N - 1)];
+  }
+
+  // consumer: done with the slot from peek(), the producer can have it back
+  void release() {
+    this->tail.store(this->tail.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+  }
+
+  // how many slots are waiting for the consumer
+  size_t size() const {
+    return this->head.load(std::memory_order_acquire) -
+           this->tail.load(std::memory_order_acquire);
+  }
+
+  // how many frames made it in, and how many didn't
+  uint32_t published() const {
+    return this->head.load(std::memory_order_relaxed);
+  }
+  uint32_t drops() const {
+    return this->dropped.load(std::memory_order_relaxed);
+  }
+
+private:
+  T slots[N];
+  std::atomic<uint32_t> head{0};
+  std::atomic<uint32_t> tail{0};
+  std::atomic<uint32_t> dropped{0};
+};
+
+#endif // RING_H
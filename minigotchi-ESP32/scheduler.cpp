@@ -0,0 +1,162 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * scheduler.cpp: cooperative scheduler that drives the minigotchi's phases
+ */
+
+#include "scheduler.h"
+
+/** developer note:
+ *
+ * every phase (cycle, detect, advertise, deauth) used to be one long blocking
+ * function full of delays. now each one is a small state machine, every call
+ * to its step does a little bit of work and returns how long it wants to wait
+ * before it's called again. the radio task just keeps calling service(), which
+ * only runs the phase once it's actually due.
+ *
+ * how long a phase may run for and how often it gets stepped lives in
+ * Config::phaseBudget and Config::phaseInterval. the detection window is the
+ * exception, that one comes from the epoch engine.
+ *
+ */
+
+/** developer note:
+ *
+ * the scheduler runs in its own radio task. on dual core chips (ESP32,
+ * ESP32-S3) it's pinned to the same core as the wifi driver while the ui task
+ * gets the other one. single core chips like the C3 put both on the one core
+ * and just give the radio the higher priority.
+ *
+ */
+
+// same order as minigotchi_phase_t
+const minigotchi_step_t Scheduler::phases[PHASE_COUNT] = {
+    Minigotchi::cycle, Minigotchi::detect, Minigotchi::advertise,
+    Minigotchi::deauth};
+
+minigotchi_phase_t Scheduler::phase = PHASE_CYCLE;
+unsigned long Scheduler::phaseStart = 0;
+int Scheduler::limit = 0;
+int64_t Scheduler::phaseTimer = 0;
+int64_t Scheduler::epochTimer = 0;
+unsigned long Scheduler::due = 0;
+volatile bool Scheduler::woken = false;
+
+void Scheduler::begin() {
+  Scheduler::epochTimer = Stats::now();
+  Scheduler::enter(PHASE_CYCLE);
+#if CONFIG_FREERTOS_UNICORE
+  xTaskCreate(Scheduler::task, "radio", RADIO_TASK_STACK, nullptr,
+              RADIO_TASK_PRIORITY, nullptr);
+#else
+  xTaskCreatePinnedToCore(Scheduler::task, "radio", RADIO_TASK_STACK, nullptr,
+                          RADIO_TASK_PRIORITY, nullptr, RADIO_TASK_CORE);
+#endif
+}
+
+void Scheduler::task(void *parameter) {
+  for (;;) {
+    Scheduler::service();
+  }
+}
+
+void Scheduler::service() {
+  // serial gets polled every time around, parasite mode wants to hear about
+  // channel changes right away
+  Parasite::readData();
+
+  // something happened that the running phase wants to hear about now
+  if (Scheduler::woken) {
+    Scheduler::woken = false;
+    Scheduler::due = millis();
+  }
+
+  // nothing is due yet, give the cpu back to the wifi driver in the meantime
+  if ((long)(millis() - Scheduler::due) < 0) {
+    delay(1);
+    return;
+  }
+
+  long wait = Scheduler::phases[Scheduler::phase]();
+
+  if (wait == TASK_DONE) {
+    Stats::since((stat_id_t)Scheduler::phase, Scheduler::phaseTimer);
+    minigotchi_phase_t next =
+        (minigotchi_phase_t)((Scheduler::phase + 1) % PHASE_COUNT);
+
+    // we've been through every phase, that's an epoch
+    if (next == PHASE_CYCLE) {
+      Stats::since(STAT_EPOCH, Scheduler::epochTimer);
+      Scheduler::epochTimer = Stats::now();
+      Minigotchi::epoch();
+    }
+
+    Scheduler::enter(next);
+  } else {
+    Scheduler::due = millis() + wait;
+  }
+}
+
+void Scheduler::enter(minigotchi_phase_t next) {
+  Scheduler::phase = next;
+
+  // how long we listen depends on how busy this channel has been, see epoch.cpp
+  if (next == PHASE_DETECT) {
+    Scheduler::limit = Epoch::dwell(Channel::getChannel());
+  } else {
+    Scheduler::limit = Config::phaseBudget[next];
+  }
+
+  // only ask the driver for what this phase actually looks at
+  Hal::setFilter(Config::phaseFilter[next]);
+
+  Scheduler::phaseStart = millis();
+  Scheduler::phaseTimer = Stats::now();
+  Scheduler::due = Scheduler::phaseStart;
+}
+
+minigotchi_phase_t Scheduler::currentPhase() { return Scheduler::phase; }
+
+unsigned long Scheduler::elapsed() {
+  return millis() - Scheduler::phaseStart;
+}
+
+// has the current phase used up its time budget?
+bool Scheduler::expired() {
+  return Scheduler::elapsed() >= (unsigned long)Scheduler::budget();
+}
+
+int Scheduler::budget() { return Scheduler::limit; }
+
+int Scheduler::interval() { return Config::phaseInterval[Scheduler::phase]; }
+
+// the channel moved under the running phase, so have it wrap up on its next
+// step instead of using up the rest of its budget. cycle follows the new
+// channel on its own and advertising works the same on any channel, so those
+// two are left alone
+void Scheduler::preempt() {
+  if (Scheduler::phase == PHASE_DETECT || Scheduler::phase == PHASE_DEAUTH) {
+    Scheduler::limit = 0;
+    Scheduler::due = millis();
+  }
+}
+
+// step the running phase right away instead of when it asked to be, safe to
+// call from other tasks(the promiscuous callback, say)
+void Scheduler::wake() { Scheduler::woken = true; }
@@ -0,0 +1,79 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * scheduler.h: header files for scheduler.cpp
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "config.h"
+#include "minigotchi.h"
+#include "parasite.h"
+#include "stats.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// radio task, pinned next to the wifi driver on dual core chips
+#define RADIO_TASK_CORE 0
+#define RADIO_TASK_PRIORITY 2
+#define RADIO_TASK_STACK 8192
+
+// returned by a phase once it has nothing left to do this round
+#define TASK_DONE -1
+
+typedef enum {
+  PHASE_CYCLE = 0,
+  PHASE_DETECT = 1,
+  PHASE_ADVERTISE = 2,
+  PHASE_DEAUTH = 3,
+  PHASE_COUNT = 4
+} minigotchi_phase_t;
+
+// a phase step returns how many ms it wants to wait before it is serviced
+// again, or TASK_DONE
+typedef long (*minigotchi_step_t)();
+
+class Scheduler {
+public:
+  static void begin();
+  static void service();
+  static minigotchi_phase_t currentPhase();
+  static unsigned long elapsed();
+  static bool expired();
+  static int budget();
+  static int interval();
+  static void preempt();
+  static void wake();
+
+private:
+  static void task(void *parameter);
+  static void enter(minigotchi_phase_t next);
+  static const minigotchi_step_t phases[PHASE_COUNT];
+  static minigotchi_phase_t phase;
+  static unsigned long phaseStart;
+  static int limit;
+  static int64_t phaseTimer;
+  static int64_t epochTimer;
+  static unsigned long due;
+  static volatile bool woken;
+};
+
+#endif // SCHEDULER_H
@@ -0,0 +1,193 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * stats.cpp: timers for where each epoch's time actually goes
+ */
+
+#include "stats.h"
+#include "hal.h"
+#include "pwnagotchi.h"
+
+/** developer note:
+ *
+ * these are always on, recording a sample is a couple of adds and a compare
+ * under a spinlock so it's fine to leave them in everywhere.
+ *
+ * send "stats" over serial for the full table (min/avg/max/p95 in us), or
+ * "stats reset" to start over. every Config::statsInterval epochs there's a
+ * one line summary too: how the epochs were split between the phases, and
+ * how long an epoch took(avg and p95).
+ *
+ * the benchmarks live with whatever they measure, "bench hop"(channel.cpp),
+ * "bench pack" and "bench sign"(frame.cpp), "bench classify"
+ * (pwnagotchi.cpp), "bench whisper" and "bench json"(whisper.cpp) and "bench
+ * capture"(capture.cpp).
+ *
+ */
+
+const char *const Stats::names[STAT_COUNT] = {
+    "cycle",   "detect",   "advertise", "deauth",  "epoch",
+    "ap scan", "monStart", "monStop",   "display", "serial",
+    "switch",  "hop full", "hop fast",  "follow",  "pack",
+    "tx",      "sign",     "first peer", "tx failed"};
+
+stat_timer_t Stats::timers[STAT_COUNT] = {};
+portMUX_TYPE Stats::lock = portMUX_INITIALIZER_UNLOCKED;
+
+int64_t Stats::now() { return esp_timer_get_time(); }
+
+void Stats::record(stat_id_t id, uint32_t us) {
+  portENTER_CRITICAL(&Stats::lock);
+  stat_timer_t &timer = Stats::timers[id];
+  if (timer.count == 0 || us < timer.min) {
+    timer.min = us;
+  }
+  if (us > timer.max) {
+    timer.max = us;
+  }
+  timer.samples[timer.count % STATS_SAMPLES] = us;
+  timer.total += us;
+  timer.count++;
+  portEXIT_CRITICAL(&Stats::lock);
+}
+
+void Stats::since(stat_id_t id, int64_t started) {
+  Stats::record(id, (uint32_t)(Stats::now() - started));
+}
+
+// p95 over the latest samples, not the whole run
+uint32_t Stats::percentile(stat_id_t id, int pct) {
+  uint32_t sorted[STATS_SAMPLES];
+
+  portENTER_CRITICAL(&Stats::lock);
+  size_t n = min(Stats::timers[id].count, (uint32_t)STATS_SAMPLES);
+  memcpy(sorted, Stats::timers[id].samples, n * sizeof(uint32_t));
+  portEXIT_CRITICAL(&Stats::lock);
+
+  if (n == 0) {
+    return 0;
+  }
+
+  std::sort(sorted, sorted + n);
+  size_t rank = (n * pct + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static const bool registered = Commands::add(Stats::command);
+
+bool Stats::command(const String &line) {
+  if (line == "stats") {
+    Stats::report();
+  } else if (line == "stats reset") {
+    Stats::reset();
+    Serial.println("('-') Stats reset");
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// one timer's line, nothing if it hasn't been hit yet
+void Stats::row(stat_id_t id) {
+  portENTER_CRITICAL(&Stats::lock);
+  stat_timer_t timer = Stats::timers[id];
+  portEXIT_CRITICAL(&Stats::lock);
+  if (timer.count == 0) {
+    return;
+  }
+
+  Serial.printf("('-') %-10s n=%-6u min=%-9u avg=%-9u max=%-9u p95=%u\n",
+                Stats::names[id], (unsigned)timer.count, (unsigned)timer.min,
+                (unsigned)(timer.total / timer.count), (unsigned)timer.max,
+                (unsigned)Stats::percentile(id, 95));
+}
+
+void Stats::report() {
+  Serial.println(" ");
+  Serial.println("('-') Stats (us):");
+  for (int i = 0; i < STAT_COUNT; i++) {
+    Stats::row((stat_id_t)i);
+  }
+
+  // tx latency above is queued to sent("tx failed" to failed, straight away
+  // if the driver wouldn't take it), these are where the frames ended up
+  hal_tx_counters_t tx = Hal::txCounters();
+  Serial.printf("('-') tx queued=%u sent=%u failed=%u busy=%u lost=%u "
+                "pending=%d\n",
+                (unsigned)tx.queued, (unsigned)tx.sent, (unsigned)tx.failed,
+                (unsigned)tx.busy, (unsigned)tx.lost, Hal::txPending());
+
+  // what the driver is passing up right now, see Hal::setFilter()
+  uint32_t filter = Hal::filter();
+  Serial.printf("('-') rx filter=0x%02x%s%s%s%s frames=%u\n",
+                (unsigned)filter,
+                filter & HAL_FILTER_MGMT ? " mgmt" : "",
+                filter & HAL_FILTER_CTRL ? " ctrl" : "",
+                filter & HAL_FILTER_DATA ? " data" : "",
+                filter & HAL_FILTER_MISC ? " misc" : "",
+                (unsigned)Hal::rxCount());
+
+  // how often a detection window found someone, "first peer" above is how
+  // long into the window that took
+  uint32_t windows = Pwnagotchi::windows();
+  portENTER_CRITICAL(&Stats::lock);
+  uint32_t hits = Stats::timers[STAT_FIRST_PEER].count;
+  portEXIT_CRITICAL(&Stats::lock);
+  Serial.printf("('-') detect windows=%u hits=%u (%u%%)\n", (unsigned)windows,
+                (unsigned)hits, windows ? (unsigned)(hits * 100 / windows) : 0);
+
+  // pwngrid beacons that didn't fit in the ring, see pwnagotchi.cpp
+  Serial.printf("('-') rx peers=%u dropped=%u\n",
+                (unsigned)Pwnagotchi::received(),
+                (unsigned)Pwnagotchi::drops());
+  Serial.println(" ");
+}
+
+// where did the epochs go? share of total epoch time per phase, and how long
+// an epoch took, all on one line
+void Stats::summary() {
+  // the phases and the epoch line up, STAT_CYCLE to STAT_EPOCH
+  uint64_t totals[STAT_EPOCH + 1];
+  portENTER_CRITICAL(&Stats::lock);
+  for (int i = STAT_CYCLE; i <= STAT_EPOCH; i++) {
+    totals[i] = Stats::timers[i].total;
+  }
+  uint32_t epochs = Stats::timers[STAT_EPOCH].count;
+  portEXIT_CRITICAL(&Stats::lock);
+
+  uint64_t spent = totals[STAT_EPOCH];
+  if (spent == 0) {
+    return;
+  }
+
+  Serial.print("('-') Duty cycle:");
+  for (int i = STAT_CYCLE; i <= STAT_DEAUTH; i++) {
+    Serial.printf(" %s %u%%", Stats::names[i],
+                  (unsigned)(totals[i] * 100 / spent));
+  }
+  Serial.printf(" (epoch avg %u ms, p95 %u ms)\n",
+                (unsigned)(spent / epochs / 1000),
+                (unsigned)(Stats::percentile(STAT_EPOCH, 95) / 1000));
+}
+
+void Stats::reset() {
+  portENTER_CRITICAL(&Stats::lock);
+  memset(Stats::timers, 0, sizeof(Stats::timers));
+  portEXIT_CRITICAL(&Stats::lock);
+}
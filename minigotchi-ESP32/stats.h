@@ -0,0 +1,86 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * stats.h: header files for stats.cpp
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include "commands.h"
+#include "config.h"
+#include <Arduino.h>
+#include <algorithm>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+
+// how many of the latest samples we keep per timer for the p95
+#define STATS_SAMPLES 64
+
+// the first four line up with minigotchi_phase_t
+typedef enum {
+  STAT_CYCLE = 0,
+  STAT_DETECT = 1,
+  STAT_ADVERTISE = 2,
+  STAT_DEAUTH = 3,
+  STAT_EPOCH = 4,
+  STAT_SCAN = 5,
+  STAT_MON_START = 6,
+  STAT_MON_STOP = 7,
+  STAT_DISPLAY = 8,
+  STAT_SERIAL = 9,
+  STAT_SWITCH = 10,
+  STAT_HOP_FULL = 11,
+  STAT_HOP_FAST = 12,
+  STAT_FOLLOW = 13,
+  STAT_PACK = 14,
+  STAT_TX = 15,
+  STAT_SIGN = 16,
+  STAT_FIRST_PEER = 17,
+  STAT_TX_FAIL = 18,
+  STAT_COUNT = 19
+} stat_id_t;
+
+typedef struct {
+  uint32_t count;
+  uint64_t total;
+  uint32_t min;
+  uint32_t max;
+  uint32_t samples[STATS_SAMPLES];
+} stat_timer_t;
+
+class Stats {
+public:
+  static int64_t now();
+  static void record(stat_id_t id, uint32_t us);
+  static void since(stat_id_t id, int64_t started);
+  static bool command(const String &line);
+  static void report();
+  static void summary();
+  static void reset();
+
+private:
+  static uint32_t percentile(stat_id_t id, int pct);
+  static void row(stat_id_t id);
+  static const char *const names[STAT_COUNT];
+  static stat_timer_t timers[STAT_COUNT];
+  static portMUX_TYPE lock;
+};
+
+#endif // STATS_H
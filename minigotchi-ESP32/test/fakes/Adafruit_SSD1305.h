@@ -0,0 +1,28 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Adafruit_SSD1305.h: only ever pointed at, see Adafruit_GFX.h
+ */
+
+#ifndef FAKE_ADAFRUIT_SSD1305_H
+#define FAKE_ADAFRUIT_SSD1305_H
+
+class Adafruit_SSD1305 {};
+
+#endif // FAKE_ADAFRUIT_SSD1305_H
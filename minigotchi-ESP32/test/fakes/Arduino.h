@@ -0,0 +1,250 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Arduino.h: just enough of the Arduino core to build the sketch on a pc
+ */
+
+#ifndef FAKE_ARDUINO_H
+#define FAKE_ARDUINO_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define F(x) x
+#define DEC 10
+#define HEX 16
+#define OUTPUT 1
+#define INPUT 0
+#define HIGH 1
+#define LOW 0
+#define IRAM_ATTR
+#define PROGMEM
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+using std::max;
+using std::min;
+
+#define constrain(x, low, high)                                                \
+  ((x) < (low) ? (low) : ((x) > (high) ? (high) : (x)))
+
+class String {
+public:
+  String() {}
+  String(const char *text) : s(text != nullptr ? text : "") {}
+  String(const std::string &text) : s(text) {}
+  String(char c) : s(1, c) {}
+  String(unsigned char value, unsigned char base = DEC)
+      : String((unsigned long)value, base) {}
+  String(int value, unsigned char base = DEC) : String((long)value, base) {}
+  String(unsigned value, unsigned char base = DEC)
+      : String((unsigned long)value, base) {}
+  String(long value, unsigned char base = DEC);
+  String(unsigned long value, unsigned char base = DEC);
+  String(long long value, unsigned char base = DEC);
+  String(unsigned long long value, unsigned char base = DEC);
+  String(float value, unsigned char decimals = 2)
+      : String((double)value, decimals) {}
+  String(double value, unsigned char decimals = 2);
+
+  const char *c_str() const { return s.c_str(); }
+  unsigned length() const { return s.size(); }
+  bool isEmpty() const { return s.empty(); }
+  void reserve(unsigned size) { s.reserve(size); }
+
+  bool startsWith(const String &prefix) const {
+    return s.compare(0, prefix.s.size(), prefix.s) == 0;
+  }
+  bool endsWith(const String &suffix) const {
+    return s.size() >= suffix.s.size() &&
+           s.compare(s.size() - suffix.s.size(), suffix.s.size(), suffix.s) ==
+               0;
+  }
+  String substring(unsigned from) const {
+    return from < s.size() ? String(s.substr(from)) : String();
+  }
+  String substring(unsigned from, unsigned to) const {
+    if (from > to) {
+      std::swap(from, to);
+    }
+    return from < s.size() ? String(s.substr(from, to - from)) : String();
+  }
+  int indexOf(char c, unsigned from = 0) const {
+    size_t at = s.find(c, from);
+    return at == std::string::npos ? -1 : (int)at;
+  }
+  int indexOf(const String &text, unsigned from = 0) const {
+    size_t at = s.find(text.s, from);
+    return at == std::string::npos ? -1 : (int)at;
+  }
+  void trim();
+  long toInt() const { return atol(s.c_str()); }
+  bool concat(const String &text) {
+    s += text.s;
+    return true;
+  }
+
+  char operator[](unsigned i) const { return i < s.size() ? s[i] : '\0'; }
+  char &operator[](unsigned i) { return s[i]; }
+  String &operator+=(const String &text) {
+    s += text.s;
+    return *this;
+  }
+  String &operator+=(const char *text) {
+    s += text;
+    return *this;
+  }
+  String &operator+=(char c) {
+    s += c;
+    return *this;
+  }
+  bool operator==(const String &text) const { return s == text.s; }
+  bool operator==(const char *text) const { return s == text; }
+  bool operator!=(const String &text) const { return s != text.s; }
+  bool operator!=(const char *text) const { return s != text; }
+  bool operator<(const String &text) const { return s < text.s; }
+
+private:
+  std::string s;
+};
+
+String operator+(const String &a, const String &b);
+String operator+(const String &a, const char *b);
+String operator+(const char *a, const String &b);
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *data, size_t length);
+  size_t write(const char *text) {
+    return write((const uint8_t *)text, strlen(text));
+  }
+
+  size_t print(const char *text) { return write(text); }
+  size_t print(const String &text) { return write(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char value, int base = DEC) {
+    return print((unsigned long)value, base);
+  }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned value, int base = DEC) {
+    return print((unsigned long)value, base);
+  }
+  size_t print(long value, int base = DEC) {
+    return print(String(value, base));
+  }
+  size_t print(unsigned long value, int base = DEC) {
+    return print(String(value, base));
+  }
+  size_t print(long long value, int base = DEC) {
+    return print(String(value, base));
+  }
+  size_t print(unsigned long long value, int base = DEC) {
+    return print(String(value, base));
+  }
+  size_t print(double value, int decimals = 2) {
+    return print(String(value, decimals));
+  }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T &value) {
+    return print(value) + println();
+  }
+  template <typename T> size_t println(const T &value, int format) {
+    return print(value, format) + println();
+  }
+  size_t printf(const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  void setTimeout(unsigned long) {}
+};
+
+/** developer note:
+ *
+ * whatever the sketch prints goes to stdout, and tests hand it serial input
+ * with inject()
+ *
+ */
+
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  void end() {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *data, size_t length) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  void flush() { fflush(stdout); }
+  operator bool() const { return true; }
+
+  // fake only
+  void inject(const char *text);
+  void quiet(bool enable);
+
+private:
+  std::string input;
+  bool silent = false;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 200000; }
+  uint32_t getMinFreeHeap() { return 180000; }
+  uint32_t getMaxAllocHeap() { return 110000; }
+  uint32_t getCpuFreqMHz() { return 240; }
+  void restart() { exit(0); }
+};
+
+extern EspClass ESP;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+inline bool isAscii(int c) { return (c & ~0x7f) == 0; }
+inline bool isPrintable(int c) { return isprint(c); }
+
+#endif // FAKE_ARDUINO_H
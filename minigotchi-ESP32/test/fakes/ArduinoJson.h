@@ -0,0 +1,202 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * ArduinoJson.h: the bits of ArduinoJson the sketch uses, see json.cpp
+ */
+
+#ifndef FAKE_ARDUINOJSON_H
+#define FAKE_ARDUINOJSON_H
+
+#include "Arduino.h"
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/** developer note:
+ *
+ * a real tree with real parsing and serializing, so tests can check what the
+ * sketch puts together, and that what it refuses really isn't json. output
+ * matches ArduinoJson's: no whitespace, keys in the order they were added and
+ * only ", \\ and control characters escaped.
+ *
+ */
+
+typedef enum {
+  JSON_NULL = 0,
+  JSON_BOOL = 1,
+  JSON_INTEGER = 2,
+  JSON_FLOAT = 3,
+  JSON_STRING = 4,
+  JSON_OBJECT = 5,
+  JSON_ARRAY = 6,
+} json_type_t;
+
+struct JsonNode {
+  json_type_t type = JSON_NULL;
+  bool flag = false;
+  long long integer = 0;
+  double real = 0;
+  std::string text;
+  std::vector<std::string> keys;
+  std::vector<std::unique_ptr<JsonNode>> children;
+
+  void clear();
+  JsonNode *member(const std::string &key, bool create);
+  JsonNode *append();
+  void set(bool value);
+  void set(long long value);
+  void set(double value);
+  void set(const std::string &value);
+  std::string serialize() const;
+};
+
+class JsonArray {
+public:
+  explicit JsonArray(JsonNode *node = nullptr) : node(node) {}
+
+  template <typename T> bool add(const T &value) {
+    if (node == nullptr) {
+      return false;
+    }
+    set(node->append(), value);
+    return true;
+  }
+
+private:
+  template <typename T> static void set(JsonNode *node, const T &value);
+  JsonNode *node;
+};
+
+class JsonVariant {
+public:
+  JsonVariant(JsonNode *parent, const std::string &key)
+      : parent(parent), key(key) {}
+
+  template <typename T> JsonVariant &operator=(const T &value) {
+    JsonNode *node = parent != nullptr ? parent->member(key, true) : nullptr;
+    if (node != nullptr) {
+      JsonVariant::set(node, value);
+    }
+    return *this;
+  }
+
+  template <typename T> T as() const;
+  bool isNull() const;
+
+  static void set(JsonNode *node, bool value) { node->set(value); }
+  static void set(JsonNode *node, const char *value) {
+    node->set(std::string(value));
+  }
+  static void set(JsonNode *node, const String &value) {
+    node->set(std::string(value.c_str()));
+  }
+  static void set(JsonNode *node, const std::string &value) {
+    node->set(value);
+  }
+  template <typename T>
+  static typename std::enable_if<std::is_integral<T>::value>::type
+  set(JsonNode *node, const T &value) {
+    node->set((long long)value);
+  }
+  template <typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value>::type
+  set(JsonNode *node, const T &value) {
+    node->set((double)value);
+  }
+
+private:
+  const JsonNode *find() const;
+  JsonNode *parent;
+  std::string key;
+};
+
+template <typename T> void JsonArray::set(JsonNode *node, const T &value) {
+  JsonVariant::set(node, value);
+}
+
+template <> String JsonVariant::as<String>() const;
+template <> int JsonVariant::as<int>() const;
+template <> long JsonVariant::as<long>() const;
+template <> bool JsonVariant::as<bool>() const;
+
+class JsonObject {
+public:
+  explicit JsonObject(JsonNode *node = nullptr) : node(node) {}
+
+  JsonVariant operator[](const char *key) { return JsonVariant(node, key); }
+  JsonArray createNestedArray(const char *key);
+  JsonObject createNestedObject(const char *key);
+
+private:
+  JsonNode *node;
+};
+
+class JsonDocument {
+public:
+  JsonDocument() {}
+  JsonDocument(const JsonDocument &) = delete;
+  JsonDocument &operator=(const JsonDocument &) = delete;
+
+  JsonVariant operator[](const char *key) { return JsonVariant(&root, key); }
+  JsonObject createNestedObject(const char *key) {
+    return JsonObject(&root).createNestedObject(key);
+  }
+  JsonArray createNestedArray(const char *key) {
+    return JsonObject(&root).createNestedArray(key);
+  }
+  void clear() { root.clear(); }
+
+  JsonNode root;
+};
+
+class DynamicJsonDocument : public JsonDocument {
+public:
+  explicit DynamicJsonDocument(size_t capacity) {}
+};
+
+template <size_t N> class StaticJsonDocument : public JsonDocument {};
+
+class DeserializationError {
+public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, TooDeep };
+
+  DeserializationError(Code code = Ok) : value(code) {}
+  explicit operator bool() const { return value != Ok; }
+  Code code() const { return value; }
+  const char *c_str() const;
+
+private:
+  Code value;
+};
+
+size_t measureJson(const JsonDocument &doc);
+size_t serializeJson(const JsonDocument &doc, char *out, size_t capacity);
+size_t serializeJson(const JsonDocument &doc, String &out);
+template <size_t N>
+size_t serializeJson(const JsonDocument &doc, char (&out)[N]) {
+  return serializeJson(doc, out, N);
+}
+
+DeserializationError deserializeJson(JsonDocument &doc, const char *json,
+                                     size_t length);
+DeserializationError deserializeJson(JsonDocument &doc, const char *json);
+DeserializationError deserializeJson(JsonDocument &doc, const String &json);
+
+#endif // FAKE_ARDUINOJSON_H
@@ -0,0 +1,94 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * FS.h: real files in a temp dir behind the arduino-esp32 FS api, see fs.cpp
+ */
+
+#ifndef FAKE_FS_H
+#define FAKE_FS_H
+
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FS;
+struct fake_handle;
+
+class File {
+public:
+  File() {}
+  explicit File(std::shared_ptr<fake_handle> handle) : handle(handle) {}
+
+  size_t write(const uint8_t *data, size_t length);
+  size_t write(uint8_t c) { return write(&c, 1); }
+  size_t read(uint8_t *out, size_t length);
+  int read();
+  int available();
+  void flush();
+  bool seek(uint32_t position, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void close();
+  operator bool() const;
+  const char *name() const;
+  const char *path() const;
+  bool isDirectory() const;
+  File openNextFile(const char *mode = FILE_READ);
+
+private:
+  std::shared_ptr<fake_handle> handle;
+};
+
+class FS {
+public:
+  File open(const char *path, const char *mode = FILE_READ,
+            bool create = false);
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool mkdir(const char *path);
+
+  // fake only
+  void wipe();
+  std::vector<uint8_t> contents(const char *path);
+  void put(const char *path, const std::vector<uint8_t> &data);
+
+private:
+  std::string real(const char *path);
+  std::mutex lock;
+  std::string root; // made the first time it's needed, and again after wipe()
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif // FAKE_FS_H
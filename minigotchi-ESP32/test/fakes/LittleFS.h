@@ -0,0 +1,48 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * LittleFS.h: the flash partition, mounts unless a test says otherwise
+ */
+
+#ifndef FAKE_LITTLEFS_H
+#define FAKE_LITTLEFS_H
+
+#include "FS.h"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+public:
+  bool begin(bool formatOnFail = false, const char *basePath = "/littlefs",
+             uint8_t maxOpenFiles = 10, const char *label = "spiffs") {
+    return formatted || formatOnFail;
+  }
+  void end() {}
+  size_t totalBytes() { return 1024 * 1024; }
+  size_t usedBytes() { return 0; }
+
+  // fake only, an unformatted partition won't mount
+  bool formatted = true;
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif // FAKE_LITTLEFS_H
@@ -0,0 +1,50 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SD.h: the CYD's card slot, empty unless a test puts a card in
+ */
+
+#ifndef FAKE_SD_H
+#define FAKE_SD_H
+
+#include "FS.h"
+#include "SPI.h"
+
+namespace fs {
+
+class SDFS : public FS {
+public:
+  bool begin(uint8_t ssPin = 5, SPIClass &spi = SPI,
+             uint32_t frequency = 4000000, const char *mountpoint = "/sd",
+             uint8_t maxFiles = 5, bool formatIfEmpty = false) {
+    return inserted;
+  }
+  void end() {}
+  uint64_t totalBytes() { return 1024 * 1024; }
+  uint64_t usedBytes() { return 0; }
+
+  // fake only
+  bool inserted = false;
+};
+
+} // namespace fs
+
+extern fs::SDFS SD;
+
+#endif // FAKE_SD_H
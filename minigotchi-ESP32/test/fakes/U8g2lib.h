@@ -0,0 +1,28 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * U8g2lib.h: only ever pointed at, see Adafruit_GFX.h
+ */
+
+#ifndef FAKE_U8G2LIB_H
+#define FAKE_U8G2LIB_H
+
+class U8G2_SSD1306_128X64_NONAME_F_SW_I2C {};
+
+#endif // FAKE_U8G2LIB_H
@@ -0,0 +1,192 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * arduino.cpp: the Arduino core's functions, on a pc
+ */
+
+#include "Arduino.h"
+#include "esp_timer.h"
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <stdarg.h>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static const auto booted = std::chrono::steady_clock::now();
+static std::mutex serialLock;
+static std::mutex randomLock;
+static std::mt19937 generator(1);
+
+static std::string number(unsigned long long value, unsigned char base) {
+  if (base < 2 || base > 36) {
+    base = DEC;
+  }
+
+  std::string digits;
+  do {
+    int digit = value % base;
+    digits.insert(digits.begin(), digit < 10 ? '0' + digit : 'A' + digit - 10);
+    value /= base;
+  } while (value > 0);
+  return digits;
+}
+
+String::String(long value, unsigned char base) {
+  s = value < 0 && base == DEC ? "-" + number(-(long long)value, base)
+                               : number((unsigned long)value, base);
+}
+
+String::String(unsigned long value, unsigned char base)
+    : s(number(value, base)) {}
+
+String::String(long long value, unsigned char base) {
+  s = value < 0 && base == DEC ? "-" + number(-value, base)
+                               : number((unsigned long long)value, base);
+}
+
+String::String(unsigned long long value, unsigned char base)
+    : s(number(value, base)) {}
+
+String::String(double value, unsigned char decimals) {
+  char text[64];
+  snprintf(text, sizeof(text), "%.*f", decimals, value);
+  s = text;
+}
+
+void String::trim() {
+  size_t first = s.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos) {
+    s.clear();
+    return;
+  }
+  s = s.substr(first, s.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+String operator+(const String &a, const String &b) {
+  String sum = a;
+  sum += b;
+  return sum;
+}
+
+String operator+(const String &a, const char *b) { return a + String(b); }
+
+String operator+(const char *a, const String &b) { return String(a) + b; }
+
+size_t Print::write(const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    write(data[i]);
+  }
+  return length;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char text[1024];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  if (length < 0) {
+    return 0;
+  }
+  return write((const uint8_t *)text, min((size_t)length, sizeof(text) - 1));
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t *data, size_t length) {
+  if (!silent) {
+    fwrite(data, 1, length, stdout);
+  }
+  return length;
+}
+
+int HardwareSerial::available() {
+  std::lock_guard<std::mutex> guard(serialLock);
+  return input.size();
+}
+
+int HardwareSerial::read() {
+  std::lock_guard<std::mutex> guard(serialLock);
+  if (input.empty()) {
+    return -1;
+  }
+
+  int c = (uint8_t)input[0];
+  input.erase(0, 1);
+  return c;
+}
+
+void HardwareSerial::inject(const char *text) {
+  std::lock_guard<std::mutex> guard(serialLock);
+  input += text;
+}
+
+void HardwareSerial::quiet(bool enable) { silent = enable; }
+
+int64_t esp_timer_get_time() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - booted)
+      .count();
+}
+
+unsigned long millis() { return esp_timer_get_time() / 1000; }
+
+unsigned long micros() { return esp_timer_get_time(); }
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() { std::this_thread::yield(); }
+
+long random(long howbig) {
+  if (howbig <= 0) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> guard(randomLock);
+  return std::uniform_int_distribution<long>(0, howbig - 1)(generator);
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) {
+    return howsmall;
+  }
+  return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+  std::lock_guard<std::mutex> guard(randomLock);
+  generator.seed(seed);
+}
+
+uint32_t esp_random() {
+  std::lock_guard<std::mutex> guard(randomLock);
+  return generator();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {}
@@ -0,0 +1,55 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * display.cpp: no screen, faces and text are only remembered
+ */
+
+#include "../../display.h"
+
+String Display::storedFace = "";
+String Display::previousFace = "";
+String Display::storedText = "";
+String Display::previousText = "";
+QueueHandle_t Display::queue = nullptr;
+Adafruit_SSD1306 *Display::ssd1306_adafruit_display = nullptr;
+Adafruit_SSD1305 *Display::ssd1305_adafruit_display = nullptr;
+U8G2_SSD1306_128X64_NONAME_F_SW_I2C *Display::ssd1306_ideaspark_display =
+    nullptr;
+TFT_eSPI *Display::tft_display = nullptr;
+
+Display::~Display() {}
+
+void Display::startScreen() {}
+
+void Display::updateDisplay(String face) { Display::updateDisplay(face, ""); }
+
+void Display::updateDisplay(String face, String text) {
+  Display::render(face, text);
+}
+
+void Display::printU8G2Data(int x, int y, const char *data) {}
+
+void Display::render(String face, String text) {
+  Display::previousFace = Display::storedFace;
+  Display::previousText = Display::storedText;
+  Display::storedFace = face;
+  Display::storedText = text;
+}
+
+void Display::task(void *parameter) {}
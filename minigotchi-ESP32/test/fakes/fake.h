@@ -0,0 +1,55 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * fake.h: what the tests use to drive the fake radio, see hal.cpp
+ */
+
+#ifndef FAKE_H
+#define FAKE_H
+
+#include "../../hal.h"
+#include "../../identity.h"
+#include <stdint.h>
+#include <vector>
+
+namespace Fake {
+
+typedef std::vector<uint8_t> bytes_t;
+
+// a frame off the air, straight to whoever Hal::setRxCallback() was given
+void receive(const bytes_t &frame, int rssi, int channel,
+             hal_frame_type_t type = HAL_FRAME_MGMT);
+void receive(const uint8_t *frame, int len, int rssi, int channel,
+             hal_frame_type_t type = HAL_FRAME_MGMT);
+
+// what the next scan finds
+void access(const std::vector<hal_ap_t> &found);
+
+// every frame handed to Hal::tx()/submit() so far, and forgetting them
+std::vector<bytes_t> transmitted();
+void reset();
+
+// the key the fake Identity has: this fingerprint, and this signature for
+// whatever it's asked to sign
+extern uint8_t fingerprint[IDENTITY_FINGERPRINT_LENGTH];
+extern uint8_t signature[IDENTITY_SIGNATURE_LENGTH];
+
+} // namespace Fake
+
+#endif // FAKE_H
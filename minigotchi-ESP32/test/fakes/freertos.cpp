@@ -0,0 +1,162 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * freertos.cpp: FreeRTOS on top of std::thread
+ */
+
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+/** developer note:
+ *
+ * every task is a detached thread that never gets joined, the sketch's tasks
+ * loop forever anyway. the test's own thread is a task too, so it can wait on
+ * notifications like any other. ticks are milliseconds.
+ *
+ */
+
+struct fake_task {
+  std::mutex lock;
+  std::condition_variable wake;
+  uint32_t notified = 0;
+};
+
+struct fake_queue {
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+  size_t length;
+  size_t size;
+};
+
+static thread_local fake_task *current = nullptr;
+static const auto booted = std::chrono::steady_clock::now();
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stack,
+                       void *parameter, UBaseType_t priority,
+                       TaskHandle_t *handle) {
+  fake_task *task = new fake_task();
+  if (handle != nullptr) {
+    *handle = task;
+  }
+
+  std::thread([=]() {
+    current = task;
+    code(parameter);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name,
+                                   uint32_t stack, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle,
+                                   BaseType_t core) {
+  return xTaskCreate(code, name, stack, parameter, priority, handle);
+}
+
+// only ever a task deleting itself in the sketch, its thread just stops
+void vTaskDelete(TaskHandle_t task) {
+  for (;;) {
+    std::this_thread::sleep_for(std::chrono::hours(1));
+  }
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount() {
+  return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - booted)
+      .count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  if (current == nullptr) {
+    current = new fake_task();
+  }
+  return current;
+}
+
+BaseType_t xPortGetCoreID() { return 1; }
+
+void xTaskNotifyGive(TaskHandle_t task) {
+  std::lock_guard<std::mutex> guard(task->lock);
+  task->notified++;
+  task->wake.notify_one();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  fake_task *task = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> guard(task->lock);
+  auto notified = [task]() { return task->notified > 0; };
+  if (ticks == portMAX_DELAY) {
+    task->wake.wait(guard, notified);
+  } else {
+    task->wake.wait_for(guard, std::chrono::milliseconds(ticks), notified);
+  }
+
+  uint32_t count = task->notified;
+  if (count > 0) {
+    task->notified = clear ? 0 : count - 1;
+  }
+  return count;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t size) {
+  fake_queue *queue = new fake_queue();
+  queue->length = length;
+  queue->size = size;
+  return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                      TickType_t ticks) {
+  std::unique_lock<std::mutex> guard(queue->lock);
+  auto room = [queue]() { return queue->items.size() < queue->length; };
+  if (!queue->changed.wait_for(guard, std::chrono::milliseconds(ticks),
+                               room)) {
+    return pdFAIL;
+  }
+
+  const uint8_t *bytes = (const uint8_t *)item;
+  queue->items.emplace_back(bytes, bytes + queue->size);
+  queue->changed.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+  std::unique_lock<std::mutex> guard(queue->lock);
+  auto waiting = [queue]() { return !queue->items.empty(); };
+  if (!queue->changed.wait_for(guard, std::chrono::milliseconds(ticks),
+                               waiting)) {
+    return pdFAIL;
+  }
+
+  memcpy(item, queue->items.front().data(), queue->size);
+  queue->items.pop_front();
+  queue->changed.notify_all();
+  return pdPASS;
+}
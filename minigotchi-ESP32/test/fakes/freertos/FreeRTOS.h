@@ -0,0 +1,57 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * freertos/FreeRTOS.h: tasks are threads, critical sections are a mutex
+ */
+
+#ifndef FAKE_FREERTOS_H
+#define FAKE_FREERTOS_H
+
+#include <mutex>
+#include <stdint.h>
+
+typedef struct fake_task *TaskHandle_t;
+typedef struct fake_queue *QueueHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xffffffff
+#define CONFIG_FREERTOS_UNICORE 0
+#define configMAX_PRIORITIES 25
+
+// the whole of a critical section, from any thread
+typedef struct {
+  std::recursive_mutex lock;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->lock.lock()
+#define portEXIT_CRITICAL(mux) (mux)->lock.unlock()
+#define portENTER_CRITICAL_ISR(mux) (mux)->lock.lock()
+#define portEXIT_CRITICAL_ISR(mux) (mux)->lock.unlock()
+
+#endif // FAKE_FREERTOS_H
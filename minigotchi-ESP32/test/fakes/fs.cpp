@@ -0,0 +1,263 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * fs.cpp: every FS is a temp dir on the host, files are real files in it
+ */
+
+#include "FS.h"
+#include "LittleFS.h"
+#include "SD.h"
+#include <algorithm>
+#include <dirent.h>
+#include <ftw.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+fs::LittleFSFS LittleFS;
+fs::SDFS SD;
+SPIClass SPI;
+
+/** developer note:
+ *
+ * writes go through stdio, so what's in a file on disk is what was flushed,
+ * same as on the board. contents() reads the file back off the disk, so a
+ * test sees exactly what a pulled plug would have left behind.
+ *
+ */
+
+namespace fs {
+
+struct fake_handle {
+  FS *owner;
+  std::string path;
+  std::string name;
+  FILE *file; // null for a directory
+  bool open;
+  std::vector<std::string> entries;
+  size_t next;
+
+  ~fake_handle() {
+    if (file != nullptr)
+      fclose(file);
+  }
+};
+
+// "/a/b" -> "/a", "/a" -> "/"
+static std::string parentOf(const std::string &path) {
+  size_t slash = path.rfind('/');
+  return slash == 0 || slash == std::string::npos ? "/" : path.substr(0, slash);
+}
+
+static std::string baseOf(const std::string &path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static bool isDirectory(const std::string &path) {
+  struct stat info;
+  return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// where a path on this FS really is, the temp dir gets made on first use
+std::string FS::real(const char *path) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (root.empty()) {
+    const char *tmp = getenv("TMPDIR");
+    std::string pattern =
+        std::string(tmp != nullptr ? tmp : "/tmp") + "/minigotchi-fs-XXXXXX";
+    if (mkdtemp(&pattern[0]) != nullptr)
+      root = pattern;
+  }
+  return root + (path[0] == '/' ? "" : "/") + path;
+}
+
+File FS::open(const char *path, const char *mode, bool create) {
+  std::string p(path);
+  std::string r = real(path);
+  auto handle = std::make_shared<fake_handle>();
+  handle->owner = this;
+  handle->path = p;
+  handle->name = baseOf(p);
+  handle->file = nullptr;
+  handle->open = true;
+  handle->next = 0;
+
+  if (isDirectory(r)) {
+    if (mode[0] != 'r')
+      return File();
+    DIR *dir = opendir(r.c_str());
+    if (dir == nullptr)
+      return File();
+    std::string prefix = p == "/" ? "" : p;
+    for (struct dirent *entry; (entry = readdir(dir)) != nullptr;) {
+      if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+        handle->entries.push_back(prefix + "/" + entry->d_name);
+    }
+    closedir(dir);
+    std::sort(handle->entries.begin(), handle->entries.end());
+    return File(handle);
+  }
+
+  // read and write both ways, like LittleFS lets you
+  const char *how = mode[0] == 'r' ? "rb" : mode[0] == 'w' ? "w+b" : "a+b";
+  handle->file = fopen(r.c_str(), how);
+  if (handle->file == nullptr)
+    return File();
+  if (mode[0] == 'a')
+    fseek(handle->file, 0, SEEK_END);
+  return File(handle);
+}
+
+bool FS::exists(const char *path) {
+  struct stat info;
+  return stat(real(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char *path) { return unlink(real(path).c_str()) == 0; }
+
+bool FS::mkdir(const char *path) {
+  std::string r = real(path);
+  return ::mkdir(r.c_str(), 0755) == 0 || isDirectory(r);
+}
+
+static int removeOne(const char *path, const struct stat *info, int flag,
+                     struct FTW *walk) {
+  return ::remove(path);
+}
+
+// everything goes, the temp dir too
+void FS::wipe() {
+  std::lock_guard<std::mutex> guard(lock);
+  if (!root.empty())
+    nftw(root.c_str(), removeOne, 16, FTW_DEPTH | FTW_PHYS);
+  root.clear();
+}
+
+std::vector<uint8_t> FS::contents(const char *path) {
+  std::vector<uint8_t> bytes;
+  FILE *file = fopen(real(path).c_str(), "rb");
+  if (file == nullptr)
+    return bytes;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+    bytes.insert(bytes.end(), chunk, chunk + n);
+  fclose(file);
+  return bytes;
+}
+
+void FS::put(const char *path, const std::vector<uint8_t> &data) {
+  std::string p(path);
+  std::vector<std::string> parents;
+  for (std::string dir = parentOf(p); dir != "/"; dir = parentOf(dir))
+    parents.push_back(dir);
+  for (auto dir = parents.rbegin(); dir != parents.rend(); ++dir)
+    mkdir(dir->c_str());
+
+  FILE *file = fopen(real(path).c_str(), "wb");
+  if (file == nullptr)
+    return;
+  fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+}
+
+size_t File::write(const uint8_t *data, size_t length) {
+  if (!*this || handle->file == nullptr)
+    return 0;
+  return fwrite(data, 1, length, handle->file);
+}
+
+size_t File::read(uint8_t *out, size_t length) {
+  if (!*this || handle->file == nullptr)
+    return 0;
+  return fread(out, 1, length, handle->file);
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::available() {
+  if (!*this || handle->file == nullptr)
+    return 0;
+  return position() < size() ? size() - position() : 0;
+}
+
+void File::flush() {
+  if (*this && handle->file != nullptr)
+    fflush(handle->file);
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+  if (!*this || handle->file == nullptr)
+    return false;
+  size_t base = mode == SeekSet   ? 0
+                : mode == SeekCur ? this->position()
+                                  : size();
+  if (base + position > size())
+    return false;
+  return fseek(handle->file, (long)(base + position), SEEK_SET) == 0;
+}
+
+size_t File::position() const {
+  if (!*this || handle->file == nullptr)
+    return 0;
+  long at = ftell(handle->file);
+  return at < 0 ? 0 : (size_t)at;
+}
+
+// counts what's been written whether or not it's been flushed
+size_t File::size() const {
+  if (!*this || handle->file == nullptr)
+    return 0;
+  long at = ftell(handle->file);
+  fseek(handle->file, 0, SEEK_END);
+  long end = ftell(handle->file);
+  fseek(handle->file, at, SEEK_SET);
+  return end < 0 ? 0 : (size_t)end;
+}
+
+void File::close() {
+  if (handle) {
+    handle->open = false;
+    if (handle->file != nullptr)
+      fclose(handle->file);
+    handle->file = nullptr;
+  }
+  handle.reset();
+}
+
+File::operator bool() const { return handle && handle->open; }
+
+const char *File::name() const { return *this ? handle->name.c_str() : ""; }
+
+const char *File::path() const { return *this ? handle->path.c_str() : ""; }
+
+bool File::isDirectory() const { return *this && handle->file == nullptr; }
+
+File File::openNextFile(const char *mode) {
+  if (!isDirectory() || handle->next >= handle->entries.size())
+    return File();
+  return handle->owner->open(handle->entries[handle->next++].c_str(), mode);
+}
+
+} // namespace fs
@@ -0,0 +1,206 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * hal.cpp: Hal without a radio, frames come from the tests and go nowhere
+ */
+
+#include "../../hal.h"
+#include "../../stats.h"
+#include "fake.h"
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+
+volatile hal_rx_callback_t Hal::rxCallback = nullptr;
+volatile uint32_t Hal::rxFirst = 0;
+volatile uint32_t Hal::rxFrames = 0;
+uint32_t Hal::rxFilter = HAL_FILTER_MGMT;
+bool Hal::promiscuous = false;
+String Hal::rxLine = "";
+hal_tx_slot_t Hal::txRing[HAL_TX_RING];
+volatile uint32_t Hal::txHead = 0;
+volatile uint32_t Hal::txTail = 0;
+hal_tx_counters_t Hal::counters = {};
+portMUX_TYPE Hal::txLock = portMUX_INITIALIZER_UNLOCKED;
+bool Hal::txHooked = false;
+bool Hal::txAsync = false;
+
+static std::mutex lock;
+static std::vector<Fake::bytes_t> sent;
+static std::vector<hal_ap_t> aps;
+static std::vector<hal_ap_t> scanned;
+static int channel = 1;
+static bool scanning = false;
+static std::atomic<uint32_t> received(0);
+
+void Fake::receive(const bytes_t &frame, int rssi, int channel,
+                   hal_frame_type_t type) {
+  Fake::receive(frame.data(), (int)frame.size(), rssi, channel, type);
+}
+
+void Fake::receive(const uint8_t *frame, int len, int rssi, int channel,
+                   hal_frame_type_t type) {
+  hal_rx_frame_t rx = {frame, len, rssi, channel, type};
+  received++;
+  hal_rx_callback_t callback = Hal::getRxCallback();
+  if (callback != nullptr) {
+    callback(rx);
+  }
+}
+
+void Fake::access(const std::vector<hal_ap_t> &found) {
+  std::lock_guard<std::mutex> guard(lock);
+  aps = found;
+}
+
+std::vector<Fake::bytes_t> Fake::transmitted() {
+  std::lock_guard<std::mutex> guard(lock);
+  return sent;
+}
+
+void Fake::reset() {
+  std::lock_guard<std::mutex> guard(lock);
+  sent.clear();
+  aps.clear();
+  scanned.clear();
+}
+
+void Hal::monitor(bool enable) { Hal::promiscuous = enable; }
+
+bool Hal::monitoring() { return Hal::promiscuous; }
+
+bool Hal::setChannel(int channel) {
+  if (channel < 1 || channel > 14) {
+    return false;
+  }
+  ::channel = channel;
+  return true;
+}
+
+bool Hal::setCountry(const char *country, int first, int count) {
+  return true;
+}
+
+int Hal::getChannel() { return ::channel; }
+
+void Hal::setRxCallback(hal_rx_callback_t callback) {
+  Hal::rxCallback = callback;
+}
+
+hal_rx_callback_t Hal::getRxCallback() { return Hal::rxCallback; }
+
+void Hal::setFilter(uint32_t mask) { Hal::rxFilter = mask; }
+
+uint32_t Hal::filter() { return Hal::rxFilter; }
+
+uint32_t Hal::rxCount() { return received; }
+
+void Hal::armFirstFrame() { Hal::rxFirst = 0; }
+
+uint32_t Hal::firstFrame() { return Hal::rxFirst; }
+
+bool Hal::tx(const uint8_t *buf, size_t len, bool sysSeq) {
+  return Hal::submit(buf, len, sysSeq, nullptr) == HAL_TX_QUEUED;
+}
+
+// sent the moment it's handed over
+hal_tx_result_t Hal::submit(const uint8_t *buf, size_t len, bool sysSeq,
+                            hal_tx_done_t done) {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    sent.emplace_back(buf, buf + len);
+  }
+
+  portENTER_CRITICAL(&Hal::txLock);
+  Hal::counters.queued++;
+  Hal::counters.sent++;
+  portEXIT_CRITICAL(&Hal::txLock);
+
+  if (done != nullptr) {
+    done(true, Stats::now());
+  }
+  return HAL_TX_QUEUED;
+}
+
+int Hal::txPending() { return 0; }
+
+hal_tx_counters_t Hal::txCounters() {
+  portENTER_CRITICAL(&Hal::txLock);
+  hal_tx_counters_t copy = Hal::counters;
+  portEXIT_CRITICAL(&Hal::txLock);
+  return copy;
+}
+
+// finishes straight away with whatever Fake::access() said
+void Hal::scanStart(int channel) {
+  std::lock_guard<std::mutex> guard(lock);
+  scanned.clear();
+  for (const hal_ap_t &ap : aps) {
+    if (channel <= 0 || ap.channel == channel) {
+      scanned.push_back(ap);
+    }
+  }
+  scanning = true;
+}
+
+int Hal::scanResult() {
+  std::lock_guard<std::mutex> guard(lock);
+  return scanning ? (int)scanned.size() : HAL_SCAN_FAILED;
+}
+
+void Hal::scanEnd() {
+  std::lock_guard<std::mutex> guard(lock);
+  scanned.clear();
+  scanning = false;
+}
+
+bool Hal::scanAp(int index, hal_ap_t &ap) {
+  std::lock_guard<std::mutex> guard(lock);
+  if (index < 0 || index >= (int)scanned.size()) {
+    return false;
+  }
+  ap = scanned[index];
+  return true;
+}
+
+void Hal::macAddress(uint8_t *mac) {
+  static const uint8_t ours[6] = {0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01};
+  memcpy(mac, ours, sizeof(ours));
+}
+
+int Hal::stationCount() { return 0; }
+
+bool Hal::readLine(String &line) {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\n') {
+      line = Hal::rxLine;
+      Hal::rxLine = "";
+      return true;
+    }
+
+    if (Hal::rxLine.length() < HAL_LINE_MAX) {
+      Hal::rxLine += c;
+    }
+  }
+
+  return false;
+}
+
+void Hal::writeLine(const char *line) { Serial.println(line); }
@@ -0,0 +1,52 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * identity.cpp: a made up key, so signed beacons get laid out on the host
+ * too(see Frame::stamp()). nothing here is real rsa
+ */
+
+#include "../../identity.h"
+#include "fake.h"
+
+namespace Fake {
+uint8_t fingerprint[IDENTITY_FINGERPRINT_LENGTH];
+uint8_t signature[IDENTITY_SIGNATURE_LENGTH];
+} // namespace Fake
+
+// always the same, and easy to spot in a frame
+static const bool made = [] {
+  for (size_t i = 0; i < IDENTITY_FINGERPRINT_LENGTH; i++) {
+    Fake::fingerprint[i] = (uint8_t)(0xf0 ^ i);
+  }
+  for (size_t i = 0; i < IDENTITY_SIGNATURE_LENGTH; i++) {
+    Fake::signature[i] = (uint8_t)(0xa5 ^ i);
+  }
+  return true;
+}();
+
+bool Identity::begin() { return true; }
+
+bool Identity::ready() { return true; }
+
+bool Identity::sign(const uint8_t *data, size_t length, uint8_t *signature) {
+  memcpy(signature, Fake::signature, IDENTITY_SIGNATURE_LENGTH);
+  return true;
+}
+
+const uint8_t *Identity::fingerprint() { return Fake::fingerprint; }
@@ -0,0 +1,561 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * json.cpp: the ArduinoJson fake's tree, writer and parser
+ */
+
+#include "ArduinoJson.h"
+
+void JsonNode::clear() {
+  type = JSON_NULL;
+  text.clear();
+  keys.clear();
+  children.clear();
+}
+
+JsonNode *JsonNode::member(const std::string &key, bool create) {
+  if (type == JSON_NULL && create) {
+    type = JSON_OBJECT;
+  }
+  if (type != JSON_OBJECT) {
+    return nullptr;
+  }
+
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (keys[i] == key) {
+      return children[i].get();
+    }
+  }
+  if (!create) {
+    return nullptr;
+  }
+
+  keys.push_back(key);
+  children.emplace_back(new JsonNode());
+  return children.back().get();
+}
+
+JsonNode *JsonNode::append() {
+  if (type == JSON_NULL) {
+    type = JSON_ARRAY;
+  }
+  children.emplace_back(new JsonNode());
+  return children.back().get();
+}
+
+void JsonNode::set(bool value) {
+  clear();
+  type = JSON_BOOL;
+  flag = value;
+}
+
+void JsonNode::set(long long value) {
+  clear();
+  type = JSON_INTEGER;
+  integer = value;
+}
+
+void JsonNode::set(double value) {
+  clear();
+  type = JSON_FLOAT;
+  real = value;
+}
+
+void JsonNode::set(const std::string &value) {
+  clear();
+  type = JSON_STRING;
+  text = value;
+}
+
+static std::string quote(const std::string &text) {
+  std::string out = "\"";
+  for (unsigned char c : text) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\b':
+      out += "\\b";
+      break;
+    case '\f':
+      out += "\\f";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (c < 0x20) {
+        char escaped[8];
+        snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        out += escaped;
+      } else {
+        out += (char)c;
+      }
+      break;
+    }
+  }
+  return out + "\"";
+}
+
+std::string JsonNode::serialize() const {
+  switch (type) {
+  case JSON_BOOL:
+    return flag ? "true" : "false";
+  case JSON_INTEGER:
+    return std::to_string(integer);
+  case JSON_FLOAT: {
+    char text[32];
+    snprintf(text, sizeof(text), "%.9g", real);
+    return text;
+  }
+  case JSON_STRING:
+    return quote(text);
+  case JSON_OBJECT: {
+    std::string out = "{";
+    for (size_t i = 0; i < children.size(); i++) {
+      out += (i > 0 ? "," : "") + quote(keys[i]) + ":" +
+             children[i]->serialize();
+    }
+    return out + "}";
+  }
+  case JSON_ARRAY: {
+    std::string out = "[";
+    for (size_t i = 0; i < children.size(); i++) {
+      out += (i > 0 ? "," : "") + children[i]->serialize();
+    }
+    return out + "]";
+  }
+  default:
+    return "null";
+  }
+}
+
+const JsonNode *JsonVariant::find() const {
+  return parent != nullptr ? parent->member(key, false) : nullptr;
+}
+
+bool JsonVariant::isNull() const {
+  const JsonNode *node = find();
+  return node == nullptr || node->type == JSON_NULL;
+}
+
+// strings as they are, anything else as json
+template <> String JsonVariant::as<String>() const {
+  const JsonNode *node = find();
+  if (node == nullptr) {
+    return String("null");
+  }
+  return node->type == JSON_STRING ? String(node->text)
+                                   : String(node->serialize());
+}
+
+template <> long JsonVariant::as<long>() const {
+  const JsonNode *node = find();
+  if (node == nullptr) {
+    return 0;
+  }
+  if (node->type == JSON_INTEGER) {
+    return node->integer;
+  }
+  return node->type == JSON_FLOAT ? (long)node->real : 0;
+}
+
+template <> int JsonVariant::as<int>() const { return as<long>(); }
+
+template <> bool JsonVariant::as<bool>() const {
+  const JsonNode *node = find();
+  if (node == nullptr) {
+    return false;
+  }
+  return node->type == JSON_BOOL ? node->flag : as<long>() != 0;
+}
+
+JsonArray JsonObject::createNestedArray(const char *key) {
+  JsonNode *child = node != nullptr ? node->member(key, true) : nullptr;
+  if (child != nullptr) {
+    child->clear();
+    child->type = JSON_ARRAY;
+  }
+  return JsonArray(child);
+}
+
+JsonObject JsonObject::createNestedObject(const char *key) {
+  JsonNode *child = node != nullptr ? node->member(key, true) : nullptr;
+  if (child != nullptr) {
+    child->clear();
+    child->type = JSON_OBJECT;
+  }
+  return JsonObject(child);
+}
+
+const char *DeserializationError::c_str() const {
+  switch (value) {
+  case Ok:
+    return "Ok";
+  case EmptyInput:
+    return "EmptyInput";
+  case IncompleteInput:
+    return "IncompleteInput";
+  case InvalidInput:
+    return "InvalidInput";
+  case TooDeep:
+    return "TooDeep";
+  }
+  return "?";
+}
+
+size_t measureJson(const JsonDocument &doc) {
+  return doc.root.serialize().size();
+}
+
+// cut short to fit like ArduinoJson, says how much of it was written
+size_t serializeJson(const JsonDocument &doc, char *out, size_t capacity) {
+  if (capacity == 0) {
+    return 0;
+  }
+
+  std::string json = doc.root.serialize();
+  size_t length = min(json.size(), capacity - 1);
+  memcpy(out, json.data(), length);
+  out[length] = '\0';
+  return length;
+}
+
+size_t serializeJson(const JsonDocument &doc, String &out) {
+  std::string json = doc.root.serialize();
+  out = String(json);
+  return json.size();
+}
+
+/** developer note:
+ *
+ * a plain recursive descent parser. like ArduinoJson it reads one value and
+ * stops, whatever comes after it is left alone, and running out of input
+ * anywhere in the middle is IncompleteInput.
+ *
+ */
+
+#define JSON_DEPTH_MAX 10
+
+typedef struct {
+  const char *at;
+  const char *end;
+} json_reader_t;
+
+static void space(json_reader_t &reader) {
+  while (reader.at < reader.end &&
+         (*reader.at == ' ' || *reader.at == '\t' || *reader.at == '\n' ||
+          *reader.at == '\r')) {
+    reader.at++;
+  }
+}
+
+static DeserializationError::Code value(json_reader_t &reader, JsonNode &node,
+                                        int depth);
+
+static DeserializationError::Code string(json_reader_t &reader,
+                                         std::string &out) {
+  reader.at++;
+  while (reader.at < reader.end) {
+    char c = *reader.at++;
+    if (c == '"') {
+      return DeserializationError::Ok;
+    }
+    if ((unsigned char)c < 0x20) {
+      return DeserializationError::InvalidInput;
+    }
+    if (c != '\\') {
+      out += c;
+      continue;
+    }
+
+    if (reader.at == reader.end) {
+      return DeserializationError::IncompleteInput;
+    }
+    char escaped = *reader.at++;
+    switch (escaped) {
+    case '"':
+    case '\\':
+    case '/':
+      out += escaped;
+      break;
+    case 'b':
+      out += '\b';
+      break;
+    case 'f':
+      out += '\f';
+      break;
+    case 'n':
+      out += '\n';
+      break;
+    case 'r':
+      out += '\r';
+      break;
+    case 't':
+      out += '\t';
+      break;
+    case 'u': {
+      unsigned code = 0;
+      for (int i = 0; i < 4; i++) {
+        if (reader.at == reader.end) {
+          return DeserializationError::IncompleteInput;
+        }
+        char h = *reader.at++;
+        if (!isxdigit((unsigned char)h)) {
+          return DeserializationError::InvalidInput;
+        }
+        code = code * 16 + (isdigit((unsigned char)h)
+                                ? h - '0'
+                                : tolower((unsigned char)h) - 'a' + 10);
+      }
+      // utf-8, surrogate pairs aren't put back together
+      if (code < 0x80) {
+        out += (char)code;
+      } else if (code < 0x800) {
+        out += (char)(0xc0 | code >> 6);
+        out += (char)(0x80 | (code & 0x3f));
+      } else {
+        out += (char)(0xe0 | code >> 12);
+        out += (char)(0x80 | ((code >> 6) & 0x3f));
+        out += (char)(0x80 | (code & 0x3f));
+      }
+      break;
+    }
+    default:
+      return DeserializationError::InvalidInput;
+    }
+  }
+  return DeserializationError::IncompleteInput;
+}
+
+static DeserializationError::Code number(json_reader_t &reader,
+                                         JsonNode &node) {
+  const char *start = reader.at;
+  if (reader.at < reader.end && *reader.at == '-') {
+    reader.at++;
+  }
+
+  const char *digits = reader.at;
+  while (reader.at < reader.end && isdigit((unsigned char)*reader.at)) {
+    reader.at++;
+  }
+  if (reader.at == digits) {
+    return reader.at == reader.end ? DeserializationError::IncompleteInput
+                                   : DeserializationError::InvalidInput;
+  }
+
+  bool real = false;
+  while (reader.at < reader.end &&
+         (isdigit((unsigned char)*reader.at) || *reader.at == '.' ||
+          *reader.at == 'e' || *reader.at == 'E' || *reader.at == '+' ||
+          *reader.at == '-')) {
+    real = true;
+    reader.at++;
+  }
+
+  // a number right at the end might have been cut short
+  if (reader.at == reader.end) {
+    return DeserializationError::IncompleteInput;
+  }
+
+  std::string text(start, reader.at);
+  if (real) {
+    node.set(strtod(text.c_str(), nullptr));
+  } else {
+    node.set(strtoll(text.c_str(), nullptr, 10));
+  }
+  return DeserializationError::Ok;
+}
+
+static DeserializationError::Code word(json_reader_t &reader, const char *text,
+                                       JsonNode &node) {
+  size_t length = strlen(text);
+  size_t left = reader.end - reader.at;
+  if (left < length) {
+    return strncmp(reader.at, text, left) == 0
+               ? DeserializationError::IncompleteInput
+               : DeserializationError::InvalidInput;
+  }
+  if (strncmp(reader.at, text, length) != 0) {
+    return DeserializationError::InvalidInput;
+  }
+
+  reader.at += length;
+  if (text[0] == 't') {
+    node.set(true);
+  } else if (text[0] == 'f') {
+    node.set(false);
+  } else {
+    node.clear();
+  }
+  return DeserializationError::Ok;
+}
+
+static DeserializationError::Code members(json_reader_t &reader,
+                                          JsonNode &node, int depth) {
+  node.clear();
+  node.type = JSON_OBJECT;
+  reader.at++;
+
+  space(reader);
+  if (reader.at < reader.end && *reader.at == '}') {
+    reader.at++;
+    return DeserializationError::Ok;
+  }
+
+  for (;;) {
+    space(reader);
+    if (reader.at == reader.end) {
+      return DeserializationError::IncompleteInput;
+    }
+    if (*reader.at != '"') {
+      return DeserializationError::InvalidInput;
+    }
+
+    std::string key;
+    DeserializationError::Code code = string(reader, key);
+    if (code != DeserializationError::Ok) {
+      return code;
+    }
+
+    space(reader);
+    if (reader.at == reader.end) {
+      return DeserializationError::IncompleteInput;
+    }
+    if (*reader.at++ != ':') {
+      return DeserializationError::InvalidInput;
+    }
+
+    code = value(reader, *node.member(key, true), depth);
+    if (code != DeserializationError::Ok) {
+      return code;
+    }
+
+    space(reader);
+    if (reader.at == reader.end) {
+      return DeserializationError::IncompleteInput;
+    }
+    char c = *reader.at++;
+    if (c == '}') {
+      return DeserializationError::Ok;
+    }
+    if (c != ',') {
+      return DeserializationError::InvalidInput;
+    }
+  }
+}
+
+static DeserializationError::Code items(json_reader_t &reader, JsonNode &node,
+                                        int depth) {
+  node.clear();
+  node.type = JSON_ARRAY;
+  reader.at++;
+
+  space(reader);
+  if (reader.at < reader.end && *reader.at == ']') {
+    reader.at++;
+    return DeserializationError::Ok;
+  }
+
+  for (;;) {
+    DeserializationError::Code code = value(reader, *node.append(), depth);
+    if (code != DeserializationError::Ok) {
+      return code;
+    }
+
+    space(reader);
+    if (reader.at == reader.end) {
+      return DeserializationError::IncompleteInput;
+    }
+    char c = *reader.at++;
+    if (c == ']') {
+      return DeserializationError::Ok;
+    }
+    if (c != ',') {
+      return DeserializationError::InvalidInput;
+    }
+  }
+}
+
+static DeserializationError::Code value(json_reader_t &reader, JsonNode &node,
+                                        int depth) {
+  space(reader);
+  if (reader.at == reader.end) {
+    return DeserializationError::IncompleteInput;
+  }
+  if (depth >= JSON_DEPTH_MAX) {
+    return DeserializationError::TooDeep;
+  }
+
+  switch (*reader.at) {
+  case '{':
+    return members(reader, node, depth + 1);
+  case '[':
+    return items(reader, node, depth + 1);
+  case '"': {
+    std::string text;
+    DeserializationError::Code code = string(reader, text);
+    if (code == DeserializationError::Ok) {
+      node.set(text);
+    }
+    return code;
+  }
+  case 't':
+    return word(reader, "true", node);
+  case 'f':
+    return word(reader, "false", node);
+  case 'n':
+    return word(reader, "null", node);
+  default:
+    return number(reader, node);
+  }
+}
+
+DeserializationError deserializeJson(JsonDocument &doc, const char *json,
+                                     size_t length) {
+  doc.clear();
+  json_reader_t reader = {json, json + length};
+  space(reader);
+  if (reader.at == reader.end) {
+    return DeserializationError::EmptyInput;
+  }
+
+  DeserializationError::Code code = value(reader, doc.root, 0);
+  if (code != DeserializationError::Ok) {
+    doc.clear();
+  }
+  return code;
+}
+
+DeserializationError deserializeJson(JsonDocument &doc, const char *json) {
+  return deserializeJson(doc, json, strlen(json));
+}
+
+DeserializationError deserializeJson(JsonDocument &doc, const String &json) {
+  return deserializeJson(doc, json.c_str(), json.length());
+}
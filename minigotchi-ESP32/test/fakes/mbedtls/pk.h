@@ -0,0 +1,38 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * mbedtls/pk.h: the types identity.h keeps, identity.cpp is faked
+ */
+
+#ifndef FAKE_MBEDTLS_PK_H
+#define FAKE_MBEDTLS_PK_H
+
+typedef struct {
+  void *pk;
+} mbedtls_pk_context;
+
+typedef struct {
+  void *source;
+} mbedtls_entropy_context;
+
+typedef struct {
+  void *state;
+} mbedtls_ctr_drbg_context;
+
+#endif // FAKE_MBEDTLS_PK_H
@@ -0,0 +1,60 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * test.h: just enough of a test framework for the host tests
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      failures++;                                                              \
+      printf("(X-X) %s:%d: %s\n", __FILE__, __LINE__, #condition);             \
+    }                                                                          \
+  } while (0)
+
+// the tasks the sketch started never return, so there's no tearing down
+// static objects from under them. just leave
+static inline int finish() {
+  printf(failures == 0 ? "('-') all good\n" : "(X-X) %d failed\n", failures);
+  fflush(stdout);
+  _exit(failures == 0 ? 0 : 1);
+}
+
+// for work a task does on its own time, gives up after ms
+template <typename F> static bool eventually(F done, unsigned long ms = 2000) {
+  unsigned long started = millis();
+  while (!done()) {
+    if (millis() - started > ms) {
+      return false;
+    }
+    delay(1);
+  }
+  return true;
+}
+
+#endif // TEST_H
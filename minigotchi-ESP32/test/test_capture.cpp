@@ -0,0 +1,173 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * test_capture.cpp: beacons through the writer task into pcap files, see
+ * capture.cpp
+ */
+
+#include "../capture.h"
+#include "test.h"
+
+// a beacon that says which one it was
+static void beacon(uint8_t *frame, size_t length, uint32_t n) {
+  memset(frame, 0, length);
+  frame[0] = 0x80;
+  memcpy(frame + 24, &n, sizeof(n));
+  for (size_t i = 28; i < length; i++) {
+    frame[i] = (uint8_t)(n + i);
+  }
+}
+
+// whole records, each one radiotap with the channel and rssi we gave it and
+// the frame we offered. how many, or -1 if anything's off
+static int records(const std::vector<uint8_t> &file, int channel, int rssi) {
+  uint32_t magic, linktype;
+  if (file.size() < CAPTURE_FILE_HEADER) {
+    return -1;
+  }
+  memcpy(&magic, file.data(), 4);
+  memcpy(&linktype, file.data() + 20, 4);
+  if (magic != 0xa1b2c3d4 || linktype != 127) {
+    return -1;
+  }
+
+  int count = 0;
+  size_t at = CAPTURE_FILE_HEADER;
+  while (at < file.size()) {
+    uint32_t length, original;
+    if (at + 16 > file.size()) {
+      return -1;
+    }
+    memcpy(&length, file.data() + at + 8, 4);
+    memcpy(&original, file.data() + at + 12, 4);
+    if (at + 16 + length > file.size() || length > original) {
+      return -1;
+    }
+
+    const uint8_t *radiotap = file.data() + at + 16;
+    uint16_t frequency = radiotap[8] | radiotap[9] << 8;
+    if (radiotap[2] != CAPTURE_RADIOTAP_LENGTH ||
+        frequency != 2407 + 5 * channel || (int8_t)radiotap[12] != rssi) {
+      return -1;
+    }
+
+    const uint8_t *frame = radiotap + CAPTURE_RADIOTAP_LENGTH;
+    size_t snapped = length - CAPTURE_RADIOTAP_LENGTH;
+    uint32_t n;
+    memcpy(&n, frame + 24, sizeof(n));
+    uint8_t expected[CAPTURE_SNAP];
+    beacon(expected, snapped, n);
+    if (memcmp(frame, expected, snapped) != 0) {
+      return -1;
+    }
+    count++;
+    at += 16 + length;
+  }
+  return count;
+}
+
+int main() {
+  static uint8_t frame[1000];
+
+  // nowhere to write, and nothing gets formatted
+  LittleFS.formatted = false;
+  CHECK(!Capture::start());
+  LittleFS.formatted = true;
+
+  CHECK(Capture::start());
+  for (uint32_t n = 0; n < 40; n++) {
+    beacon(frame, 300, n);
+    Capture::offer(frame, 300, -42, 6);
+    delay(1);
+  }
+  Capture::stop();
+
+  // the writer closes the file on its own time, whole records only
+  CHECK(eventually([] {
+    return records(LittleFS.contents(CAPTURE_DIR "/00001.pcap"), 6, -42) > 0;
+  }));
+  int written = records(LittleFS.contents(CAPTURE_DIR "/00001.pcap"), 6, -42);
+  CHECK(written > 0 && written <= 40);
+
+  // a timed flush leaves whole records on flash, and the page after it is
+  // written up to the file's page boundary, not a page from where it ended
+  static const size_t record = CAPTURE_RECORD_HEADER + 300;
+  CHECK(Capture::start());
+  for (uint32_t n = 0; n < 5; n++) {
+    beacon(frame, 300, n);
+    Capture::offer(frame, 300, -42, 6);
+  }
+  CHECK(eventually(
+      [] {
+        return records(LittleFS.contents(CAPTURE_DIR "/00002.pcap"), 6,
+                       -42) == 5;
+      },
+      5000));
+
+  for (uint32_t n = 5; n < 20; n++) {
+    beacon(frame, 300, n);
+    Capture::offer(frame, 300, -42, 6);
+  }
+  bool aligned = true;
+  bool paged = false;
+  CHECK(eventually(
+      [&] {
+        std::vector<uint8_t> file =
+            LittleFS.contents(CAPTURE_DIR "/00002.pcap");
+        paged = paged || file.size() == CAPTURE_PAGE;
+        aligned = aligned && (file.size() % CAPTURE_PAGE == 0 ||
+                              records(file, 6, -42) >= 0);
+        return file.size() == CAPTURE_FILE_HEADER + 20 * record;
+      },
+      5000));
+  CHECK(aligned && paged);
+  CHECK(records(LittleFS.contents(CAPTURE_DIR "/00002.pcap"), 6, -42) == 20);
+  Capture::stop();
+
+  // long frames are cut at the snap length, and a new file is started once
+  // one gets big enough
+  CHECK(Capture::start());
+  uint32_t offered = 0;
+  while (offered < 2 * CAPTURE_FILE_MAX / CAPTURE_SNAP) {
+    for (int i = 0; i < CAPTURE_RING_SLOTS / 2; i++, offered++) {
+      beacon(frame, sizeof(frame), offered);
+      Capture::offer(frame, sizeof(frame), -70, 11);
+    }
+    delay(2);
+  }
+  Capture::stop();
+  CHECK(eventually([] { return LittleFS.exists(CAPTURE_DIR "/00004.pcap"); }));
+  CHECK(eventually([] {
+    return records(LittleFS.contents(CAPTURE_DIR "/00004.pcap"), 11, -70) > 0;
+  }));
+  std::vector<uint8_t> full = LittleFS.contents(CAPTURE_DIR "/00003.pcap");
+  CHECK(full.size() <= CAPTURE_FILE_MAX);
+  CHECK(full.size() + CAPTURE_RECORD_HEADER + CAPTURE_SNAP > CAPTURE_FILE_MAX);
+  CHECK(records(full, 11, -70) > 0);
+
+  // paged against per frame writes, with the writer to itself
+  CHECK(Capture::command("bench capture"));
+  CHECK(eventually([] { return Capture::start(); }, 20000));
+  CHECK(!LittleFS.exists(CAPTURE_DIR "/bench.pcap"));
+
+  // the fake's files are real ones, in a temp dir
+  Capture::stop();
+  LittleFS.wipe();
+  return finish();
+}
@@ -0,0 +1,79 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * test_deauth.cpp: a few rounds of the main loop against a made up access point
+ */
+
+#include "../config.h"
+#include "../deauth.h"
+#include "../scheduler.h"
+#include "fakes/fake.h"
+#include "test.h"
+
+static const uint8_t bssid[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+
+// deauths or disassociations from the ap to everyone
+static int attacks() {
+  int found = 0;
+  for (const Fake::bytes_t &frame : Fake::transmitted()) {
+    if (frame.size() == sizeof(Deauth::deauthFrame) &&
+        (frame[0] == 0xc0 || frame[0] == 0xa0) &&
+        memcmp(frame.data() + 4, Deauth::broadcastAddr, 6) == 0 &&
+        memcmp(frame.data() + 10, bssid, 6) == 0 &&
+        memcmp(frame.data() + 16, bssid, 6) == 0) {
+      found++;
+    }
+  }
+  return found;
+}
+
+static int beacons() {
+  int found = 0;
+  for (const Fake::bytes_t &frame : Fake::transmitted()) {
+    found += frame.size() > 16 && frame[0] == 0x80 &&
+             memcmp(frame.data() + 10, Frame::SignatureAddr, 6) == 0;
+  }
+  return found;
+}
+
+int main() {
+  hal_ap_t ap = {};
+  strcpy(ap.ssid, "somewhere");
+  memcpy(ap.bssid, bssid, sizeof(bssid));
+  ap.rssi = -60;
+  ap.channel = Config::channel;
+  ap.encryption = 3;
+  Fake::access({ap});
+
+  // every phase short, so the loop gets round to deauthing quickly
+  Config::deauth = true;
+  Config::advertise = true;
+  Config::hop_recon_time = 0;
+  Config::recon_time = 0;
+  Config::min_recon_time = 0;
+  int budgets[4] = {50, 100, 200, 1000};
+  int intervals[4] = {10, 10, 10, 20};
+  memcpy(Config::phaseBudget, budgets, sizeof(budgets));
+  memcpy(Config::phaseInterval, intervals, sizeof(intervals));
+
+  Scheduler::begin();
+  CHECK(eventually([] { return attacks() >= 10; }, 10000));
+  CHECK(beacons() > 0);
+  return finish();
+}
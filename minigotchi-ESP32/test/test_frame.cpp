@@ -0,0 +1,161 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * test_frame.cpp: our beacon against pwngrid's layout, see frame.cpp
+ */
+
+#include "../deflate.h"
+#include "../frame.h"
+#include "fakes/fake.h"
+#include "test.h"
+#include <ArduinoJson.h>
+
+// pwngrid's pack.go: a beacon from de:ad:be:ef:de:ad to everyone, interval
+// 100 tu, capability 0x0411. pwngrid uses the source as bssid too, ours has
+// always been its own and nobody looks at it
+static void header(const uint8_t *frame) {
+  static const uint8_t broadcast[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+  CHECK(frame[0] == 0x80 && frame[1] == 0x00);
+  CHECK(memcmp(frame + 4, broadcast, 6) == 0);
+  CHECK(memcmp(frame + 10, Frame::SignatureAddr, 6) == 0);
+  CHECK(frame[32] == 0x64 && frame[33] == 0x00);
+  CHECK(frame[34] == 0x11 && frame[35] == 0x04);
+}
+
+// pack.go puts the identity(0xE0) and the signature(0xE1, a 255 byte chunk
+// and a 1 byte one) straight after the header. says where the rest starts
+static size_t stamped(const uint8_t *frame) {
+  size_t at = FRAME_HEADER_LENGTH;
+  CHECK(frame[at] == Frame::IDWhisperIdentity);
+  CHECK(frame[at + 1] == IDENTITY_FINGERPRINT_LENGTH);
+  CHECK(memcmp(frame + at + 2, Fake::fingerprint,
+               IDENTITY_FINGERPRINT_LENGTH) == 0);
+  at += 2 + IDENTITY_FINGERPRINT_LENGTH;
+
+  CHECK(frame[at] == Frame::IDWhisperSignature && frame[at + 1] == 255);
+  CHECK(memcmp(frame + at + 2, Fake::signature, 255) == 0);
+  at += 2 + 255;
+  CHECK(frame[at] == Frame::IDWhisperSignature && frame[at + 1] == 1);
+  CHECK(frame[at + 2] == Fake::signature[255]);
+  at += 3;
+
+  CHECK(at == FRAME_HEADER_LENGTH + FRAME_SIGNED_LENGTH);
+  return at;
+}
+
+// the elements have to end exactly where the frame does, every 0xDE chunk
+// but the last one full
+static String payload(const uint8_t *frame, size_t length, bool &deflated) {
+  String json;
+  size_t at = FRAME_HEADER_LENGTH;
+  bool last = false;
+  deflated = false;
+  while (at + 2 <= length) {
+    uint8_t tag = frame[at];
+    uint8_t size = frame[at + 1];
+    CHECK(at + 2 + size <= length);
+    if (tag == Frame::IDWhisperCompression) {
+      CHECK(size == 1);
+      deflated = frame[at + 2] == 1;
+    } else if (tag == Frame::IDWhisperPayload) {
+      CHECK(!last);
+      last = size < 255;
+      for (size_t i = 0; i < size; i++) {
+        json += (char)frame[at + 2 + i];
+      }
+    }
+    at += 2 + size;
+  }
+  CHECK(at == length);
+  return json;
+}
+
+int main() {
+  // unsigned, the json starts right after the header
+  Config::compress = false;
+  Config::sign = false;
+  Frame::invalidate();
+  CHECK(Frame::pack() == Frame::beaconFrame);
+  CHECK(Frame::beaconFrame[FRAME_HEADER_LENGTH] == Frame::IDWhisperPayload);
+
+  // signed from here on
+  Config::sign = true;
+  Frame::invalidate();
+  CHECK(Frame::pack() == Frame::beaconFrame);
+  CHECK(Frame::frameLength > FRAME_HEADER_LENGTH + FRAME_SIGNED_LENGTH);
+  CHECK(Frame::frameLength <= FRAME_BUFFER_LENGTH);
+  header(Frame::beaconFrame);
+  size_t jsonAt = stamped(Frame::beaconFrame);
+  CHECK(Frame::beaconFrame[jsonAt] == Frame::IDWhisperPayload);
+
+  // plain json, with what we are in it
+  bool deflated = true;
+  String json = payload(Frame::beaconFrame, Frame::frameLength, deflated);
+  CHECK(!deflated);
+  DynamicJsonDocument doc(2048);
+  CHECK(!deserializeJson(doc, json));
+  CHECK(doc["name"].as<String>() == Config::name.c_str());
+  CHECK(doc["identity"].as<String>() == Config::identity.c_str());
+  CHECK(doc["pwnd_tot"].as<int>() == Config::pwnd_tot);
+  CHECK(doc["epoch"].as<int>() == Config::epoch);
+
+  // every byte of it goes out, and nothing past it
+  Fake::reset();
+  CHECK(Frame::send() == HAL_TX_QUEUED);
+  std::vector<Fake::bytes_t> sent = Fake::transmitted();
+  CHECK(sent.size() == 1);
+  CHECK(sent[0].size() == Frame::frameLength);
+  CHECK(memcmp(sent[0].data(), Frame::beaconFrame, Frame::frameLength) == 0);
+
+  // a change gets packed before the next one goes out, patched into the
+  // template behind the signature without touching it
+  Config::pwnd_tot++;
+  CHECK(Frame::dirty());
+  CHECK(Frame::send() == HAL_TX_QUEUED);
+  stamped(Frame::beaconFrame);
+  json = payload(Frame::beaconFrame, Frame::frameLength, deflated);
+  CHECK(!deserializeJson(doc, json));
+  CHECK(doc["pwnd_tot"].as<int>() == Config::pwnd_tot);
+
+  // compressed, still pwngrid's layout: signed, then flagged, then the
+  // deflated json
+  Config::compress = true;
+  Config::pwnd_tot++;
+  Frame::invalidate();
+  CHECK(Frame::pack() != nullptr);
+  header(Frame::beaconFrame);
+  jsonAt = stamped(Frame::beaconFrame);
+  CHECK(Frame::beaconFrame[jsonAt] == Frame::IDWhisperCompression);
+  String squeezed = payload(Frame::beaconFrame, Frame::frameLength, deflated);
+  CHECK(deflated);
+
+  static uint8_t inflated[FRAME_PAYLOAD_MAX + 1];
+  int length = Deflate::inflate((const uint8_t *)squeezed.c_str(),
+                                squeezed.length(), inflated,
+                                sizeof(inflated) - 1);
+  CHECK(length > 0);
+  inflated[max(length, 0)] = 0;
+  CHECK(!deserializeJson(doc, (const char *)inflated));
+  CHECK(doc["pwnd_tot"].as<int>() == Config::pwnd_tot);
+
+  // the template against ArduinoJson, and signing on its own
+  CHECK(Frame::benchmark());
+  CHECK(Frame::command("bench sign"));
+  return finish();
+}
@@ -0,0 +1,150 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * test_peers.cpp: the peer table on its own, see peers.cpp
+ */
+
+#include "../peers.h"
+#include "test.h"
+
+typedef std::vector<uint8_t> bytes_t;
+
+static bytes_t keyOf(uint32_t n) {
+  bytes_t key(PEERS_KEY_MAX, 0);
+  memcpy(key.data(), &n, sizeof(n));
+  return key;
+}
+
+static uint32_t homeOf(const bytes_t &key) {
+  return Peers::hash(key.data(), key.size()) & (PEERS_SLOTS - 1);
+}
+
+// sees the peer, and says whether it was already in the table
+static bool known(const bytes_t &key, unsigned long now) {
+  return Peers::see(key.data(), key.size(), -50, 1, now)->beacons > 1;
+}
+
+// empties the table, nobody lives forever
+static void clear() {
+  Peers::expire(0xfffffff);
+  CHECK(Peers::count() == 0);
+}
+
+int main() {
+  Config::sta_ttl = 60;
+  unsigned long ttl = 60 * 1000;
+
+  // one in, found again, the beacons and rssi add up
+  bytes_t alpha = keyOf(1);
+  CHECK(!known(alpha, 0));
+  CHECK(known(alpha, 10));
+  peer_t *peer = Peers::see(alpha.data(), alpha.size(), -70, 6, 20);
+  CHECK(peer->beacons == 3 && peer->channel == 6);
+  CHECK(peer->rssi / 16 < -50 && peer->rssi / 16 > -70);
+  CHECK(peer->firstSeen == 0 && peer->lastSeen == 20);
+
+  // a payload once it's parsed, and nobody else's
+  whisper_advert_t advert = {};
+  Peers::update(peer, 1234, advert);
+  CHECK(Peers::recall(1234) == peer);
+  CHECK(Peers::recall(4321) == nullptr);
+  CHECK(!Peers::changed(peer, 1234));
+  CHECK(Peers::changed(peer, 4321));
+  clear();
+  CHECK(Peers::recall(1234) == nullptr);
+
+  // three keys that all want the same slot, so two of them probe past it
+  std::vector<bytes_t> same = {keyOf(0)};
+  for (uint32_t n = 1; same.size() < 3; n++) {
+    if (homeOf(keyOf(n)) == homeOf(same[0])) {
+      same.push_back(keyOf(n));
+    }
+  }
+  CHECK(!known(same[0], 0));
+  CHECK(!known(same[1], ttl));
+  CHECK(!known(same[2], ttl));
+
+  // the first one goes stale, the other two get shifted back over the hole
+  // and are still found
+  Peers::expire(ttl + 1);
+  CHECK(Peers::count() == 2);
+  CHECK(known(same[1], ttl + 2));
+  CHECK(known(same[2], ttl + 2));
+  CHECK(!known(same[0], ttl + 2));
+  clear();
+
+  // a full table makes room by dropping whoever it heard from longest ago
+  for (uint32_t n = 0; n < PEERS_MAX; n++) {
+    CHECK(!known(keyOf(100 + n), 1000 + n));
+  }
+  CHECK(Peers::count() == PEERS_MAX);
+  CHECK(!known(keyOf(200), 2000));
+  CHECK(Peers::count() == PEERS_MAX);
+  for (uint32_t n = 1; n < PEERS_MAX; n++) {
+    CHECK(known(keyOf(100 + n), 3000));
+  }
+  CHECK(!known(keyOf(100), 3000));
+  CHECK(Peers::count() == PEERS_MAX);
+
+  // payloads stay findable by their hash through all of that: after a
+  // change, a peer moving back over a hole, and eviction
+  clear();
+  std::vector<uint32_t> hashes;
+  for (uint32_t h = 7; hashes.size() < 3; h += PEERS_SLOTS) {
+    hashes.push_back(h);
+  }
+  std::vector<peer_t *> parsed;
+  for (int i = 0; i < 3; i++) {
+    CHECK(!known(same[i], i == 0 ? 0 : ttl));
+    parsed.push_back(Peers::see(same[i].data(), same[i].size(), -50, 1,
+                                i == 0 ? 0 : ttl));
+    Peers::update(parsed[i], hashes[i], advert);
+  }
+  for (int i = 0; i < 3; i++) {
+    CHECK(Peers::recall(hashes[i]) == parsed[i]);
+  }
+  Peers::update(parsed[2], 99, advert);
+  CHECK(Peers::recall(hashes[2]) == nullptr);
+  CHECK(Peers::recall(99) == parsed[2]);
+
+  Peers::expire(ttl + 1);
+  CHECK(Peers::recall(hashes[0]) == nullptr);
+  peer_t *moved = Peers::recall(hashes[1]);
+  CHECK(moved != nullptr &&
+        memcmp(moved->key, same[1].data(), same[1].size()) == 0);
+  moved = Peers::recall(99);
+  CHECK(moved != nullptr &&
+        memcmp(moved->key, same[2].data(), same[2].size()) == 0);
+  clear();
+  CHECK(Peers::recall(hashes[1]) == nullptr);
+  CHECK(Peers::recall(99) == nullptr);
+
+  // someone else's copy is only ever a copy
+  peer_t copy;
+  CHECK(!Peers::lookup(alpha.data(), alpha.size(), copy));
+  Peers::see(alpha.data(), alpha.size(), -50, 3, 3000);
+  CHECK(Peers::lookup(alpha.data(), alpha.size(), copy));
+  CHECK(copy.channel == 3 && copy.beacons == 1);
+
+  // once a window, however many beacons
+  peer = Peers::see(alpha.data(), alpha.size(), -50, 1, 3000);
+  CHECK(Peers::announce(peer, 1));
+  CHECK(!Peers::announce(peer, 1));
+  CHECK(Peers::announce(peer, 2));
+  return finish();
+}
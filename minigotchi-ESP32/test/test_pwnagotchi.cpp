@@ -0,0 +1,106 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * test_pwnagotchi.cpp: the sniffer, from the callback through to the peer table
+ */
+
+#include "../frame.h"
+#include "../peers.h"
+#include "../pwnagotchi.h"
+#include "fakes/fake.h"
+#include "test.h"
+
+// our own beacon, as some other pwnagotchi. unsigned, like stock pwngrid's,
+// so the identity is only in the json
+static Fake::bytes_t beacon(const char *name, const char *identity,
+                            int pwndTot) {
+  Config::sign = false;
+  Config::name = name;
+  Config::identity = identity;
+  Config::pwnd_tot = pwndTot;
+  Frame::invalidate();
+  Frame::pack();
+  return Fake::bytes_t(Frame::beaconFrame,
+                       Frame::beaconFrame + Frame::frameLength);
+}
+
+int main() {
+  static const char alpha[] =
+      "8ed3f6ad685b959ead7022518e1af76cd816f8e8ec7ccdda1ed4018e8f2223f8";
+  static const char bravo[] =
+      "0b5ad2b7bdfc0c7ac4b3c1f7e2d5a0e3c9ba9e1f0b3a2c1d4e5f60718293a4b5";
+
+  // the classifier on its own
+  Fake::bytes_t frame = beacon("alpha", alpha, 1);
+  CHECK(Pwnagotchi::classify(frame.data(), frame.size()) == CLASS_PWNGRID);
+  frame[10] ^= 1;
+  CHECK(Pwnagotchi::classify(frame.data(), frame.size()) == CLASS_BEACON);
+  frame[0] = 0xd4;
+  CHECK(Pwnagotchi::classify(frame.data(), frame.size()) == CLASS_DROP);
+  CHECK(Pwnagotchi::classify(frame.data(), CLASS_HEADER_MIN - 1) ==
+        CLASS_DROP);
+  CHECK(Pwnagotchi::benchmark());
+
+  // a detection window, with the peer task behind it
+  Pwnagotchi::begin();
+  Pwnagotchi::detect();
+  CHECK(Hal::getRxCallback() == Pwnagotchi::pwnagotchiCallback);
+
+  // only management frames get looked at
+  uint32_t received = Pwnagotchi::received();
+  Fake::receive(beacon("alpha", alpha, 1), -50, 6, HAL_FRAME_DATA);
+  CHECK(Pwnagotchi::received() == received);
+
+  Fake::receive(beacon("alpha", alpha, 1), -50, 6);
+  CHECK(eventually([] { return Peers::count() == 1; }));
+
+  // same pwnagotchi, new payload: still one peer, updated
+  Fake::receive(beacon("alpha", alpha, 2), -60, 6);
+  Fake::receive(beacon("bravo", bravo, 7), -70, 11);
+  CHECK(eventually([] { return Peers::count() == 2; }));
+  CHECK(Pwnagotchi::drops() == 0);
+
+  // keyed on the identity, the bssid is the same for everyone
+  uint8_t key[PEERS_KEY_MAX];
+  for (size_t i = 0; i < sizeof(key); i++) {
+    char byte[3] = {alpha[2 * i], alpha[2 * i + 1], 0};
+    key[i] = (uint8_t)strtoul(byte, nullptr, 16);
+  }
+  // through lookup(), the table belongs to the peer task
+  peer_t seen;
+  CHECK(eventually([&] {
+    return Peers::lookup(key, sizeof(key), seen) && seen.parsed &&
+           seen.advert.pwndTot == 2;
+  }));
+  CHECK(strcmp(seen.advert.name, "alpha") == 0);
+  CHECK(seen.window == Pwnagotchi::windows());
+  CHECK(Peers::count() == 2);
+
+  // the same payload again is just a sighting, found by its hash and not
+  // parsed a second time
+  uint32_t beacons = seen.beacons;
+  uint32_t parses = seen.parses;
+  Fake::receive(beacon("alpha", alpha, 2), -60, 6);
+  CHECK(eventually([&] {
+    return Peers::lookup(key, sizeof(key), seen) && seen.beacons > beacons;
+  }));
+  CHECK(seen.parses == parses);
+  CHECK(Peers::count() == 2);
+  return finish();
+}
@@ -0,0 +1,266 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * test_replay.cpp: captures fed back through the sniffer, see
+ * tools/replay.cpp
+ */
+
+#include "../frame.h"
+#include "../peers.h"
+#include "../tools/replay.h"
+#include "fakes/fake.h"
+#include "test.h"
+#include <stdlib.h>
+
+typedef std::vector<uint8_t> bytes_t;
+
+static void put32(bytes_t &out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out.push_back((uint8_t)(value >> (8 * i)));
+  }
+}
+
+static void put16(bytes_t &out, uint16_t value) {
+  out.push_back((uint8_t)value);
+  out.push_back((uint8_t)(value >> 8));
+}
+
+// flags, channel and antenna signal, like most drivers write it
+static bytes_t radiotap(const bytes_t &frame, int channel, int rssi,
+                        uint8_t flags = 0) {
+  bytes_t out = {0, 0};
+  put16(out, 16);
+  put32(out, (1 << 1) | (1 << 3) | (1 << 5));
+  out.push_back(flags);
+  out.push_back(0); // padding, channel is 2 byte aligned
+  put16(out, 2407 + 5 * channel);
+  put16(out, 0x00a0);
+  out.push_back((uint8_t)rssi);
+  out.push_back(0);
+  out.insert(out.end(), frame.begin(), frame.end());
+  return out;
+}
+
+static bytes_t pcap(const std::vector<bytes_t> &records, uint32_t linktype) {
+  bytes_t out;
+  put32(out, 0xa1b2c3d4);
+  put16(out, 2);
+  put16(out, 4);
+  put32(out, 0);
+  put32(out, 0);
+  put32(out, 65535);
+  put32(out, linktype);
+  for (size_t i = 0; i < records.size(); i++) {
+    put32(out, 1);
+    put32(out, 1000 * i);
+    put32(out, records[i].size());
+    put32(out, records[i].size());
+    out.insert(out.end(), records[i].begin(), records[i].end());
+  }
+  return out;
+}
+
+// fcsBits goes in the interface's if_fcslen when it isn't 0
+static bytes_t pcapng(const std::vector<bytes_t> &records, uint16_t linktype,
+                      uint8_t fcsBits = 0) {
+  bytes_t out;
+  put32(out, PCAPNG_SECTION);
+  put32(out, 28);
+  put32(out, 0x1A2B3C4D);
+  put16(out, 1);
+  put16(out, 0);
+  put32(out, 0xffffffff);
+  put32(out, 0xffffffff);
+  put32(out, 28);
+
+  uint32_t total = fcsBits ? 32 : 20;
+  put32(out, PCAPNG_INTERFACE);
+  put32(out, total);
+  put16(out, linktype);
+  put16(out, 0);
+  put32(out, 0);
+  if (fcsBits) {
+    put16(out, 13);
+    put16(out, 1);
+    put32(out, fcsBits);
+    put32(out, 0);
+  }
+  put32(out, total);
+
+  for (size_t i = 0; i < records.size(); i++) {
+    size_t padded = (records[i].size() + 3) & ~3;
+    put32(out, PCAPNG_ENHANCED);
+    put32(out, 32 + padded);
+    put32(out, 0);
+    put32(out, 0);
+    put32(out, 1000000 + 1000 * i);
+    put32(out, records[i].size());
+    put32(out, records[i].size());
+    out.insert(out.end(), records[i].begin(), records[i].end());
+    out.resize(out.size() + padded - records[i].size());
+    put32(out, 32 + padded);
+  }
+  return out;
+}
+
+static char dir[] = "/tmp/minigotchi-replay-XXXXXX";
+static std::vector<std::string> written;
+
+// a real file, the tool reads them straight off the disk
+static std::string put(const char *name, const bytes_t &bytes) {
+  std::string path = std::string(dir) + "/" + name;
+  written.push_back(path);
+  FILE *file = fopen(path.c_str(), "wb");
+  CHECK(file != nullptr);
+  fwrite(bytes.data(), 1, bytes.size(), file);
+  fclose(file);
+  return path;
+}
+
+// our own beacon, signed with the fake identity, bragging about pwndTot
+static bytes_t ours(int pwndTot) {
+  Config::pwnd_tot = pwndTot;
+  Frame::invalidate();
+  Frame::pack();
+  return bytes_t(Frame::beaconFrame, Frame::beaconFrame + Frame::frameLength);
+}
+
+// what a driver that keeps the fcs writes, the replay must never hand it on
+static bytes_t checksummed(const bytes_t &frame) {
+  bytes_t out = frame;
+  out.insert(out.end(), {0xde, 0xad, 0xbe, 0xef});
+  return out;
+}
+
+static bytes_t other(uint8_t first) {
+  bytes_t frame(60, 0);
+  frame[0] = first;
+  for (int i = 0; i < 6; i++) {
+    frame[10 + i] = frame[16 + i] = (uint8_t)(0x20 + i);
+  }
+  return frame;
+}
+
+// a busy channel with three of us in it
+static std::vector<bytes_t> channel(int pwndTot) {
+  std::vector<bytes_t> frames;
+  for (int i = 0; i < 30; i++) {
+    frames.push_back(i % 10 == 3 ? ours(pwndTot)
+                                 : other(i % 3 == 0 ? 0x08 : 0x80));
+  }
+  return frames;
+}
+
+// the peer the fake identity's beacons are filed under
+static bool seen(peer_t &peer) {
+  return Peers::lookup(Fake::fingerprint, sizeof(Fake::fingerprint), peer);
+}
+
+int main() {
+  CHECK(mkdtemp(dir) != nullptr);
+  Pwnagotchi::begin();
+
+  // every way of writing the same capture down, each one bragging about a
+  // different pwnd_tot so we can tell its beacon got parsed
+  std::vector<std::string> paths;
+  int pwndTot = 0;
+  std::vector<bytes_t> frames = channel(++pwndTot);
+  paths.push_back(put("raw.pcap", pcap(frames, LINKTYPE_IEEE802_11)));
+
+  std::vector<bytes_t> tapped;
+  for (const bytes_t &frame : channel(++pwndTot)) {
+    tapped.push_back(radiotap(frame, 6, -55));
+  }
+  paths.push_back(put("tapped.pcap", pcap(tapped, LINKTYPE_RADIOTAP)));
+
+  tapped.clear();
+  for (const bytes_t &frame : channel(++pwndTot)) {
+    tapped.push_back(radiotap(frame, 6, -55));
+  }
+  paths.push_back(put("tapped.pcapng", pcapng(tapped, LINKTYPE_RADIOTAP)));
+
+  std::vector<bytes_t> fcs;
+  for (const bytes_t &frame : channel(++pwndTot)) {
+    fcs.push_back(checksummed(frame));
+  }
+  paths.push_back(put("fcs.pcap",
+                      pcap(fcs, LINKTYPE_IEEE802_11 | LINKTYPE_FCS_PRESENT |
+                                    (2u << 28))));
+
+  fcs.clear();
+  for (const bytes_t &frame : channel(++pwndTot)) {
+    fcs.push_back(checksummed(frame));
+  }
+  paths.push_back(put("fcs.pcapng", pcapng(fcs, LINKTYPE_IEEE802_11, 32)));
+
+  std::vector<bytes_t> tappedFcs;
+  for (const bytes_t &frame : channel(++pwndTot)) {
+    tappedFcs.push_back(radiotap(checksummed(frame), 6, -55, 0x10));
+  }
+  paths.push_back(put("tapped-fcs.pcap", pcap(tappedFcs, LINKTYPE_RADIOTAP)));
+
+  uint32_t rx = Hal::rxCount();
+  peer_t peer;
+  for (size_t i = 0; i < paths.size(); i++) {
+    replay_result_t result;
+    CHECK(Replay::run(paths[i].c_str(), false, result));
+    Replay::report(paths[i].c_str(), result);
+    CHECK(result.frames == 30);
+    CHECK(result.skipped == 0);
+    CHECK(result.detections == 3);
+    CHECK(result.drops == 0);
+    CHECK(result.firstFrame == 4);
+    CHECK(result.span == 29000);
+
+    // every frame went through the fake radio into the live callback, and
+    // the beacons on to the peer task
+    CHECK(Hal::getRxCallback() == Pwnagotchi::pwnagotchiCallback);
+    CHECK(Hal::rxCount() - rx == 30 * (i + 1));
+    CHECK(seen(peer) && peer.advert.pwndTot == (int)i + 1);
+  }
+  CHECK(Peers::count() == 1);
+  CHECK(peer.parses == paths.size());
+
+  // an fcs nobody told us about ends up in the last element, and the beacon
+  // doesn't parse
+  std::string unflagged = put("unflagged.pcap", pcap(fcs, LINKTYPE_IEEE802_11));
+  replay_result_t result;
+  CHECK(Replay::run(unflagged.c_str(), false, result));
+  CHECK(result.detections == 3);
+  CHECK(seen(peer) && peer.advert.pwndTot == (int)paths.size());
+
+  // at the speed it was captured
+  CHECK(Replay::run(paths[0].c_str(), true, result));
+  CHECK(result.frames == 30 && result.took >= result.span);
+
+  // link types we can't read are skipped, files we can't read are refused
+  std::string ethernet = put("ethernet.pcap", pcap(frames, 1));
+  CHECK(Replay::run(ethernet.c_str(), false, result));
+  CHECK(result.frames == 0 && result.skipped == 30);
+  std::string empty = put("empty.pcap", bytes_t(24, 0));
+  CHECK(!Replay::run(empty.c_str(), false, result));
+  CHECK(!Replay::run((std::string(dir) + "/missing.pcap").c_str(), false,
+                     result));
+
+  for (const std::string &path : written) {
+    unlink(path.c_str());
+  }
+  rmdir(dir);
+  return finish();
+}
@@ -0,0 +1,320 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * test_whisper.cpp: reading pwngrid beacons back, see whisper.cpp
+ */
+
+#include "../frame.h"
+#include "../whisper.h"
+#include "test.h"
+#include <ArduinoJson.h>
+
+static whisper_t whisper;
+static char json[WHISPER_PAYLOAD_MAX + 1];
+
+/** developer note:
+ *
+ * the other pwnagotchi's beacon below wasn't recorded over the air, it's
+ * made up the way pwngrid's Pack() lays one out: de:ad:be:ef:de:ad as source
+ * and bssid, no identity or signature element, a 0xDF holding a 1 if the
+ * payload went through flate, then the payload in 0xDE chunks of 255. the
+ * json is what a 1.5.5 pwnagotchi advertises with the default personality,
+ * keys sorted the way go's encoding/json writes them. the compressed copy
+ * came out of zlib(raw deflate, level 9) rather than go's compress/flate, so
+ * the bits aren't the ones a real one sends, but it's dynamic huffman from an
+ * encoder that isn't ours, which is the point.
+ *
+ */
+
+// the fixed part of a beacon, the way pwngrid sends it
+static const uint8_t pwngridHeader[]{
+    /*  0 - 1  */ 0x80,
+    0x00, // frame control, beacon frame
+    /*  2 - 3  */ 0x00,
+    0x00, // duration
+    /*  4 - 9  */ 0xff,
+    0xff,
+    0xff,
+    0xff,
+    0xff,
+    0xff, // broadcast address
+    /* 10 - 15 */ 0xde,
+    0xad,
+    0xbe,
+    0xef,
+    0xde,
+    0xad, // source address
+    /* 16 - 21 */ 0xde,
+    0xad,
+    0xbe,
+    0xef,
+    0xde,
+    0xad, // bssid, the source again
+    /* 22 - 23 */ 0x00,
+    0x00, // fragment and sequence number
+    /* 24 - 31 */ 0x00,
+    0x00,
+    0x00,
+    0x00,
+    0x00,
+    0x00,
+    0x00,
+    0x00, // timestamp
+    /* 32 - 33 */ 0x64,
+    0x00, // interval
+    /* 34 - 35 */ 0x11,
+    0x04, // capability info
+};
+
+// 670 bytes, three chunks as it is
+static const char pwngridAdvert[] =
+    "{\"epoch\":42,\"face\":\"(\xe2\x99\xa5\xe2\x80\xbf\xe2\x80\xbf\xe2\x99"
+    "\xa5)\",\"grid_version\":\"1.10.3\",\"identity\":\"8ed3f6ad685b959ead702"
+    "2518e1af76cd816f8e8ec7ccdda1ed4018e8f2223f8\",\"name\":\"alpha\",\"polic"
+    "y\":{\"advertise\":true,\"ap_ttl\":120,\"associate\":true,\"bond_encount"
+    "ers_factor\":20000,\"bored_num_epochs\":15,\"channels\":[],\"deauth\":tr"
+    "ue,\"excited_num_epochs\":10,\"hop_recon_time\":10,\"max_inactive_scale"
+    "\":2,\"max_interactions\":3,\"max_misses_for_recon\":5,\"min_recon_time"
+    "\":5,\"min_rssi\":-200,\"recon_inactive_multiplier\":2,\"recon_time\":30"
+    ",\"sad_num_epochs\":25,\"sta_ttl\":300,\"throttle_a\":0.4,\"throttle_d\""
+    ":0.9},\"pwnd_run\":3,\"pwnd_tot\":147,\"session_id\":\"b8:27:eb:41:5c:9e"
+    "\",\"timestamp\":1697563853,\"uptime\":5405,\"version\":\"1.5.5\"}";
+
+// the same json deflated, 400 bytes so still two chunks
+static const uint8_t pwngridDeflated[]{
+    0x5d, 0x92, 0x6f, 0x6e, 0xdc, 0x20, 0x10, 0xc5, 0xef, 0x32, 0x9f, 0x5a,
+    0xc9, 0x5d, 0xd9, 0xf8, 0x1f, 0xe6, 0x2a, 0x51, 0x85, 0x66, 0x61, 0x5c,
+    0x23, 0xd9, 0x60, 0x01, 0x4e, 0x53, 0x45, 0x91, 0x7a, 0x8d, 0x1c, 0x20,
+    0xe7, 0xe8, 0x5d, 0x72, 0x92, 0x0e, 0xbb, 0xdd, 0x68, 0x53, 0xcb, 0x5f,
+    0xe6, 0x3d, 0xf8, 0xcd, 0x1b, 0xe0, 0x19, 0x68, 0x0f, 0x66, 0x01, 0xd5,
+    0x89, 0x0a, 0x66, 0x34, 0x04, 0x0a, 0xbe, 0xbc, 0xbf, 0xbe, 0xbd, 0xff,
+    0xfe, 0x53, 0xfe, 0xd7, 0xb7, 0xaf, 0x50, 0xc1, 0x8f, 0xe8, 0xac, 0x7e,
+    0xa4, 0x98, 0x5c, 0xf0, 0xec, 0x37, 0xa7, 0xa6, 0x3e, 0xb5, 0xac, 0x3b,
+    0x4b, 0x3e, 0xbb, 0xfc, 0x8b, 0x35, 0x49, 0xb6, 0x9d, 0x07, 0xb4, 0x83,
+    0xec, 0xcf, 0x53, 0x3f, 0x11, 0xda, 0xb1, 0x16, 0xa2, 0x6f, 0x24, 0x35,
+    0x38, 0x8f, 0x83, 0xb1, 0xb2, 0x19, 0x66, 0x49, 0x92, 0xcc, 0x68, 0x8c,
+    0xb5, 0xd8, 0x90, 0xed, 0x6a, 0x76, 0xe5, 0x2c, 0x84, 0x68, 0x67, 0xc9,
+    0x34, 0x8f, 0x5b, 0xe9, 0x8e, 0xeb, 0xbe, 0x20, 0x97, 0x7b, 0x58, 0x9d,
+    0x61, 0xf4, 0x33, 0xa0, 0xe5, 0xde, 0xd9, 0x25, 0x76, 0x73, 0x3c, 0xa8,
+    0x02, 0xdc, 0x75, 0xce, 0x2b, 0xa8, 0x46, 0xd4, 0x5c, 0xa4, 0x14, 0x8c,
+    0xc3, 0xfc, 0xe1, 0x9e, 0x83, 0xb7, 0x9a, 0xbc, 0x09, 0x87, 0xcf, 0x9c,
+    0x59, 0xf3, 0x54, 0x39, 0x44, 0x50, 0xa2, 0xe6, 0xaf, 0xd8, 0x91, 0xac,
+    0xf6, 0xc7, 0xa6, 0x2f, 0x93, 0x27, 0xc6, 0xf4, 0x15, 0x98, 0x05, 0xbd,
+    0xa7, 0x95, 0xab, 0x87, 0xef, 0x15, 0x58, 0xc2, 0x23, 0x2f, 0x37, 0x20,
+    0x3d, 0x19, 0x97, 0xff, 0xdf, 0xc3, 0xa4, 0x25, 0xec, 0x3a, 0x92, 0x09,
+    0x5e, 0x67, 0x57, 0xa2, 0x17, 0x6d, 0xc3, 0x27, 0xed, 0x3c, 0x77, 0x74,
+    0x8f, 0xa4, 0x93, 0xc1, 0x95, 0x75, 0x71, 0x93, 0x39, 0x4e, 0x71, 0x82,
+    0x67, 0x40, 0x7b, 0x15, 0x37, 0x97, 0x12, 0x71, 0xc6, 0x10, 0xaf, 0x28,
+    0x50, 0x1c, 0x66, 0x73, 0xfe, 0x13, 0xf8, 0x26, 0xa5, 0xe4, 0x40, 0x7d,
+    0x13, 0x65, 0x8a, 0xab, 0xfd, 0xd1, 0x69, 0x3b, 0xd6, 0xec, 0xf6, 0xd5,
+    0x51, 0xbc, 0xb4, 0xbb, 0xdf, 0xdc, 0xf2, 0xea, 0x84, 0x9f, 0xd3, 0x0b,
+    0x26, 0xa6, 0x8c, 0xd7, 0x53, 0x6c, 0x0b, 0x2f, 0x2f, 0x31, 0x70, 0x45,
+    0x1a, 0x41, 0xd5, 0xa7, 0xee, 0x4e, 0xb0, 0x45, 0x98, 0x5e, 0xf8, 0x42,
+    0x7e, 0xf2, 0xb9, 0xc6, 0xc3, 0x5f, 0xb2, 0x5f, 0x8a, 0x1c, 0x32, 0x4f,
+    0xdd, 0x8d, 0x0c, 0xa3, 0x54, 0x1e, 0x87, 0x76, 0xbc, 0x1a, 0xce, 0x52,
+    0x89, 0x51, 0xd1, 0x59, 0x75, 0x8d, 0xea, 0x8d, 0x9a, 0x88, 0x6f, 0xb3,
+    0x64, 0xe1, 0x8e, 0xdb, 0xce, 0x1b, 0x86, 0x69, 0xec, 0x87, 0x56, 0xf6,
+    0x8c, 0x39, 0xf6, 0x7f, 0x13, 0x76, 0x35, 0x47, 0xba, 0x7f, 0x62, 0xfd,
+    0xa9, 0x87, 0x97, 0xbf,
+};
+
+// a beacon laid out like Pack() does it, returns its length
+static size_t pwngrid(uint8_t *out, const uint8_t *payload, size_t length,
+                      bool deflated) {
+  size_t size = sizeof(pwngridHeader);
+  memcpy(out, pwngridHeader, size);
+
+  if (deflated) {
+    out[size++] = Frame::IDWhisperCompression;
+    out[size++] = 1;
+    out[size++] = 1;
+  }
+
+  for (size_t offset = 0; offset < length; offset += 255) {
+    size_t chunk = min(length - offset, (size_t)255);
+    out[size++] = Frame::IDWhisperPayload;
+    out[size++] = chunk;
+    memcpy(out + size, payload + offset, chunk);
+    size += chunk;
+  }
+  return size;
+}
+
+// whether a beacon reads as an advertisment we'd take a peer from
+static bool advertised(const uint8_t *frame, size_t len) {
+  whisper_advert_t advert;
+  size_t length = 0;
+  return Whisper::parse(whisper, frame, len, json, sizeof(json), length) ==
+             WHISPER_OK &&
+         Whisper::decode(json, length, advert) &&
+         (advert.found & ADVERT_NAME) && (advert.found & ADVERT_IDENTITY);
+}
+
+// cut short anywhere, none of it can come out as valid json
+static int truncations(const uint8_t *frame, size_t len) {
+  int accepted = 0;
+  size_t length = 0;
+  for (size_t cut = 0; cut < len; cut++) {
+    if (Whisper::parse(whisper, frame, cut, json, sizeof(json), length) !=
+        WHISPER_OK) {
+      continue;
+    }
+
+    DynamicJsonDocument doc(2048);
+    if (!deserializeJson(doc, json, length)) {
+      accepted++;
+    }
+  }
+  return accepted;
+}
+
+// the other pwnagotchi's, plain and deflated, both in more than one chunk
+static void theirs(bool deflate) {
+  static uint8_t beacon[FRAME_HEADER_LENGTH + 3 +
+                        FRAME_CHUNKED(sizeof(pwngridAdvert))];
+  static uint8_t mangled[sizeof(beacon)];
+  size_t size = deflate ? pwngrid(beacon, pwngridDeflated,
+                                  sizeof(pwngridDeflated), true)
+                        : pwngrid(beacon, (const uint8_t *)pwngridAdvert,
+                                  strlen(pwngridAdvert), false);
+  size_t first = FRAME_HEADER_LENGTH + (deflate ? 3 : 0);
+
+  // reads back byte for byte, and decodes
+  size_t length = 0;
+  CHECK(Whisper::parse(whisper, beacon, size, json, sizeof(json), length) ==
+        WHISPER_OK);
+  CHECK(whisper.deflated == deflate);
+  CHECK(length == strlen(pwngridAdvert));
+  CHECK(memcmp(json, pwngridAdvert, length) == 0);
+  whisper_advert_t advert;
+  CHECK(Whisper::decode(json, length, advert));
+  CHECK(strcmp(advert.name, "alpha") == 0);
+  CHECK(strlen(advert.identity) == WHISPER_IDENTITY_HEX);
+  CHECK(strstr(pwngridAdvert, advert.identity) != nullptr);
+  CHECK(advert.pwndTot == 147);
+
+  CHECK(truncations(beacon, size) == 0);
+
+  // the first chunk a byte shorter than it says, or gone altogether
+  memcpy(mangled, beacon, size);
+  mangled[first + 1] = 254;
+  CHECK(!advertised(mangled, size));
+  memcpy(mangled, beacon, first);
+  memcpy(mangled + first, beacon + first + 257, size - first - 257);
+  CHECK(!advertised(mangled, size - 257));
+
+  // the compression flag where it shouldn't be, or missing
+  memcpy(mangled, beacon, FRAME_HEADER_LENGTH);
+  if (deflate) {
+    memcpy(mangled + FRAME_HEADER_LENGTH, beacon + first, size - first);
+  } else {
+    mangled[FRAME_HEADER_LENGTH] = Frame::IDWhisperCompression;
+    mangled[FRAME_HEADER_LENGTH + 1] = 1;
+    mangled[FRAME_HEADER_LENGTH + 2] = 1;
+    memcpy(mangled + FRAME_HEADER_LENGTH + 3, beacon + first, size - first);
+  }
+  CHECK(!advertised(mangled, deflate ? size - 3 : size + 3));
+
+  if (!deflate) {
+    return;
+  }
+
+  // each deflated byte with a bit flipped, nothing to check but that it all
+  // stays in bounds, raw deflate has no checksum to catch it
+  for (size_t i = first; i < size; i++) {
+    memcpy(mangled, beacon, size);
+    mangled[i] ^= 1 << (i % 8);
+    whisper_result_t result =
+        Whisper::parse(whisper, mangled, size, json, sizeof(json), length);
+    CHECK(length < sizeof(json));
+    if (result == WHISPER_OK) {
+      CHECK(json[length] == '\0');
+    }
+  }
+}
+
+int main() {
+  // the timing on the board, and the field scanner against ArduinoJson
+  CHECK(Whisper::benchmark());
+  CHECK(Whisper::benchmarkJson());
+
+  // our own beacon reads back the same either way it's sent
+  String sent[2];
+  for (int deflate = 0; deflate < 2; deflate++) {
+    Config::compress = deflate;
+    Frame::invalidate();
+    CHECK(Frame::pack() != nullptr);
+
+    size_t length = 0;
+    CHECK(Whisper::parse(whisper, Frame::beaconFrame, Frame::frameLength, json,
+                         sizeof(json), length) == WHISPER_OK);
+    CHECK(whisper.deflated == (bool)deflate);
+    sent[deflate] = String(json);
+
+    whisper_advert_t advert;
+    CHECK(Whisper::decode(json, length, advert));
+    CHECK(Config::name == advert.name);
+    CHECK(Config::identity == advert.identity);
+    CHECK(advert.pwndTot == Config::pwnd_tot);
+    CHECK(truncations(Frame::beaconFrame, Frame::frameLength) == 0);
+  }
+  CHECK(sent[0] == sent[1]);
+
+  theirs(false);
+  theirs(true);
+
+  // more chunks than we can hold
+  static uint8_t broken[FRAME_HEADER_LENGTH + 9 * 257];
+  memcpy(broken, Frame::header, FRAME_HEADER_LENGTH);
+  for (int i = 0; i < 9; i++) {
+    uint8_t *chunk = broken + FRAME_HEADER_LENGTH + i * 257;
+    chunk[0] = Frame::IDWhisperPayload;
+    chunk[1] = 255;
+    memset(chunk + 2, ' ', 255);
+  }
+  size_t length = 0;
+  CHECK(Whisper::parse(whisper, broken, sizeof(broken), json, sizeof(json),
+                       length) == WHISPER_OVERFLOW);
+
+  // flagged as compressed, but an invalid block type
+  broken[FRAME_HEADER_LENGTH] = Frame::IDWhisperCompression;
+  broken[FRAME_HEADER_LENGTH + 1] = 1;
+  broken[FRAME_HEADER_LENGTH + 2] = 1;
+  broken[FRAME_HEADER_LENGTH + 3] = Frame::IDWhisperPayload;
+  broken[FRAME_HEADER_LENGTH + 4] = 2;
+  broken[FRAME_HEADER_LENGTH + 5] = 0xff;
+  broken[FRAME_HEADER_LENGTH + 6] = 0xff;
+  CHECK(Whisper::parse(whisper, broken, FRAME_HEADER_LENGTH + 7, json,
+                       sizeof(json), length) == WHISPER_CORRUPT);
+
+  // a chunk that says it's longer than what's left of the frame
+  size_t cut = FRAME_HEADER_LENGTH + 2 + 10;
+  static uint8_t frame[FRAME_HEADER_LENGTH + 2 + 10];
+  memcpy(frame, Frame::beaconFrame, FRAME_HEADER_LENGTH);
+  frame[FRAME_HEADER_LENGTH] = Frame::IDWhisperPayload;
+  frame[FRAME_HEADER_LENGTH + 1] = 255;
+  memset(frame + FRAME_HEADER_LENGTH + 2, '{', 10);
+  CHECK(Whisper::parse(whisper, frame, cut, json, sizeof(json), length) ==
+        WHISPER_TRUNCATED);
+
+  // no pwngrid elements at all
+  CHECK(Whisper::parse(whisper, frame, FRAME_HEADER_LENGTH, json, sizeof(json),
+                       length) == WHISPER_EMPTY);
+  return finish();
+}
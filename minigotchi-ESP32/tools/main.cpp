@@ -0,0 +1,58 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * main.cpp: minigotchi-replay, runs captures through the sniffer on the host
+ */
+
+#include "replay.h"
+#include <unistd.h>
+
+// minigotchi-replay [--realtime] capture.pcap [more.pcapng ...]
+int main(int argc, char **argv) {
+  bool realtime = false;
+  int files = 0;
+  int failed = 0;
+
+  Pwnagotchi::begin();
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--realtime") == 0) {
+      realtime = true;
+      continue;
+    }
+
+    files++;
+    replay_result_t result;
+    if (Replay::run(argv[i], realtime, result)) {
+      Replay::report(argv[i], result);
+    } else {
+      failed++;
+    }
+  }
+
+  if (files == 0) {
+    printf("usage: %s [--realtime] capture.pcap [more.pcapng ...]\n",
+           argv[0]);
+    failed++;
+  }
+
+  // the peer task never returns, so there's no tearing down static objects
+  // from under it. just leave
+  fflush(stdout);
+  _exit(failed == 0 ? 0 : 1);
+}
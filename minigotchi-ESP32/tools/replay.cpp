@@ -0,0 +1,589 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * replay.cpp: feeds captured frames to the sniffer, on the host
+ */
+
+#include "replay.h"
+
+/** developer note:
+ *
+ * a capture from somewhere busy is the closest we get to being there without
+ * going there. this reads one on the host and hands every frame to the fake
+ * Hal, which gives it to Pwnagotchi::pwnagotchiCallback() the same way the
+ * driver would, so everything the callback does is timed: the ring claim,
+ * Capture::offer(), Channel::record() and Epoch::track(). pwngrid beacons go
+ * on to the real peer task and end up in the peer table. rssi and channel come
+ * from the radiotap header, raw 802.11 captures get REPLAY_RSSI_UNKNOWN and no
+ * channel.
+ *
+ * it goes as fast as it can, so the peer task can fall behind and drop
+ * beacons the way it would on a busy channel, those are counted. pass
+ * "--realtime" to keep the capture's own timing instead.
+ *
+ * both pcap and pcapng work, either byte order. frames too big for the
+ * driver to have handed us, and link types we don't know, are skipped and
+ * counted. the fcs comes off the end of a frame wherever the capture says
+ * there is one: the radiotap flags, the fcs bits in pcap's link type, or
+ * pcapng's if_fcslen and epb_flags.
+ *
+ */
+
+static_assert(REPLAY_FRAME_MAX < 4096, "sig_len is 12 bits");
+static_assert(REPLAY_BLOCK_MAX >= REPLAY_FRAME_MAX + 32,
+              "a block has to fit a whole frame");
+
+bool Replay::ng = false;
+bool Replay::swapped = false;
+bool Replay::nanos = false;
+int Replay::linktype = 0;
+uint8_t Replay::fcs = 0;
+int Replay::interfaces = 0;
+int Replay::linktypes[REPLAY_INTERFACES] = {};
+uint8_t Replay::resolutions[REPLAY_INTERFACES] = {};
+uint8_t Replay::fcsLengths[REPLAY_INTERFACES] = {};
+int64_t Replay::lastAt = 0;
+uint8_t Replay::block[REPLAY_BLOCK_MAX] = {};
+std::vector<uint32_t> Replay::samples;
+
+// Pwnagotchi::begin() has to have been called, the peer task is what empties
+// the ring
+bool Replay::run(const char *path, bool realtime, replay_result_t &result) {
+  memset(&result, 0, sizeof(result));
+  Replay::samples.clear();
+
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    printf("(X-X) Couldn't open %s!\n", path);
+    return false;
+  }
+
+  if (!Replay::open(file)) {
+    printf("(X-X) %s isn't a pcap or pcapng file!\n", path);
+    fclose(file);
+    return false;
+  }
+
+  // where the driver would hand frames over
+  Hal::setRxCallback(Pwnagotchi::pwnagotchiCallback);
+
+  replay_record_t record;
+  int64_t first = 0;
+  int64_t started = Stats::now();
+  uint32_t received = Pwnagotchi::received();
+  uint32_t drops = Pwnagotchi::drops();
+
+  while (Replay::next(file, record, result.skipped)) {
+    if (result.frames == 0) {
+      first = record.at;
+    }
+
+    if (realtime) {
+      // wait for the frame's turn, sleeping through the long gaps
+      int64_t due = started + (record.at - first);
+      int64_t now;
+      while ((now = Stats::now()) < due) {
+        if (due - now > 2000) {
+          delay(1);
+        }
+      }
+    }
+
+    Replay::samples.push_back(Replay::feed(record));
+    result.frames++;
+
+    // a beacon gets published or dropped, either way the callback took it
+    uint32_t detections = Pwnagotchi::received() - received +
+                          Pwnagotchi::drops() - drops;
+    if (result.detections == 0 && detections > 0) {
+      result.firstFrame = result.frames;
+      result.firstAt = record.at - first;
+    }
+    result.detections = detections;
+    result.span = std::max(result.span, record.at - first);
+  }
+
+  result.took = Stats::now() - started;
+  result.drops = Pwnagotchi::drops() - drops;
+  fclose(file);
+
+  // let the peer task catch up, so the peer table has everything in it
+  while (Pwnagotchi::pending() > 0) {
+    delay(1);
+  }
+  return true;
+}
+
+// the file header, works out which format and byte order we're reading
+bool Replay::open(FILE *file) {
+  uint8_t head[24];
+  if (!Replay::read(file, head, 8)) {
+    return false;
+  }
+
+  Replay::lastAt = 0;
+  Replay::interfaces = 0;
+
+  uint32_t magic;
+  memcpy(&magic, head, sizeof(magic));
+  if (magic == PCAPNG_SECTION) {
+    Replay::ng = true;
+    return Replay::section(file, head);
+  }
+
+  Replay::ng = false;
+  switch (magic) {
+  case 0xa1b2c3d4:
+    Replay::swapped = false;
+    Replay::nanos = false;
+    break;
+  case 0xd4c3b2a1:
+    Replay::swapped = true;
+    Replay::nanos = false;
+    break;
+  case 0xa1b23c4d:
+    Replay::swapped = false;
+    Replay::nanos = true;
+    break;
+  case 0x4d3cb2a1:
+    Replay::swapped = true;
+    Replay::nanos = true;
+    break;
+  default:
+    return false;
+  }
+
+  if (!Replay::read(file, head + 8, 16)) {
+    return false;
+  }
+  // the link type is the bottom 16 bits, the top ones can say how much fcs
+  // every frame ends in
+  uint32_t field = Replay::u32(head + 20);
+  Replay::linktype = field & 0xffff;
+  Replay::fcs =
+      field & LINKTYPE_FCS_PRESENT ? LINKTYPE_FCS_WORDS(field) * 2 : 0;
+  return true;
+}
+
+// a pcapng section header, the byte order can change with every one of them
+bool Replay::section(FILE *file, const uint8_t *head) {
+  uint8_t order[4];
+  if (!Replay::read(file, order, sizeof(order))) {
+    return false;
+  }
+
+  uint32_t magic;
+  memcpy(&magic, order, sizeof(magic));
+  if (magic == 0x1A2B3C4D) {
+    Replay::swapped = false;
+  } else if (magic == 0x4D3C2B1A) {
+    Replay::swapped = true;
+  } else {
+    return false;
+  }
+
+  // interface ids start over in every section
+  Replay::interfaces = 0;
+  uint32_t total = Replay::u32(head + 4);
+  return total >= 12 && total % 4 == 0 && Replay::skip(file, total - 12);
+}
+
+bool Replay::next(FILE *file, replay_record_t &record, uint32_t &skipped) {
+  return Replay::ng ? Replay::nextPcapng(file, record, skipped)
+                    : Replay::nextPcap(file, record, skipped);
+}
+
+bool Replay::nextPcap(FILE *file, replay_record_t &record,
+                      uint32_t &skipped) {
+  for (;;) {
+    uint8_t head[16];
+    if (!Replay::read(file, head, sizeof(head))) {
+      return false;
+    }
+
+    uint32_t seconds = Replay::u32(head);
+    uint32_t fraction = Replay::u32(head + 4);
+    uint32_t length = Replay::u32(head + 8);
+    if (length > sizeof(Replay::block)) {
+      skipped++;
+      if (!Replay::skip(file, length)) {
+        return false;
+      }
+      continue;
+    }
+    if (!Replay::read(file, Replay::block, length)) {
+      return false;
+    }
+
+    record.at = (int64_t)seconds * 1000000 +
+                (Replay::nanos ? fraction / 1000 : fraction);
+    if (Replay::link(Replay::linktype, Replay::fcs, Replay::block, length,
+                     record)) {
+      return true;
+    }
+    skipped++;
+  }
+}
+
+bool Replay::nextPcapng(FILE *file, replay_record_t &record,
+                        uint32_t &skipped) {
+  for (;;) {
+    uint8_t head[8];
+    if (!Replay::read(file, head, sizeof(head))) {
+      return false;
+    }
+
+    uint32_t type = Replay::u32(head);
+    if (type == PCAPNG_SECTION) {
+      if (!Replay::section(file, head)) {
+        return false;
+      }
+      continue;
+    }
+
+    uint32_t total = Replay::u32(head + 4);
+    if (total < 12 || total % 4 != 0) {
+      return false;
+    }
+
+    // the rest of the block, trailing length included
+    size_t body = total - 8;
+    bool wanted = type == PCAPNG_INTERFACE || type == PCAPNG_ENHANCED ||
+                  type == PCAPNG_SIMPLE;
+    if (!wanted || body > sizeof(Replay::block)) {
+      if (wanted && type != PCAPNG_INTERFACE) {
+        skipped++;
+      }
+      if (!Replay::skip(file, body)) {
+        return false;
+      }
+      continue;
+    }
+    if (!Replay::read(file, Replay::block, body)) {
+      return false;
+    }
+    body -= 4;
+
+    if (type == PCAPNG_INTERFACE) {
+      Replay::interface(Replay::block, body);
+      continue;
+    }
+
+    uint32_t id = 0;
+    const uint8_t *data;
+    size_t length;
+    int fcs = -1;
+    if (type == PCAPNG_ENHANCED) {
+      if (body < 20) {
+        skipped++;
+        continue;
+      }
+      id = Replay::u32(Replay::block);
+      uint64_t ticks = (uint64_t)Replay::u32(Replay::block + 4) << 32 |
+                       Replay::u32(Replay::block + 8);
+      length = Replay::u32(Replay::block + 12);
+      data = Replay::block + 20;
+      if (length > body - 20 ||
+          id >= (uint32_t)std::min(Replay::interfaces, REPLAY_INTERFACES)) {
+        skipped++;
+        continue;
+      }
+      Replay::lastAt = Replay::timestamp(ticks, Replay::resolutions[id]);
+
+      // the options come after the frame, padded out to 4 bytes
+      size_t options = 20 + ((length + 3) & ~(size_t)3);
+      if (options < body) {
+        fcs = Replay::flags(Replay::block + options, body - options);
+      }
+    } else {
+      // simple packets have no timestamp, they get the last one we saw
+      if (body < 4 || Replay::interfaces == 0) {
+        skipped++;
+        continue;
+      }
+      length = std::min((size_t)Replay::u32(Replay::block), body - 4);
+      data = Replay::block + 4;
+    }
+
+    // the frame's own flags first, then whatever its interface said
+    record.at = Replay::lastAt;
+    if (Replay::link(Replay::linktypes[id],
+                     fcs >= 0 ? fcs : Replay::fcsLengths[id], data, length,
+                     record)) {
+      return true;
+    }
+    skipped++;
+  }
+}
+
+// an interface description, all we want is the link type, clock and fcs
+void Replay::interface(const uint8_t *body, size_t length) {
+  int id = Replay::interfaces++;
+  if (id >= REPLAY_INTERFACES || length < 8) {
+    return;
+  }
+
+  Replay::linktypes[id] = Replay::u16(body);
+  Replay::resolutions[id] = 6;
+  Replay::fcsLengths[id] = 0;
+
+  // options are code, length, then the value padded out to 4 bytes
+  size_t at = 8;
+  while (at + 4 <= length) {
+    uint16_t code = Replay::u16(body + at);
+    uint16_t size = Replay::u16(body + at + 2);
+    at += 4;
+    if (code == 0 || at + size > length) {
+      break;
+    }
+    // if_tsresol
+    if (code == 9 && size >= 1) {
+      Replay::resolutions[id] = body[at];
+    }
+    // if_fcslen, in bits
+    if (code == 13 && size >= 1) {
+      Replay::fcsLengths[id] = body[at] / 8;
+    }
+    at += (size + 3) & ~3;
+  }
+}
+
+// an enhanced packet's epb_flags, bits 5-8 are how many bytes of fcs it ends
+// in. -1 if it doesn't say
+int Replay::flags(const uint8_t *options, size_t length) {
+  size_t at = 0;
+  while (at + 4 <= length) {
+    uint16_t code = Replay::u16(options + at);
+    uint16_t size = Replay::u16(options + at + 2);
+    at += 4;
+    if (code == 0 || at + size > length) {
+      break;
+    }
+    if (code == 2 && size >= 4) {
+      uint32_t fcs = (Replay::u32(options + at) >> 5) & 0xf;
+      return fcs > 0 ? (int)fcs : -1;
+    }
+    at += (size + 3) & ~3;
+  }
+  return -1;
+}
+
+// ticks of 10^-n seconds, or 2^-n with the top bit set
+int64_t Replay::timestamp(uint64_t ticks, uint8_t resolution) {
+  uint8_t exponent = resolution & 0x7f;
+  if (resolution & 0x80) {
+    if (exponent >= 64) {
+      return 0;
+    }
+    uint64_t mask = exponent == 0 ? 0 : ((uint64_t)1 << exponent) - 1;
+    return (int64_t)((ticks >> exponent) * 1000000 +
+                     (((ticks & mask) * 1000000) >> exponent));
+  }
+
+  while (exponent > 6) {
+    ticks /= 10;
+    exponent--;
+  }
+  while (exponent < 6) {
+    ticks *= 10;
+    exponent++;
+  }
+  return (int64_t)ticks;
+}
+
+// gets down to the 802.11 frame, picking up what the capture knows about it
+bool Replay::link(int linktype, uint8_t fcs, const uint8_t *data,
+                  size_t length, replay_record_t &record) {
+  record.rssi = REPLAY_RSSI_UNKNOWN;
+  record.channel = 0;
+  record.fcs = fcs;
+
+  if (linktype == LINKTYPE_IEEE802_11) {
+    record.data = data;
+    record.length = length;
+  } else if (linktype != LINKTYPE_RADIOTAP ||
+             !Replay::radiotap(data, length, record)) {
+    return false;
+  }
+
+  // the driver's length always counts an fcs, whether or not we kept it
+  return record.length >= record.fcs &&
+         record.length - record.fcs + 4 <= REPLAY_FRAME_MAX;
+}
+
+/** developer note:
+ *
+ * radiotap fields come in the order of their present bits, each lined up to
+ * its own size. the ones we want(flags, channel, antenna signal) are all in
+ * the first six, so we walk those and leave the rest alone.
+ *
+ */
+
+bool Replay::radiotap(const uint8_t *data, size_t length,
+                      replay_record_t &record) {
+  static const uint8_t sizes[6] = {8, 1, 1, 4, 2, 1};
+  static const uint8_t aligns[6] = {8, 1, 1, 2, 1, 1};
+
+  // radiotap is little endian whatever the file is
+  if (length < 8 || data[0] != 0) {
+    return false;
+  }
+  size_t header = data[2] | data[3] << 8;
+  if (header < 8 || header > length) {
+    return false;
+  }
+
+  uint32_t present = data[4] | data[5] << 8 | data[6] << 16 |
+                     (uint32_t)data[7] << 24;
+  size_t at = 8;
+  uint32_t more = present;
+  while (more & (1u << 31)) {
+    if (at + 4 > header) {
+      return false;
+    }
+    more = data[at] | data[at + 1] << 8 | data[at + 2] << 16 |
+           (uint32_t)data[at + 3] << 24;
+    at += 4;
+  }
+
+  for (int bit = 0; bit < 6; bit++) {
+    if (!(present & (1u << bit))) {
+      continue;
+    }
+
+    at = (at + aligns[bit] - 1) & ~(size_t)(aligns[bit] - 1);
+    if (at + sizes[bit] > header) {
+      return false;
+    }
+
+    switch (bit) {
+    case 1: // flags, 0x10 is "frame includes fcs"
+      if (data[at] & 0x10) {
+        record.fcs = 4;
+      }
+      break;
+    case 3: // channel, frequency first
+      record.channel = Replay::channelOf(data[at] | data[at + 1] << 8);
+      break;
+    case 5: // antenna signal, dBm
+      record.rssi = (int8_t)data[at];
+      break;
+    default:
+      break;
+    }
+    at += sizes[bit];
+  }
+
+  record.data = data + header;
+  record.length = length - header;
+  return true;
+}
+
+// 2.4 GHz only, anything else is a channel we can't be on
+int Replay::channelOf(int frequency) {
+  if (frequency == 2484) {
+    return 14;
+  }
+  if (frequency >= 2412 && frequency <= 2472) {
+    return (frequency - 2407) / 5;
+  }
+  return 0;
+}
+
+// one frame through the fake radio, returns how long the callback took(us)
+uint32_t Replay::feed(const replay_record_t &record) {
+  // Hal never hands over the fcs, whether or not the capture kept it
+  int len = (int)(record.length - record.fcs);
+  hal_frame_type_t type = HAL_FRAME_MISC;
+  if (len > 0) {
+    switch ((record.data[0] >> 2) & 3) {
+    case 0:
+      type = HAL_FRAME_MGMT;
+      break;
+    case 1:
+      type = HAL_FRAME_CTRL;
+      break;
+    case 2:
+      type = HAL_FRAME_DATA;
+      break;
+    default:
+      break;
+    }
+  }
+
+  int64_t started = Stats::now();
+  Fake::receive(record.data, len, record.rssi, record.channel, type);
+  return (uint32_t)(Stats::now() - started);
+}
+
+void Replay::report(const char *path, const replay_result_t &result) {
+  std::sort(Replay::samples.begin(), Replay::samples.end());
+
+  uint32_t ms = (uint32_t)(result.took / 1000);
+  uint32_t fps = result.took > 0
+                     ? (uint32_t)((uint64_t)result.frames * 1000000 /
+                                  (uint64_t)result.took)
+                     : 0;
+
+  printf("('-') %s: %u frames in %u ms(%u s captured), %u fps\n", path,
+         (unsigned)result.frames, (unsigned)ms,
+         (unsigned)(result.span / 1000000), (unsigned)fps);
+  printf("('-') Skipped: %u\n", (unsigned)result.skipped);
+  printf("('-') Pwngrid beacons: %u, %u dropped, %d peers known\n",
+         (unsigned)result.detections, (unsigned)result.drops,
+         Peers::count());
+  if (result.detections > 0) {
+    printf("('-') First one: frame %u, %u ms into the capture\n",
+           (unsigned)result.firstFrame, (unsigned)(result.firstAt / 1000));
+  }
+  printf("('-') Callback us p50=%u p95=%u p99=%u max=%u\n",
+         (unsigned)Replay::percentile(50), (unsigned)Replay::percentile(95),
+         (unsigned)Replay::percentile(99), (unsigned)Replay::percentile(100));
+  printf(" \n");
+}
+
+// samples has to be sorted already
+uint32_t Replay::percentile(int pct) {
+  size_t n = Replay::samples.size();
+  if (n == 0) {
+    return 0;
+  }
+  size_t rank = (n * pct + 99) / 100;
+  return Replay::samples[rank > 0 ? rank - 1 : 0];
+}
+
+bool Replay::read(FILE *file, uint8_t *out, size_t length) {
+  return fread(out, 1, length, file) == length;
+}
+
+bool Replay::skip(FILE *file, size_t length) {
+  return fseek(file, (long)length, SEEK_CUR) == 0;
+}
+
+uint16_t Replay::u16(const uint8_t *data) {
+  uint16_t value;
+  memcpy(&value, data, sizeof(value));
+  return Replay::swapped ? __builtin_bswap16(value) : value;
+}
+
+uint32_t Replay::u32(const uint8_t *data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return Replay::swapped ? __builtin_bswap32(value) : value;
+}
@@ -0,0 +1,127 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * replay.h: header files for replay.cpp
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "fake.h"
+#include "hal.h"
+#include "peers.h"
+#include "pwnagotchi.h"
+#include "stats.h"
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// longest frame the driver can hand us, its length field is 12 bits
+#define REPLAY_FRAME_MAX 4095
+
+// biggest record(or pcapng block) we read in, a whole frame plus headers
+#define REPLAY_BLOCK_MAX 4352
+
+// pcapng interfaces we remember the link type of
+#define REPLAY_INTERFACES 8
+
+// what a frame gets for rssi when the capture doesn't say
+#define REPLAY_RSSI_UNKNOWN -60
+
+// link types we can take frames out of
+#define LINKTYPE_IEEE802_11 105
+#define LINKTYPE_RADIOTAP 127
+
+// pcap's link type field can also say how much fcs every frame ends in, in
+// 16 bit words
+#define LINKTYPE_FCS_PRESENT 0x04000000
+#define LINKTYPE_FCS_WORDS(field) (((field) >> 28) & 0xf)
+
+// pcapng blocks we care about
+#define PCAPNG_SECTION 0x0A0D0D0A
+#define PCAPNG_INTERFACE 0x00000001
+#define PCAPNG_SIMPLE 0x00000003
+#define PCAPNG_ENHANCED 0x00000006
+
+// one captured frame, ready to be handed to the callback
+typedef struct {
+  int64_t at; // us, on the capture's clock
+  int rssi;
+  int channel; // 0 when we don't know
+  uint8_t fcs; // bytes of checksum the frame still ends in
+  const uint8_t *data;
+  size_t length;
+} replay_record_t;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t skipped;
+  uint32_t detections; // pwngrid beacons the callback tried to hand over
+  uint32_t drops;      // ones that didn't fit in the peer task's ring
+  uint32_t firstFrame;
+  int64_t firstAt;
+  int64_t took;
+  int64_t span;
+} replay_result_t;
+
+class Replay {
+public:
+  static bool run(const char *path, bool realtime, replay_result_t &result);
+  static void report(const char *path, const replay_result_t &result);
+
+private:
+  static bool open(FILE *file);
+  static bool next(FILE *file, replay_record_t &record, uint32_t &skipped);
+  static bool nextPcap(FILE *file, replay_record_t &record,
+                       uint32_t &skipped);
+  static bool nextPcapng(FILE *file, replay_record_t &record,
+                         uint32_t &skipped);
+  static bool section(FILE *file, const uint8_t *head);
+  static void interface(const uint8_t *body, size_t length);
+  static int flags(const uint8_t *options, size_t length);
+  static bool link(int linktype, uint8_t fcs, const uint8_t *data,
+                   size_t length, replay_record_t &record);
+  static bool radiotap(const uint8_t *data, size_t length,
+                       replay_record_t &record);
+  static int channelOf(int frequency);
+  static int64_t timestamp(uint64_t ticks, uint8_t resolution);
+  static uint32_t feed(const replay_record_t &record);
+  static uint32_t percentile(int pct);
+  static bool read(FILE *file, uint8_t *out, size_t length);
+  static bool skip(FILE *file, size_t length);
+  static uint16_t u16(const uint8_t *data);
+  static uint32_t u32(const uint8_t *data);
+
+  static bool ng;
+  static bool swapped;
+  static bool nanos;
+  static int linktype;
+  static uint8_t fcs;
+  static int interfaces;
+  static int linktypes[REPLAY_INTERFACES];
+  static uint8_t resolutions[REPLAY_INTERFACES];
+  static uint8_t fcsLengths[REPLAY_INTERFACES];
+  static int64_t lastAt;
+  static uint8_t block[REPLAY_BLOCK_MAX];
+  static std::vector<uint32_t> samples;
+};
+
+#endif // REPLAY_H
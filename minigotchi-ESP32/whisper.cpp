@@ -0,0 +1,575 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * whisper.cpp: reads the pwngrid elements back out of a received beacon
+ */
+
+#include "whisper.h"
+#include "frame.h"
+
+/** developer note:
+ *
+ * after the fixed part of the beacon it's just a list of tagged elements, an
+ * id byte, a length byte and that many bytes. pwngrid puts its json in 0xDE
+ * elements of up to 255 bytes each, flags compression with 0xDF, and sends
+ * its identity(0xE0), a signature(0xE1) and a stream header(0xE2) the same
+ * way. anything else in the list(ssid, rates, vendor stuff) gets skipped.
+ *
+ * feed() is a byte at a time state machine, so the frame doesn't have to be
+ * in one piece and it never looks at a byte it wasn't given. an element that
+ * claims to be longer than what's left of the frame just leaves the parser
+ * mid-element, and finish() turns that down. chunks that would overflow a
+ * buffer are dropped and flagged instead of written.
+ *
+ * send "bench whisper" over serial to time it on our own beacons. the corpus
+ * it gets checked against(other beacons, truncated, mangled and bit flipped
+ * ones) is in test/test_whisper.cpp, it doesn't need to be on the board.
+ *
+ */
+
+void Whisper::begin(whisper_t &whisper) {
+  whisper.state = WHISPER_TAG;
+  whisper.tag = 0;
+  whisper.remaining = 0;
+  whisper.at = 0;
+  whisper.elements = 0;
+  whisper.overflow = false;
+  whisper.deflated = false;
+  whisper.streamed = false;
+  whisper.payloadLength = 0;
+  whisper.identityLength = 0;
+  whisper.signatureLength = 0;
+}
+
+void Whisper::feed(whisper_t &whisper, const uint8_t *data, size_t length) {
+  size_t i = 0;
+  while (i < length) {
+    switch (whisper.state) {
+    case WHISPER_TAG:
+      whisper.tag = data[i++];
+      whisper.state = WHISPER_LENGTH;
+      break;
+
+    case WHISPER_LENGTH:
+      whisper.remaining = data[i++];
+      whisper.at = 0;
+      whisper.elements++;
+      whisper.state = whisper.remaining > 0 ? WHISPER_VALUE : WHISPER_TAG;
+      break;
+
+    case WHISPER_VALUE: {
+      size_t take = min(length - i, (size_t)whisper.remaining);
+      Whisper::value(whisper, data + i, take);
+      i += take;
+      whisper.at += take;
+      whisper.remaining -= take;
+      if (whisper.remaining == 0) {
+        whisper.state = WHISPER_TAG;
+      }
+      break;
+    }
+    }
+  }
+}
+
+// some (or all) of the current element's value
+void Whisper::value(whisper_t &whisper, const uint8_t *data, size_t length) {
+  if (whisper.tag == Frame::IDWhisperPayload) {
+    whisper.overflow |=
+        !Whisper::append(whisper.payload, sizeof(whisper.payload),
+                         whisper.payloadLength, data, length);
+  } else if (whisper.tag == Frame::IDWhisperCompression) {
+    // pack.go writes a single 1
+    if (whisper.at == 0 && length > 0) {
+      whisper.deflated = data[0] == 1;
+    }
+  } else if (whisper.tag == Frame::IDWhisperIdentity) {
+    whisper.overflow |=
+        !Whisper::append(whisper.identity, sizeof(whisper.identity),
+                         whisper.identityLength, data, length);
+  } else if (whisper.tag == Frame::IDWhisperSignature) {
+    whisper.overflow |=
+        !Whisper::append(whisper.signature, sizeof(whisper.signature),
+                         whisper.signatureLength, data, length);
+  } else if (whisper.tag == Frame::IDWhisperStreamHeader) {
+    whisper.streamed = true;
+  }
+}
+
+bool Whisper::append(uint8_t *buffer, size_t capacity, size_t &used,
+                     const uint8_t *data, size_t length) {
+  if (length > capacity - used) {
+    return false;
+  }
+  memcpy(buffer + used, data, length);
+  used += length;
+  return true;
+}
+
+// the json, inflated if it has to be and nul terminated
+whisper_result_t Whisper::finish(whisper_t &whisper, char *out,
+                                 size_t capacity, size_t &length) {
+  length = 0;
+  if (capacity > 0) {
+    out[0] = '\0';
+  }
+
+  if (whisper.state != WHISPER_TAG) {
+    return WHISPER_TRUNCATED;
+  }
+  if (whisper.overflow || capacity == 0) {
+    return WHISPER_OVERFLOW;
+  }
+  if (whisper.payloadLength == 0) {
+    return WHISPER_EMPTY;
+  }
+
+  if (whisper.deflated) {
+    int inflated = Deflate::inflate(whisper.payload, whisper.payloadLength,
+                                    (uint8_t *)out, capacity - 1);
+    if (inflated < 0) {
+      return WHISPER_CORRUPT;
+    }
+    length = inflated;
+  } else {
+    if (whisper.payloadLength > capacity - 1) {
+      return WHISPER_OVERFLOW;
+    }
+    memcpy(out, whisper.payload, whisper.payloadLength);
+    length = whisper.payloadLength;
+  }
+
+  out[length] = '\0';
+  return WHISPER_OK;
+}
+
+// every element of a beacon, without inflating anything yet
+void Whisper::scan(whisper_t &whisper, const uint8_t *frame, size_t len) {
+  Whisper::begin(whisper);
+  if (len < (size_t)Frame::pwngridHeaderLength) {
+    // short of even the fixed part, finish() calls that truncated
+    whisper.state = WHISPER_LENGTH;
+    return;
+  }
+
+  Whisper::feed(whisper, frame + Frame::pwngridHeaderLength,
+                len - Frame::pwngridHeaderLength);
+}
+
+// a whole beacon in one go
+whisper_result_t Whisper::parse(whisper_t &whisper, const uint8_t *frame,
+                                size_t len, char *out, size_t capacity,
+                                size_t &length) {
+  Whisper::scan(whisper, frame, len);
+  return Whisper::finish(whisper, out, capacity, length);
+}
+
+/** developer note:
+ *
+ * out of a whole advertisment we only keep a handful of fields, so there's no
+ * point building an ArduinoJson document(2 kb of heap) for every peer just to
+ * read two of them. decode() walks the top level object once, copies the
+ * fields we want into a whisper_advert_t and skips over everything else
+ * (policy and all) without looking inside. no heap, no recursion, and it
+ * never reads past length.
+ *
+ * send "bench json" over serial to compare it with ArduinoJson.
+ *
+ */
+
+bool Whisper::decode(const char *json, size_t length,
+                     whisper_advert_t &advert) {
+  const char *at = json;
+  const char *end = json + length;
+  memset(&advert, 0, sizeof(advert));
+
+  Whisper::space(at, end);
+  if (at == end || *at != '{') {
+    return false;
+  }
+  at++;
+
+  Whisper::space(at, end);
+  if (at < end && *at == '}') {
+    return true;
+  }
+
+  for (;;) {
+    char key[WHISPER_KEY_MAX];
+    Whisper::space(at, end);
+    if (!Whisper::string(at, end, key, sizeof(key))) {
+      return false;
+    }
+
+    Whisper::space(at, end);
+    if (at == end || *at != ':') {
+      return false;
+    }
+    at++;
+
+    Whisper::space(at, end);
+    if (!Whisper::field(at, end, key, advert)) {
+      return false;
+    }
+
+    Whisper::space(at, end);
+    if (at == end) {
+      return false;
+    }
+    if (*at == '}') {
+      return true;
+    }
+    if (*at != ',') {
+      return false;
+    }
+    at++;
+  }
+}
+
+// one value of the top level object, kept if it's one we want
+bool Whisper::field(const char *&at, const char *end, const char *key,
+                    whisper_advert_t &advert) {
+  if (strcmp(key, "name") == 0) {
+    return Whisper::text(at, end, advert, ADVERT_NAME, advert.name,
+                         sizeof(advert.name));
+  } else if (strcmp(key, "identity") == 0) {
+    return Whisper::text(at, end, advert, ADVERT_IDENTITY, advert.identity,
+                         sizeof(advert.identity));
+  } else if (strcmp(key, "face") == 0) {
+    return Whisper::text(at, end, advert, ADVERT_FACE, advert.face,
+                         sizeof(advert.face));
+  } else if (strcmp(key, "version") == 0) {
+    return Whisper::text(at, end, advert, ADVERT_VERSION, advert.version,
+                         sizeof(advert.version));
+  } else if (strcmp(key, "pwnd_tot") == 0) {
+    return Whisper::integer(at, end, advert, ADVERT_PWND_TOT, advert.pwndTot);
+  } else if (strcmp(key, "pwnd_run") == 0) {
+    return Whisper::integer(at, end, advert, ADVERT_PWND_RUN, advert.pwndRun);
+  } else if (strcmp(key, "epoch") == 0) {
+    return Whisper::integer(at, end, advert, ADVERT_EPOCH, advert.epoch);
+  }
+  return Whisper::skip(at, end);
+}
+
+// a string field, anything else(null, say) leaves it unset
+bool Whisper::text(const char *&at, const char *end, whisper_advert_t &advert,
+                   whisper_field_t bit, char *out, size_t capacity) {
+  if (at == end || *at != '"') {
+    return Whisper::skip(at, end);
+  }
+  if (!Whisper::string(at, end, out, capacity)) {
+    return false;
+  }
+  advert.found |= bit;
+  return true;
+}
+
+// a number field, same deal
+bool Whisper::integer(const char *&at, const char *end,
+                      whisper_advert_t &advert, whisper_field_t bit,
+                      int &out) {
+  if (at == end || (*at != '-' && !isdigit((unsigned char)*at))) {
+    return Whisper::skip(at, end);
+  }
+  if (!Whisper::number(at, end, out)) {
+    return false;
+  }
+  advert.found |= bit;
+  return true;
+}
+
+void Whisper::space(const char *&at, const char *end) {
+  while (at < end &&
+         (*at == ' ' || *at == '\t' || *at == '\n' || *at == '\r')) {
+    at++;
+  }
+}
+
+// a quoted string, escapes undone, non-ascii as '?' and cut short to fit
+// capacity(nul included). out can be nullptr to just skip it
+bool Whisper::string(const char *&at, const char *end, char *out,
+                     size_t capacity) {
+  if (at == end || *at != '"') {
+    return false;
+  }
+  at++;
+
+  size_t used = 0;
+  while (at < end && *at != '"') {
+    char c = *at++;
+    if (c == '\\') {
+      if (at == end) {
+        return false;
+      }
+
+      char escaped = *at++;
+      switch (escaped) {
+      case 'b':
+        c = '\b';
+        break;
+      case 'f':
+        c = '\f';
+        break;
+      case 'n':
+        c = '\n';
+        break;
+      case 'r':
+        c = '\r';
+        break;
+      case 't':
+        c = '\t';
+        break;
+      case 'u': {
+        if (end - at < 4) {
+          return false;
+        }
+        unsigned code = 0;
+        for (int i = 0; i < 4; i++) {
+          char h = *at++;
+          if (!isxdigit((unsigned char)h)) {
+            return false;
+          }
+          code = code * 16 + (isdigit((unsigned char)h)
+                                  ? h - '0'
+                                  : tolower((unsigned char)h) - 'a' + 10);
+        }
+        c = code < 0x80 ? (char)code : '?';
+        break;
+      }
+      default:
+        // \" \\ and \/ are just themselves
+        c = escaped;
+        break;
+      }
+    } else if (!isAscii(c)) {
+      c = '?';
+    }
+
+    if (out != nullptr && used + 1 < capacity) {
+      out[used++] = c;
+    }
+  }
+
+  if (at == end) {
+    return false;
+  }
+  at++;
+
+  if (out != nullptr && capacity > 0) {
+    out[used] = '\0';
+  }
+  return true;
+}
+
+// an integer, a fraction or exponent just gets skipped
+bool Whisper::number(const char *&at, const char *end, int &out) {
+  bool negative = at < end && *at == '-';
+  if (negative) {
+    at++;
+  }
+
+  int64_t value = 0;
+  const char *digits = at;
+  while (at < end && isdigit((unsigned char)*at)) {
+    value = min(value * 10 + (*at - '0'), (int64_t)INT32_MAX);
+    at++;
+  }
+  if (at == digits) {
+    return false;
+  }
+
+  while (at < end && (isdigit((unsigned char)*at) || *at == '.' ||
+                      *at == 'e' || *at == 'E' || *at == '+' || *at == '-')) {
+    at++;
+  }
+
+  out = (int)(negative ? -value : value);
+  return true;
+}
+
+// any value we don't care about, objects and arrays by counting brackets
+bool Whisper::skip(const char *&at, const char *end) {
+  if (at == end) {
+    return false;
+  }
+
+  if (*at == '"') {
+    return Whisper::string(at, end, nullptr, 0);
+  }
+
+  if (*at == '{' || *at == '[') {
+    int depth = 0;
+    while (at < end) {
+      if (*at == '"') {
+        if (!Whisper::string(at, end, nullptr, 0)) {
+          return false;
+        }
+        continue;
+      }
+
+      if (*at == '{' || *at == '[') {
+        depth++;
+      } else if (*at == '}' || *at == ']') {
+        if (--depth == 0) {
+          at++;
+          return true;
+        }
+      }
+      at++;
+    }
+    return false;
+  }
+
+  // true, false, null or a number
+  const char *start = at;
+  while (at < end && (isalnum((unsigned char)*at) || *at == '-' ||
+                      *at == '+' || *at == '.')) {
+    at++;
+  }
+  return at > start;
+}
+
+const char *Whisper::describe(whisper_result_t result) {
+  switch (result) {
+  case WHISPER_OK:
+    return "ok";
+  case WHISPER_EMPTY:
+    return "no payload";
+  case WHISPER_TRUNCATED:
+    return "truncated";
+  case WHISPER_OVERFLOW:
+    return "too big";
+  case WHISPER_CORRUPT:
+    return "doesn't inflate";
+  }
+  return "unknown";
+}
+
+static const bool registered = Commands::add(Whisper::command);
+
+bool Whisper::command(const String &line) {
+  if (line == "bench whisper") {
+    Whisper::benchmark();
+  } else if (line == "bench json") {
+    Whisper::benchmarkJson();
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool Whisper::benchmark() {
+  static whisper_t whisper;
+  static char json[WHISPER_PAYLOAD_MAX + 1];
+  const int rounds = 1000;
+  bool read = true;
+
+  // our own beacon as it goes out, plain and deflated
+  bool compress = Config::compress;
+  for (int deflate = 0; deflate < 2; deflate++) {
+    Config::compress = deflate;
+    Frame::invalidate();
+    Frame::pack();
+    size_t size = Frame::frameLength;
+    size_t length = 0;
+
+    whisper_result_t result = Whisper::parse(
+        whisper, Frame::beaconFrame, size, json, sizeof(json), length);
+    if (result != WHISPER_OK) {
+      read = false;
+      Serial.printf("(X-X) %s beacon: %s\n", deflate ? "Compressed" : "Plain",
+                    Whisper::describe(result));
+      continue;
+    }
+
+    int64_t started = Stats::now();
+    for (int i = 0; i < rounds; i++) {
+      Whisper::parse(whisper, Frame::beaconFrame, size, json, sizeof(json),
+                     length);
+    }
+    uint32_t elapsed = max((uint32_t)(Stats::now() - started), (uint32_t)1);
+
+    uint64_t bytes = (uint64_t)size * rounds;
+    Serial.printf("('-') %u byte %s beacon: %u us/frame, %u KB/s\n",
+                  (unsigned)size, deflate ? "compressed" : "plain",
+                  (unsigned)(elapsed / rounds),
+                  (unsigned)(bytes * 1000000 / elapsed / 1024));
+  }
+  Config::compress = compress;
+  Frame::invalidate();
+
+  Serial.println(" ");
+  return read;
+}
+
+// the scanner against a whole ArduinoJson document, on our own advertisment
+bool Whisper::benchmarkJson() {
+  static whisper_t whisper;
+  static char json[WHISPER_PAYLOAD_MAX + 1];
+  const int rounds = 200;
+  size_t length = 0;
+
+  Frame::invalidate();
+  Frame::pack();
+  if (Whisper::parse(whisper, Frame::beaconFrame, Frame::frameLength, json,
+                     sizeof(json), length) != WHISPER_OK) {
+    Serial.println("(X-X) Couldn't read our own beacon back!");
+    Serial.println(" ");
+    return false;
+  }
+
+  uint32_t freeHeap = ESP.getFreeHeap();
+
+  // the old way, a whole document to read two fields
+  String name;
+  String pwndTot;
+  int64_t started = Stats::now();
+  for (int i = 0; i < rounds; i++) {
+    DynamicJsonDocument doc(2048);
+    deserializeJson(doc, json, length);
+    name = doc["name"].as<String>();
+    pwndTot = doc["pwnd_tot"].as<String>();
+  }
+  uint32_t document = (uint32_t)(Stats::now() - started);
+
+  whisper_advert_t advert;
+  bool decoded = false;
+  started = Stats::now();
+  for (int i = 0; i < rounds; i++) {
+    decoded = Whisper::decode(json, length, advert);
+  }
+  uint32_t scanned = (uint32_t)(Stats::now() - started);
+
+  bool same = decoded && name == advert.name &&
+              pwndTot.toInt() == advert.pwndTot &&
+              Config::identity == advert.identity;
+
+  Serial.printf("('-') %u byte advertisment\n", (unsigned)length);
+  Serial.printf("('-') ArduinoJson document: %u us/parse, 2048 bytes of "
+                "heap\n",
+                (unsigned)(document / rounds));
+  Serial.printf("('-') Field scanner: %u us/parse, %u bytes, no heap\n",
+                (unsigned)(scanned / rounds), (unsigned)sizeof(advert));
+  Serial.printf("('-') Free heap %u -> %u\n", (unsigned)freeHeap,
+                (unsigned)ESP.getFreeHeap());
+  Serial.println(same ? "('-') Scanner matches ArduinoJson"
+                      : "(X-X) Scanner doesn't match ArduinoJson!");
+  Serial.println(" ");
+  return same;
+}
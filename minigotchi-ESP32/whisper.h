@@ -0,0 +1,136 @@
+/*
+ * Minigotchi: An even smaller Pwnagotchi
+ * Copyright (C) 2024 dj1ch
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * whisper.h: header files for whisper.cpp
+ */
+
+#ifndef WHISPER_H
+#define WHISPER_H
+
+#include "commands.h"
+#include "deflate.h"
+#include <Arduino.h>
+
+// most we reassemble out of a beacon's elements, before inflating
+#define WHISPER_PAYLOAD_MAX 2048
+#define WHISPER_IDENTITY_MAX 64
+#define WHISPER_SIGNATURE_MAX 512
+
+// the advertisment fields we keep, see Whisper::decode()
+#define WHISPER_NAME_MAX 32
+#define WHISPER_IDENTITY_HEX 64
+#define WHISPER_FACE_MAX 32
+#define WHISPER_VERSION_MAX 16
+
+// longer keys than this can't be one we're after
+#define WHISPER_KEY_MAX 16
+
+// which of the fields Whisper::decode() found
+typedef enum {
+  ADVERT_NAME = 1 << 0,
+  ADVERT_IDENTITY = 1 << 1,
+  ADVERT_FACE = 1 << 2,
+  ADVERT_VERSION = 1 << 3,
+  ADVERT_PWND_TOT = 1 << 4,
+  ADVERT_PWND_RUN = 1 << 5,
+  ADVERT_EPOCH = 1 << 6,
+} whisper_field_t;
+
+// what we want out of a peer's json, strings are cut short to fit
+typedef struct {
+  uint8_t found;
+  char name[WHISPER_NAME_MAX + 1];
+  char identity[WHISPER_IDENTITY_HEX + 1];
+  char face[WHISPER_FACE_MAX + 1];
+  char version[WHISPER_VERSION_MAX + 1];
+  int pwndTot;
+  int pwndRun;
+  int epoch;
+} whisper_advert_t;
+
+// where the parser is within the element list
+typedef enum {
+  WHISPER_TAG = 0,
+  WHISPER_LENGTH = 1,
+  WHISPER_VALUE = 2,
+} whisper_state_t;
+
+typedef enum {
+  WHISPER_OK = 0,
+  WHISPER_EMPTY = 1,     // no 0xDE elements at all
+  WHISPER_TRUNCATED = 2, // the frame ends in the middle of an element
+  WHISPER_OVERFLOW = 3,  // more than we have room for
+  WHISPER_CORRUPT = 4,   // flagged as compressed but doesn't inflate
+} whisper_result_t;
+
+// everything we've picked out of a beacon so far, see Whisper::feed()
+typedef struct {
+  whisper_state_t state;
+  uint8_t tag;
+  uint8_t remaining;
+  uint8_t at;
+  int elements;
+  bool overflow;
+  bool deflated;
+  bool streamed;
+  size_t payloadLength;
+  size_t identityLength;
+  size_t signatureLength;
+  uint8_t payload[WHISPER_PAYLOAD_MAX];
+  uint8_t identity[WHISPER_IDENTITY_MAX];
+  uint8_t signature[WHISPER_SIGNATURE_MAX];
+} whisper_t;
+
+class Whisper {
+public:
+  static void begin(whisper_t &whisper);
+  static void feed(whisper_t &whisper, const uint8_t *data, size_t length);
+  static void scan(whisper_t &whisper, const uint8_t *frame, size_t len);
+  static whisper_result_t finish(whisper_t &whisper, char *out,
+                                 size_t capacity, size_t &length);
+  static whisper_result_t parse(whisper_t &whisper, const uint8_t *frame,
+                                size_t len, char *out, size_t capacity,
+                                size_t &length);
+  static bool decode(const char *json, size_t length,
+                     whisper_advert_t &advert);
+  static const char *describe(whisper_result_t result);
+  static bool command(const String &line);
+  static bool benchmark();
+  static bool benchmarkJson();
+
+private:
+  static void value(whisper_t &whisper, const uint8_t *data, size_t length);
+  static bool append(uint8_t *buffer, size_t capacity, size_t &used,
+                     const uint8_t *data, size_t length);
+
+  // decode()
+  static bool field(const char *&at, const char *end, const char *key,
+                    whisper_advert_t &advert);
+  static bool text(const char *&at, const char *end, whisper_advert_t &advert,
+                   whisper_field_t bit, char *out, size_t capacity);
+  static bool integer(const char *&at, const char *end,
+                      whisper_advert_t &advert, whisper_field_t bit, int &out);
+  static void space(const char *&at, const char *end);
+  static bool string(const char *&at, const char *end, char *out,
+                     size_t capacity);
+  static bool number(const char *&at, const char *end, int &out);
+  static bool skip(const char *&at, const char *end);
+};
+
+#endif // WHISPER_H